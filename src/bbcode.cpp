@@ -19,6 +19,10 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "bbcode.h"
 
+#include <QCache>
+#include <QCryptographicHash>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QRegExp>
 #include <map>
 
@@ -26,6 +30,10 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 namespace BBCode {
 
 
+// maximum number of characters of converted descriptions to keep around
+static const int CACHE_SIZE = 4 * 1024 * 1024;
+
+
 class BBCodeMap {
 
   typedef std::map<QString, std::pair<QRegExp, QString> > TagMap;
@@ -37,11 +45,25 @@ public:
     return s_Instance;
   }
 
-  QString convertTag(QString input, int &length)
+  /**
+   * @brief convert the tag starting at pos in input
+   * @param input the text being converted
+   * @param pos position of the opening bracket of the tag
+   * @param length receives the number of characters of input the tag covers including its content
+   *               and closing tag. 0 if the tag wasn't converted
+   * @return the replacement, still containing any tags nested in the content
+   */
+  QString convertTag(const QString &input, int pos, int &length)
   {
     // extract the tag name
-    m_TagNameExp.indexIn(input, 1, QRegExp::CaretAtOffset);
-    QString tagName = m_TagNameExp.cap(0).toLower();
+    int nameEnd = pos + 1;
+    while ((nameEnd < input.size()) && isTagNameChar(input.at(nameEnd))) {
+      ++nameEnd;
+    }
+    if ((nameEnd < input.size()) && (input.at(nameEnd) == '=')) {
+      ++nameEnd;
+    }
+    QString tagName = input.mid(pos + 1, nameEnd - pos - 1).toLower();
     TagMap::iterator tagIter = m_TagMap.find(tagName);
     if (tagIter != m_TagMap.end()) {
       // recognized tag
@@ -49,11 +71,16 @@ public:
         tagName.chop(1);
       }
 
+      // positions are relative to the start of the tag
       int closeTagPos = 0;
       int closeTagLength = 0;
+      QString missingCloseTag;
       if (tagName == "*") {
         // ends at the next bullet point
-        closeTagPos = input.indexOf(QRegExp("(\\[\\*\\]|</ul>)", Qt::CaseInsensitive), 3);
+        closeTagPos = nextBullet(input, pos + 3);
+        if (closeTagPos != -1) {
+          closeTagPos -= pos;
+        }
         // leave closeTagLength at 0 because we don't want to "eat" the next bullet point
       } else if (tagName == "line") {
         // ends immediately after the tag
@@ -61,18 +88,19 @@ public:
         // leave closeTagLength at 0 because there is no close tag to skip over
       } else {
         QString closeTag = QString("[/%1]").arg(tagName);
-        closeTagPos = input.indexOf(closeTag, 0, Qt::CaseInsensitive);
+        closeTagPos = input.indexOf(closeTag, pos, Qt::CaseInsensitive);
         if (closeTagPos == -1) {
           // workaround to improve compatibility: add fake closing tag
-          input.append(closeTag);
-          closeTagPos = input.size() - closeTag.size();
+          missingCloseTag = closeTag;
+          closeTagPos = input.size();
         }
+        closeTagPos -= pos;
         closeTagLength = closeTag.size();
       }
 
       if (closeTagPos > -1) {
         length = closeTagPos + closeTagLength;
-        QString temp = input.mid(0, length);
+        QString temp = input.mid(pos, length - missingCloseTag.size()).append(missingCloseTag);
         if (tagIter->second.first.indexIn(temp) == 0) {
           if (tagIter->second.second.isEmpty()) {
             if (tagName == "color") {
@@ -113,8 +141,30 @@ public:
   }
 
 private:
+
+  static bool isTagNameChar(QChar ch)
+  {
+    ushort code = ch.unicode();
+    return ((code >= 'a') && (code <= 'z'))
+        || ((code >= 'A') && (code <= 'Z'))
+        || (code == '*');
+  }
+
+  /**
+   * @brief find the end of a bullet point, which is either the next bullet point or the end of the list
+   */
+  static int nextBullet(const QString &input, int from)
+  {
+    int bulletPos = input.indexOf("[*]", from);
+    if (bulletPos == -1) {
+      return input.indexOf("</ul>", from, Qt::CaseInsensitive);
+    }
+    // don't search beyond the next bullet, that would make long lists quadratic
+    int listEnd = input.midRef(from, bulletPos - from).indexOf("</ul>", 0, Qt::CaseInsensitive);
+    return listEnd != -1 ? from + listEnd : bulletPos;
+  }
+
   BBCodeMap()
-    : m_TagNameExp("^[a-zA-Z*]*=?")
   {
     m_TagMap["b"]      = std::make_pair(QRegExp("\\[b\\](.*)\\[/b\\]"),
                                         "<b>\\1</b>");
@@ -215,13 +265,12 @@ private:
 
 private:
 
-  QRegExp m_TagNameExp;
   TagMap m_TagMap;
   std::map<QString, QString> m_ColorMap;
 };
 
 
-QString convertToHTML(const QString &inputParam)
+static QString convert(const QString &inputParam)
 {
   // this code goes over the input string once and replaces all bbtags
   // it encounters. This function is called recursively for every replaced
@@ -229,11 +278,15 @@ QString convertToHTML(const QString &inputParam)
   //
   // This could be implemented simpler by applying a set of regular expressions
   // for each recognized bb-tag one after the other but that would probably be
-  // very inefficient (O(n^2)).
+  // very inefficient (O(n^2)). For the same reason tags are converted in place
+  // instead of working on a copy of the remaining input.
 
-  QString input = inputParam.mid(0).replace("\r\n", "<br/>");
+  QString input(inputParam);
+  input.replace("\r\n", "<br/>");
   input.replace("\\\"", "\"").replace("\\'", "'");
   QString result;
+  // the html is usually a bit longer than the bb code
+  result.reserve(input.size() + input.size() / 4);
   int lastBlock = 0;
   int pos = 0;
 
@@ -243,15 +296,15 @@ QString convertToHTML(const QString &inputParam)
     result.append(input.midRef(lastBlock, pos - lastBlock));
 
     if ((pos < (input.size() - 1)) && (input.at(pos + 1) == '/')) {
-       // skip invalid end tag
-      int tagEnd = input.indexOf(']',  pos) + 1;
-      pos = tagEnd;
+      // skip invalid end tag
+      int tagEnd = input.indexOf(']',  pos);
+      pos = tagEnd != -1 ? tagEnd + 1 : input.size();
     } else {
       // convert the tag and content if necessary
       int length = -1;
-      QString replacement = BBCodeMap::instance().convertTag(input.mid(pos), length);
+      QString replacement = BBCodeMap::instance().convertTag(input, pos, length);
       if (length != 0) {
-        result.append(convertToHTML(replacement));
+        result.append(convert(replacement));
         // length contains the number of characters in the original tag
         pos += length;
       } else {
@@ -268,5 +321,31 @@ QString convertToHTML(const QString &inputParam)
   return result;
 }
 
+
+QString convertToHTML(const QString &input)
+{
+  // the same descriptions get converted over and over, e.g. whenever a mod info dialog is opened
+  static QMutex s_CacheMutex;
+  static QCache<QByteArray, QString> s_Cache(CACHE_SIZE);
+
+  QByteArray key = QCryptographicHash::hash(
+        QByteArray::fromRawData(reinterpret_cast<const char*>(input.constData()), input.size() * sizeof(QChar)),
+        QCryptographicHash::Sha1);
+
+  {
+    QMutexLocker lock(&s_CacheMutex);
+    QString *cached = s_Cache.object(key);
+    if (cached != nullptr) {
+      return *cached;
+    }
+  }
+
+  QString result = convert(input);
+
+  QMutexLocker lock(&s_CacheMutex);
+  s_Cache.insert(key, new QString(result), result.size());
+  return result;
+}
+
 } // namespace BBCode
 
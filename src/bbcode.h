@@ -31,6 +31,7 @@ namespace BBCode {
  * @param input the input string with BB tags
  * @param replaceOccured if not nullptr, this parameter will be set to true if any bb tags were replaced
  * @return the same string in html representation
+ * @note recently converted strings are cached
  **/
 QString convertToHTML(const QString &input);
 
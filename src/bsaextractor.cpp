@@ -0,0 +1,227 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bsaextractor.h"
+
+#include "bsaarchive.h"
+
+#include <QDir>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+
+#include <algorithm>
+
+
+class BSAExtractWorker : public QRunnable
+{
+public:
+  BSAExtractWorker(BSAExtractor *extractor, bool testHashes)
+    : m_Extractor(extractor), m_TestHashes(testHashes) {}
+
+  virtual void run() { m_Extractor->work(m_TestHashes); }
+
+private:
+  BSAExtractor *m_Extractor;
+  bool m_TestHashes;
+};
+
+
+BSAExtractor::BSAExtractor(const QString &archivePath, const QString &outputDirectory, QObject *parent)
+  : QObject(parent)
+  , m_ArchivePath(archivePath)
+  , m_OutputDirectory(outputDirectory)
+  , m_Result(BSA::ERROR_NONE)
+  , m_InvalidHashes(false)
+{
+  m_ProgressTimer.setInterval(PROGRESS_INTERVAL);
+  connect(&m_ProgressTimer, SIGNAL(timeout()), this, SLOT(updateProgress()));
+}
+
+
+BSAExtractor::~BSAExtractor()
+{
+  cancel();
+  // the workers access members that are destroyed before the pool
+  m_Pool.waitForDone();
+}
+
+
+void BSAExtractor::start(int threadCount)
+{
+  if (threadCount <= 0) {
+    // extraction is bound by disk io soon enough, more threads don't help much
+    threadCount = qBound(1, QThread::idealThreadCount(), static_cast<int>(MAX_THREADS));
+  }
+
+  m_NextItem.store(0);
+  m_FilesDone.store(0);
+  m_TotalFiles.store(0);
+  m_Canceled.store(0);
+  m_Result = BSA::ERROR_NONE;
+  m_InvalidHashes = false;
+  m_Errors.clear();
+  m_CurrentFile.clear();
+
+  m_Pool.setMaxThreadCount(threadCount);
+  m_ActiveWorkers.store(threadCount);
+  for (int i = 0; i < threadCount; ++i) {
+    // one worker verifying the hashes is enough
+    m_Pool.start(new BSAExtractWorker(this, i == 0));
+  }
+  m_ProgressTimer.start();
+}
+
+
+void BSAExtractor::cancel()
+{
+  m_Canceled.store(1);
+}
+
+
+bool BSAExtractor::isRunning() const
+{
+  return m_ProgressTimer.isActive();
+}
+
+
+BSA::EErrorCode BSAExtractor::result() const
+{
+  QMutexLocker lock(&m_Mutex);
+  return m_Result;
+}
+
+
+bool BSAExtractor::invalidHashes() const
+{
+  QMutexLocker lock(&m_Mutex);
+  return m_InvalidHashes;
+}
+
+
+QStringList BSAExtractor::errors() const
+{
+  QMutexLocker lock(&m_Mutex);
+  return m_Errors;
+}
+
+
+void BSAExtractor::setError(BSA::EErrorCode error, const QString &description)
+{
+  QMutexLocker lock(&m_Mutex);
+  if (m_Result == BSA::ERROR_NONE) {
+    m_Result = error;
+  }
+  m_Errors.append(description);
+}
+
+
+void BSAExtractor::collectItems(const BSA::Folder::Ptr &folder, const QString &destination,
+                                std::vector<WorkItem> &items) const
+{
+  unsigned int numFiles = folder->getNumFiles();
+  for (unsigned int first = 0; first < numFiles; first += FILES_PER_ITEM) {
+    WorkItem item;
+    item.folder = folder;
+    item.destination = destination;
+    item.firstFile = first;
+    item.lastFile = std::min(first + FILES_PER_ITEM, numFiles);
+    items.push_back(item);
+  }
+
+  for (unsigned int i = 0; i < folder->getNumSubFolders(); ++i) {
+    BSA::Folder::Ptr subFolder = folder->getSubFolder(i);
+    collectItems(subFolder, destination + "/" + subFolder->getName().c_str(), items);
+  }
+}
+
+
+void BSAExtractor::work(bool testHashes)
+{
+  BSA::Archive archive;
+  BSA::EErrorCode result = archive.read(m_ArchivePath.toLocal8Bit().constData(), testHashes);
+  if (result == BSA::ERROR_INVALIDHASHES) {
+    QMutexLocker lock(&m_Mutex);
+    m_InvalidHashes = true;
+  } else if (result != BSA::ERROR_NONE) {
+    setError(result, tr("failed to read %1: %2").arg(m_ArchivePath).arg(result));
+    m_Canceled.store(1);
+  }
+
+  if (!m_Canceled.load()) {
+    // every worker reads the archive the same way so the work items line up
+    std::vector<WorkItem> items;
+    collectItems(archive.getRoot(), m_OutputDirectory, items);
+    int totalFiles = 0;
+    for (const WorkItem &item : items) {
+      totalFiles += item.lastFile - item.firstFile;
+    }
+    m_TotalFiles.store(totalFiles);
+
+    while (!m_Canceled.load()) {
+      int index = m_NextItem.fetchAndAddOrdered(1);
+      if (index >= static_cast<int>(items.size())) {
+        break;
+      }
+      const WorkItem &item = items[index];
+      QDir().mkpath(item.destination);
+      QByteArray destination = QDir::toNativeSeparators(item.destination).toLocal8Bit();
+
+      for (unsigned int i = item.firstFile; (i < item.lastFile) && !m_Canceled.load(); ++i) {
+        BSA::File::Ptr file = item.folder->getFile(i);
+        if (i == item.firstFile) {
+          QMutexLocker lock(&m_Mutex);
+          m_CurrentFile = file->getName().c_str();
+        }
+        BSA::EErrorCode fileResult = archive.extract(file, destination.constData());
+        if (fileResult != BSA::ERROR_NONE) {
+          setError(fileResult, tr("failed to extract %1: %2").arg(file->getName().c_str()).arg(fileResult));
+        }
+        m_FilesDone.fetchAndAddRelaxed(1);
+      }
+    }
+  }
+
+  m_ActiveWorkers.fetchAndAddOrdered(-1);
+}
+
+
+void BSAExtractor::updateProgress()
+{
+  int total = m_TotalFiles.load();
+  int percentage = total > 0 ? static_cast<int>((static_cast<qint64>(m_FilesDone.load()) * 100) / total) : 0;
+  QString currentFile;
+  {
+    QMutexLocker lock(&m_Mutex);
+    currentFile = m_CurrentFile;
+  }
+  emit progress(percentage, currentFile);
+
+  if (m_ActiveWorkers.load() == 0) {
+    m_ProgressTimer.stop();
+    m_Pool.waitForDone();
+    if (m_Canceled.load()) {
+      QMutexLocker lock(&m_Mutex);
+      if (m_Result == BSA::ERROR_NONE) {
+        m_Result = BSA::ERROR_CANCELED;
+      }
+    }
+    emit finished();
+  }
+}
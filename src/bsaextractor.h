@@ -0,0 +1,147 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BSAEXTRACTOR_H
+#define BSAEXTRACTOR_H
+
+#include "bsafolder.h"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+
+
+/**
+ * @brief extracts a whole bsa archive in the background
+ *
+ * The folders of the archive are split into chunks of files which are handed out to a pool
+ * of workers. Each worker uses its own instance of the archive so reads don't have to be
+ * serialized and never holds more than one file in memory at a time.
+ * All signals are emitted on the thread that owns the extractor, progress is reported at
+ * most every PROGRESS_INTERVAL milliseconds.
+ */
+class BSAExtractor : public QObject
+{
+
+  Q_OBJECT
+
+public:
+
+  /**
+   * @param archivePath path of the archive to extract
+   * @param outputDirectory directory to extract to, folders in the archive are created below it
+   * @param parent parent object
+   */
+  BSAExtractor(const QString &archivePath, const QString &outputDirectory, QObject *parent = nullptr);
+
+  /**
+   * @brief cancels extraction if it's still running and waits for the workers to stop
+   */
+  ~BSAExtractor();
+
+  /**
+   * @brief start extraction
+   * @param threadCount number of workers. 0 picks a number depending on the number of cores
+   */
+  void start(int threadCount = 0);
+
+  bool isRunning() const;
+
+  /**
+   * @return ERROR_NONE if all files were extracted, otherwise the first error that occured
+   */
+  BSA::EErrorCode result() const;
+
+  /**
+   * @return true if the archive contains invalid hashes. Extraction continues anyway
+   */
+  bool invalidHashes() const;
+
+  /**
+   * @return descriptions of all files that couldn't be extracted
+   */
+  QStringList errors() const;
+
+public slots:
+
+  /**
+   * @brief request the workers to stop. Files already being written are completed
+   */
+  void cancel();
+
+signals:
+
+  void progress(int percentage, const QString &fileName);
+
+  /**
+   * @brief emitted once all workers have stopped, whether they completed or not
+   */
+  void finished();
+
+private slots:
+
+  void updateProgress();
+
+private:
+
+  friend class BSAExtractWorker;
+
+  struct WorkItem {
+    BSA::Folder::Ptr folder;
+    QString destination;
+    unsigned int firstFile;
+    unsigned int lastFile;
+  };
+
+  static const unsigned int FILES_PER_ITEM = 32;
+  static const int MAX_THREADS = 4;
+  static const int PROGRESS_INTERVAL = 100;
+
+private:
+
+  void work(bool testHashes);
+  void collectItems(const BSA::Folder::Ptr &folder, const QString &destination, std::vector<WorkItem> &items) const;
+  void setError(BSA::EErrorCode error, const QString &description);
+
+private:
+
+  QString m_ArchivePath;
+  QString m_OutputDirectory;
+
+  QThreadPool m_Pool;
+  QTimer m_ProgressTimer;
+
+  QAtomicInt m_NextItem;
+  QAtomicInt m_FilesDone;
+  QAtomicInt m_TotalFiles;
+  QAtomicInt m_ActiveWorkers;
+  QAtomicInt m_Canceled;
+
+  mutable QMutex m_Mutex;
+  BSA::EErrorCode m_Result;
+  bool m_InvalidHashes;
+  QStringList m_Errors;
+  QString m_CurrentFile;
+
+};
+
+#endif // BSAEXTRACTOR_H
@@ -0,0 +1,413 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "datatreemodel.h"
+
+#include "modinfo.h"
+#include <utility.h>
+
+#include <QBrush>
+#include <QFont>
+
+#include <algorithm>
+#include <climits>
+
+
+using namespace MOBase;
+using namespace MOShared;
+
+
+static bool byName(const DirectoryEntry *lhs, const DirectoryEntry *rhs)
+{
+  return _wcsicmp(lhs->getName().c_str(), rhs->getName().c_str()) < 0;
+}
+
+static bool fileByName(const FileEntry::Ptr &lhs, const FileEntry::Ptr &rhs)
+{
+  return _wcsicmp(lhs->getName().c_str(), rhs->getName().c_str()) < 0;
+}
+
+
+DataTreeModel::DataTreeModel(QObject *parent)
+  : QAbstractItemModel(parent)
+  , m_Root(nullptr)
+  , m_ConflictsOnly(false)
+{
+}
+
+
+void DataTreeModel::refresh(DirectoryEntry *root, bool conflictsOnly)
+{
+  beginResetModel();
+
+  m_Root = root;
+  m_ConflictsOnly = conflictsOnly;
+  m_Nodes.clear();
+  m_Conflicted.clear();
+
+  if (m_Root != nullptr) {
+    DirectoryNode rootNode;
+    rootNode.name = m_Root->getName();
+    rootNode.parent = -1;
+    rootNode.row = 0;
+    rootNode.populated = false;
+    m_Nodes.push_back(rootNode);
+  }
+
+  endResetModel();
+}
+
+
+bool DataTreeModel::isConflicted(const DirectoryEntry *directory)
+{
+  // evaluated when the parent is populated instead of walking the whole tree on refresh.
+  // The search stops at the first conflict so large directories are rarely read completely
+  auto iter = m_Conflicted.find(directory);
+  if (iter != m_Conflicted.end()) {
+    return *iter;
+  }
+
+  std::vector<FileEntry::Ptr> files = directory->getFiles();
+  bool conflicted = std::any_of(files.begin(), files.end(), [] (const FileEntry::Ptr &file) {
+    return !file->getAlternatives().empty();
+  });
+
+  if (!conflicted) {
+    std::vector<DirectoryEntry*>::const_iterator current, end;
+    directory->getSubDirectories(current, end);
+    for (; (current != end) && !conflicted; ++current) {
+      conflicted = isConflicted(*current);
+    }
+  }
+
+  m_Conflicted.insert(directory, conflicted);
+  return conflicted;
+}
+
+
+DirectoryEntry *DataTreeModel::resolveDirectory(int node) const
+{
+  if ((m_Root == nullptr) || (node < 0)) {
+    return nullptr;
+  }
+
+  // nodes only store their name so they can't dangle when the directory structure
+  // is modified. Walk up to the root and then back down by name
+  std::vector<const std::wstring*> path;
+  for (int current = node; m_Nodes[current].parent != -1; current = m_Nodes[current].parent) {
+    path.push_back(&m_Nodes[current].name);
+  }
+
+  DirectoryEntry *result = m_Root;
+  for (auto iter = path.rbegin(); (iter != path.rend()) && (result != nullptr); ++iter) {
+    result = result->findSubDirectory(**iter);
+  }
+  return result;
+}
+
+
+void DataTreeModel::populate(int node)
+{
+  DirectoryEntry *directory = resolveDirectory(node);
+  if (directory == nullptr) {
+    m_Nodes[node].populated = true;
+    return;
+  }
+
+  std::vector<DirectoryEntry*> subDirectories;
+  {
+    std::vector<DirectoryEntry*>::const_iterator current, end;
+    directory->getSubDirectories(current, end);
+    for (; current != end; ++current) {
+      if (m_ConflictsOnly ? isConflicted(*current) : !(*current)->isEmpty()) {
+        subDirectories.push_back(*current);
+      }
+    }
+  }
+  std::sort(subDirectories.begin(), subDirectories.end(), byName);
+
+  std::vector<FileEntry::Ptr> files = directory->getFiles();
+  if (m_ConflictsOnly) {
+    files.erase(std::remove_if(files.begin(), files.end(), [] (const FileEntry::Ptr &file) {
+                  return file->getAlternatives().empty();
+                }), files.end());
+  }
+  std::sort(files.begin(), files.end(), fileByName);
+
+  int count = static_cast<int>(subDirectories.size() + files.size());
+  QModelIndex parentIndex = node == 0 ? index(0, 0)
+                                      : createIndex(m_Nodes[node].row, 0, static_cast<quintptr>(m_Nodes[node].parent));
+  if (count > 0) {
+    beginInsertRows(parentIndex, 0, count - 1);
+  }
+
+  // m_Nodes may be reallocated below so no references into it
+  std::vector<int> subDirectoryNodes;
+  for (size_t i = 0; i < subDirectories.size(); ++i) {
+    DirectoryNode child;
+    child.name = subDirectories[i]->getName();
+    child.parent = node;
+    child.row = static_cast<int>(i);
+    child.populated = false;
+    subDirectoryNodes.push_back(static_cast<int>(m_Nodes.size()));
+    m_Nodes.push_back(child);
+  }
+
+  DirectoryNode &current = m_Nodes[node];
+  current.subDirectories.swap(subDirectoryNodes);
+  current.files.reserve(files.size());
+  for (const FileEntry::Ptr &file : files) {
+    current.files.push_back(file->getIndex());
+  }
+  current.populated = true;
+
+  if (count > 0) {
+    endInsertRows();
+  }
+}
+
+
+int DataTreeModel::directoryNode(const QModelIndex &index) const
+{
+  if (!index.isValid() || m_Nodes.empty()) {
+    return -1;
+  }
+  if (index.internalId() == NO_PARENT) {
+    return 0;
+  }
+
+  const DirectoryNode &parent = m_Nodes[index.internalId()];
+  if (index.row() < static_cast<int>(parent.subDirectories.size())) {
+    return parent.subDirectories[index.row()];
+  } else {
+    return -1;
+  }
+}
+
+
+FileEntry::Ptr DataTreeModel::file(const QModelIndex &index) const
+{
+  if (!index.isValid() || (index.internalId() == NO_PARENT) || (m_Root == nullptr)) {
+    return FileEntry::Ptr();
+  }
+
+  const DirectoryNode &parent = m_Nodes[index.internalId()];
+  int fileRow = index.row() - static_cast<int>(parent.subDirectories.size());
+  if ((fileRow < 0) || (fileRow >= static_cast<int>(parent.files.size()))) {
+    return FileEntry::Ptr();
+  }
+  // null if the file was removed from the structure in the meantime
+  return m_Root->getFileRegister()->getFile(parent.files[fileRow]);
+}
+
+
+bool DataTreeModel::isFile(const QModelIndex &index) const
+{
+  return index.isValid()
+      && (index.internalId() != NO_PARENT)
+      && (directoryNode(index) == -1);
+}
+
+
+QModelIndex DataTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+  if (!hasIndex(row, column, parent)) {
+    return QModelIndex();
+  }
+
+  if (!parent.isValid()) {
+    return createIndex(row, column, NO_PARENT);
+  } else {
+    return createIndex(row, column, static_cast<quintptr>(directoryNode(parent)));
+  }
+}
+
+
+QModelIndex DataTreeModel::parent(const QModelIndex &child) const
+{
+  if (!child.isValid() || (child.internalId() == NO_PARENT)) {
+    return QModelIndex();
+  }
+
+  int node = static_cast<int>(child.internalId());
+  if (node == 0) {
+    return createIndex(0, 0, NO_PARENT);
+  } else {
+    return createIndex(m_Nodes[node].row, 0, static_cast<quintptr>(m_Nodes[node].parent));
+  }
+}
+
+
+int DataTreeModel::rowCount(const QModelIndex &parent) const
+{
+  if (!parent.isValid()) {
+    return m_Nodes.empty() ? 0 : 1;
+  }
+  if (parent.column() > 0) {
+    return 0;
+  }
+
+  int node = directoryNode(parent);
+  if (node == -1) {
+    return 0;
+  }
+  return static_cast<int>(m_Nodes[node].subDirectories.size() + m_Nodes[node].files.size());
+}
+
+
+int DataTreeModel::columnCount(const QModelIndex&) const
+{
+  return COL_LASTCOLUMN + 1;
+}
+
+
+bool DataTreeModel::hasChildren(const QModelIndex &parent) const
+{
+  if (!parent.isValid()) {
+    return !m_Nodes.empty();
+  }
+  if (parent.column() > 0) {
+    return false;
+  }
+
+  int node = directoryNode(parent);
+  if (node == -1) {
+    return false;
+  }
+  // only directories with content are listed so unpopulated ones always have children
+  return !m_Nodes[node].populated || (rowCount(parent) > 0);
+}
+
+
+bool DataTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+  int node = directoryNode(parent);
+  return (node != -1) && !m_Nodes[node].populated;
+}
+
+
+void DataTreeModel::fetchMore(const QModelIndex &parent)
+{
+  int node = directoryNode(parent);
+  if ((node != -1) && !m_Nodes[node].populated) {
+    populate(node);
+  }
+}
+
+
+QString DataTreeModel::fileOrigin(const FileEntry::Ptr &file) const
+{
+  bool isArchive = false;
+  FilesOrigin &origin = m_Root->getOriginByID(file->getOrigin(isArchive));
+  QString source("data");
+  unsigned int modIndex = ModInfo::getIndex(ToQString(origin.getName()));
+  if (modIndex != UINT_MAX) {
+    source = ModInfo::getByIndex(modIndex)->name();
+  }
+
+  const std::wstring &archive = file->getArchive();
+  if (archive.length() != 0) {
+    source.append(" (").append(ToQString(archive)).append(")");
+  }
+  return source;
+}
+
+
+QVariant DataTreeModel::fileData(const FileEntry::Ptr &file, int column, int role) const
+{
+  switch (role) {
+    case Qt::DisplayRole: {
+      return column == COL_NAME ? ToQString(file->getName()) : fileOrigin(file);
+    } break;
+    case Qt::FontRole: {
+      QFont font;
+      if (file->isFromArchive()) {
+        font.setItalic(true);
+      } else if (ToQString(file->getName()).endsWith(ModInfo::s_HiddenExt)) {
+        font.setStrikeOut(true);
+      } else {
+        return QVariant();
+      }
+      return font;
+    } break;
+    case Qt::ForegroundRole: {
+      if ((column == COL_ORIGIN) && !file->getAlternatives().empty()) {
+        return QBrush(Qt::red);
+      }
+    } break;
+    case Qt::ToolTipRole: {
+      if (column != COL_ORIGIN) {
+        return QVariant();
+      }
+      const std::vector<int> &alternatives = file->getAlternatives();
+      if (alternatives.empty()) {
+        return tr("No conflict");
+      }
+      QStringList origins;
+      for (int originID : alternatives) {
+        origins.append(QString("<span style=\"white-space: nowrap;\"><i>%1</i></span>")
+                       .arg(ToQString(m_Root->getOriginByID(originID).getName())));
+      }
+      return tr("Also in: <br>") + origins.join(" , ");
+    } break;
+    case Qt::UserRole: {
+      return column == COL_NAME ? QVariant(ToQString(file->getFullPath()))
+                                : QVariant(fileOrigin(file));
+    } break;
+    case Qt::UserRole + 1: {
+      return column == COL_NAME ? QVariant(file->isFromArchive())
+                                : QVariant(file->getOrigin());
+    } break;
+  }
+  return QVariant();
+}
+
+
+QVariant DataTreeModel::data(const QModelIndex &index, int role) const
+{
+  if (!index.isValid()) {
+    return QVariant();
+  }
+
+  int node = directoryNode(index);
+  if (node != -1) {
+    if ((role == Qt::DisplayRole) && (index.column() == COL_NAME)) {
+      return ToQString(m_Nodes[node].name);
+    }
+    return QVariant();
+  }
+
+  FileEntry::Ptr entry = file(index);
+  if (entry.get() == nullptr) {
+    return QVariant();
+  }
+  return fileData(entry, index.column(), role);
+}
+
+
+QVariant DataTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if ((orientation == Qt::Horizontal) && (role == Qt::DisplayRole)) {
+    switch (section) {
+      case COL_NAME:   return tr("File");
+      case COL_ORIGIN: return tr("Mod");
+    }
+  }
+  return QAbstractItemModel::headerData(section, orientation, role);
+}
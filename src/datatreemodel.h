@@ -0,0 +1,120 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DATATREEMODEL_H
+#define DATATREEMODEL_H
+
+#include "directoryentry.h"
+
+#include <QAbstractItemModel>
+#include <QHash>
+
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief model of the virtual data directory as displayed in the data tab
+ *
+ * Items are read directly from the DirectoryEntry structure. Only directory nodes
+ * are stored by the model, with their position in the vector of nodes used as the
+ * internal id of their children. The children of a directory are only read once
+ * the directory is fetched (expanded).
+ **/
+class DataTreeModel : public QAbstractItemModel
+{
+
+  Q_OBJECT
+
+public:
+
+  enum EColumn {
+    COL_NAME = 0,
+    COL_ORIGIN,
+
+    COL_LASTCOLUMN = COL_ORIGIN
+  };
+
+public:
+
+  explicit DataTreeModel(QObject *parent = nullptr);
+
+  /**
+   * @brief discard all items and rebuild the top level from a directory structure
+   *
+   * @param root the virtual data directory. The model doesn't take ownership but this has to
+   *             stay valid until the next refresh
+   * @param conflictsOnly if true, only files that are provided by more than one origin
+   *                      and the directories containing them are displayed
+   **/
+  void refresh(MOShared::DirectoryEntry *root, bool conflictsOnly);
+
+  virtual QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+  virtual QModelIndex parent(const QModelIndex &child) const;
+  virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
+  virtual int columnCount(const QModelIndex &parent = QModelIndex()) const;
+  virtual bool hasChildren(const QModelIndex &parent = QModelIndex()) const;
+  virtual bool canFetchMore(const QModelIndex &parent) const;
+  virtual void fetchMore(const QModelIndex &parent);
+  virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+  virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+  /**
+   * @return true if the index refers to a file, false if it's a directory
+   */
+  bool isFile(const QModelIndex &index) const;
+
+private:
+
+  struct DirectoryNode {
+    std::wstring name;
+    int parent;
+    int row;
+    bool populated;
+    std::vector<int> subDirectories;
+    std::vector<MOShared::FileEntry::Index> files;
+  };
+
+  static const quintptr NO_PARENT = ~static_cast<quintptr>(0);
+
+private:
+
+  int directoryNode(const QModelIndex &index) const;
+  MOShared::DirectoryEntry *resolveDirectory(int node) const;
+  MOShared::FileEntry::Ptr file(const QModelIndex &index) const;
+  bool isConflicted(const MOShared::DirectoryEntry *directory);
+  void populate(int node);
+
+  QVariant fileData(const MOShared::FileEntry::Ptr &file, int column, int role) const;
+  QString fileOrigin(const MOShared::FileEntry::Ptr &file) const;
+
+private:
+
+  MOShared::DirectoryEntry *m_Root;
+  bool m_ConflictsOnly;
+
+  std::vector<DirectoryNode> m_Nodes;
+
+  // whether a directory contains at least one conflicted file (in any subdirectory). Only
+  // filled for directories that were looked at since the last refresh
+  QHash<const MOShared::DirectoryEntry*, bool> m_Conflicted;
+
+};
+
+#endif // DATATREEMODEL_H
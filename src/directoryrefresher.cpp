@@ -23,6 +23,8 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "utility.h"
 #include "report.h"
 #include "modinfo.h"
+#include "phasetracer.h"
+#include <runtimemetrics.h>
 
 #include <QApplication>
 #include <QDir>
@@ -138,6 +140,10 @@ void DirectoryRefresher::addModToStructure(DirectoryEntry *directoryStructure
 
 void DirectoryRefresher::refresh()
 {
+  TraceSpan span("DirectoryRefresher::refresh");
+  static MetricHistogram &s_Latency = RuntimeMetrics::instance().histogram("directory.refresh");
+  ScopedLatency latency(s_Latency);
+
   QMutexLocker locker(&m_RefreshLock);
 
   delete m_DirectoryStructure;
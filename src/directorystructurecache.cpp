@@ -0,0 +1,138 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "directorystructurecache.h"
+
+#include <directoryentry.h>
+#include <runtimemetrics.h>
+
+using namespace MOShared;
+
+
+// rough memory use of a file in a directory structure: the entry itself, its slot in the
+// register and in the parent directory plus the names
+static const qint64 BYTES_PER_FILE = 320;
+
+
+DirectoryStructureCache::DirectoryStructureCache()
+  : m_Budget(0)
+  , m_Size(0)
+{
+}
+
+
+DirectoryStructureCache::~DirectoryStructureCache()
+{
+  clear();
+}
+
+
+void DirectoryStructureCache::setBudget(qint64 bytes)
+{
+  m_Budget = bytes;
+  enforceBudget();
+}
+
+
+void DirectoryStructureCache::store(const QString &profileName, const QByteArray &fingerprint,
+                                    DirectoryEntry *structure, const std::set<QString> &origins)
+{
+  if (m_Budget <= 0) {
+    delete structure;
+    return;
+  }
+
+  Entry entry;
+  entry.profileName = profileName;
+  entry.fingerprint = fingerprint;
+  entry.structure = structure;
+  entry.origins = origins;
+  entry.size = static_cast<qint64>(structure->getFileRegister()->size()) * BYTES_PER_FILE;
+
+  // only one structure per profile, the older one can't be more current
+  for (auto iter = m_Entries.begin(); iter != m_Entries.end(); ++iter) {
+    if (iter->profileName == profileName) {
+      m_Size -= iter->size;
+      delete iter->structure;
+      m_Entries.erase(iter);
+      break;
+    }
+  }
+
+  m_Entries.push_front(entry);
+  m_Size += entry.size;
+  enforceBudget();
+}
+
+
+DirectoryEntry *DirectoryStructureCache::take(const QString &profileName, const QByteArray &fingerprint)
+{
+  static MetricCounter &s_Hits = RuntimeMetrics::instance().counter("directoryCache.hits");
+  static MetricCounter &s_Misses = RuntimeMetrics::instance().counter("directoryCache.misses");
+
+  for (auto iter = m_Entries.begin(); iter != m_Entries.end(); ++iter) {
+    if (iter->profileName == profileName) {
+      if (iter->fingerprint != fingerprint) {
+        // mods or archives changed since the structure was built
+        break;
+      }
+      DirectoryEntry *result = iter->structure;
+      m_Size -= iter->size;
+      m_Entries.erase(iter);
+      s_Hits.increment();
+      return result;
+    }
+  }
+  s_Misses.increment();
+  return nullptr;
+}
+
+
+void DirectoryStructureCache::invalidate(const QString &originName)
+{
+  for (auto iter = m_Entries.begin(); iter != m_Entries.end();) {
+    if (iter->origins.find(originName) != iter->origins.end()) {
+      m_Size -= iter->size;
+      delete iter->structure;
+      iter = m_Entries.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+
+void DirectoryStructureCache::clear()
+{
+  for (const Entry &entry : m_Entries) {
+    delete entry.structure;
+  }
+  m_Entries.clear();
+  m_Size = 0;
+}
+
+
+void DirectoryStructureCache::enforceBudget()
+{
+  while (!m_Entries.empty() && (m_Size > m_Budget)) {
+    m_Size -= m_Entries.back().size;
+    delete m_Entries.back().structure;
+    m_Entries.pop_back();
+  }
+}
@@ -0,0 +1,105 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DIRECTORYSTRUCTURECACHE_H
+#define DIRECTORYSTRUCTURECACHE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+#include <list>
+#include <set>
+
+namespace MOShared { class DirectoryEntry; }
+
+
+/**
+ * @brief keeps recently used directory structures around so switching back to a profile
+ *        doesn't require a full rebuild
+ *
+ * Structures are identified by the profile name and a fingerprint of everything the
+ * refresher used to build them. The least recently stored structures are deleted once
+ * the estimated memory use exceeds the budget.
+ */
+class DirectoryStructureCache
+{
+
+public:
+
+  DirectoryStructureCache();
+
+  ~DirectoryStructureCache();
+
+  /**
+   * @param bytes approximate amount of memory the cached structures may use. 0 disables
+   *              the cache
+   */
+  void setBudget(qint64 bytes);
+
+  /**
+   * @brief add a structure to the cache. The cache takes ownership
+   * @param profileName name of the profile the structure was built for
+   * @param fingerprint fingerprint of the mods and archives the structure contains
+   * @param structure the structure
+   * @param origins names of the origins (mods) in the structure
+   */
+  void store(const QString &profileName, const QByteArray &fingerprint,
+             MOShared::DirectoryEntry *structure, const std::set<QString> &origins);
+
+  /**
+   * @brief remove a matching structure from the cache
+   * @return the structure, the caller takes ownership. nullptr if there is no match
+   */
+  MOShared::DirectoryEntry *take(const QString &profileName, const QByteArray &fingerprint);
+
+  /**
+   * @brief drop all structures that contain the specified origin
+   */
+  void invalidate(const QString &originName);
+
+  void clear();
+
+private:
+
+  struct Entry {
+    QString profileName;
+    QByteArray fingerprint;
+    MOShared::DirectoryEntry *structure;
+    std::set<QString> origins;
+    qint64 size;
+  };
+
+private:
+
+  DirectoryStructureCache(const DirectoryStructureCache&);
+  DirectoryStructureCache &operator=(const DirectoryStructureCache&);
+
+  void enforceBudget();
+
+private:
+
+  // most recently stored first
+  std::list<Entry> m_Entries;
+  qint64 m_Budget;
+  qint64 m_Size;
+
+};
+
+#endif // DIRECTORYSTRUCTURECACHE_H
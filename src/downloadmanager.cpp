@@ -30,6 +30,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "bbcode.h"
 #include <utility.h>
 #include <report.h>
+#include <runtimemetrics.h>
 
 #include <QTimer>
 #include <QFileInfo>
@@ -41,6 +42,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QTextDocument>
 
 #include <boost/bind.hpp>
+#include <algorithm>
 #include <regex>
 
 
@@ -172,9 +174,11 @@ QString DownloadManager::DownloadInfo::currentURL()
 
 DownloadManager::DownloadManager(NexusInterface *nexusInterface, QObject *parent)
   : IDownloadManager(parent), m_NexusInterface(nexusInterface), m_DirWatcher(), m_ShowHidden(false),
-    m_DateExpression("/Date\\((\\d+)\\)/")
+    m_DateExpression("/Date\\((\\d+)\\)/"), m_Quiescing(false)
 {
   connect(&m_DirWatcher, SIGNAL(directoryChanged(QString)), this, SLOT(directoryChanged(QString)));
+  m_QuiesceTimer.setSingleShot(true);
+  connect(&m_QuiesceTimer, SIGNAL(timeout()), this, SLOT(quiesceTimeout()));
 }
 
 
@@ -197,38 +201,96 @@ bool DownloadManager::downloadsInProgress()
   return false;
 }
 
-void DownloadManager::pauseAll()
+
+bool DownloadManager::isActiveState(DownloadState state)
 {
-  // first loop: pause all downloads
+  return (state < STATE_CANCELED)
+      || (state == STATE_FETCHINGFILEINFO)
+      || (state == STATE_FETCHINGMODINFO);
+}
+
+
+QFuture<bool> DownloadManager::pauseAll(int timeout)
+{
+  if (m_Quiescing) {
+    // a pause is already in progress, the caller can share its result
+    return m_QuiesceResult.future();
+  }
+
+  m_QuiesceResult = QFutureInterface<bool>();
+  m_QuiesceResult.reportStarted();
+  m_Quiescing = true;
+
   for (int i = 0; i < m_ActiveDownloads.count(); ++i) {
     if (m_ActiveDownloads[i]->m_State < STATE_READY) {
       pauseDownload(i);
     }
   }
 
-  ::Sleep(100);
-
-  bool done = false;
-  QTime startTime = QTime::currentTime();
-  // further loops: busy waiting for all downloads to complete. This could be neater...
-  while (!done && (startTime.secsTo(QTime::currentTime()) < 5)) {
-    QCoreApplication::processEvents();
-    done = true;
-    foreach (DownloadInfo *info, m_ActiveDownloads) {
-      if ((info->m_State < STATE_CANCELED) ||
-          (info->m_State == STATE_FETCHINGFILEINFO) ||
-          (info->m_State == STATE_FETCHINGMODINFO)) {
-        done = false;
-        break;
-      }
+  QFuture<bool> result = m_QuiesceResult.future();
+  // pauseDownload may already have stopped everything synchronously
+  checkQuiesced();
+  if (m_Quiescing) {
+    m_QuiesceTimer.start(timeout);
+  }
+  return result;
+}
+
+
+void DownloadManager::checkQuiesced()
+{
+  if (!m_Quiescing) {
+    return;
+  }
+  foreach (DownloadInfo *info, m_ActiveDownloads) {
+    if (isActiveState(info->m_State)) {
+      return;
     }
-    if (!done) {
-      ::Sleep(100);
+  }
+  finishQuiesce(true);
+}
+
+
+void DownloadManager::quiesceTimeout()
+{
+  if (!m_Quiescing) {
+    return;
+  }
+  qWarning("downloads didn't stop in time, aborting remaining transfers");
+  finishQuiesce(false);
+  foreach (DownloadInfo *info, m_ActiveDownloads) {
+    if ((info->m_State == STATE_PAUSING) || (info->m_State == STATE_CANCELING)) {
+      // abort causes the reply to finish, which updates state and meta file
+      setState(info, info->m_State == STATE_PAUSING ? STATE_PAUSED : STATE_CANCELED);
     }
   }
 }
 
 
+void DownloadManager::finishQuiesce(bool complete)
+{
+  m_QuiesceTimer.stop();
+  m_Quiescing = false;
+
+  foreach (DownloadInfo *info, m_PendingMetaFiles) {
+    createMetaFile(info);
+  }
+  m_PendingMetaFiles.clear();
+
+  m_QuiesceResult.reportResult(complete);
+  m_QuiesceResult.reportFinished();
+}
+
+
+void DownloadManager::forgetDownload(DownloadInfo *info)
+{
+  // make sure nothing gets lost if the download disappears while meta files are deferred
+  if (m_PendingMetaFiles.remove(info)) {
+    createMetaFile(info);
+  }
+}
+
+
 void DownloadManager::setOutputDirectory(const QString &outputDirectory)
 {
   QStringList directories = m_DirWatcher.directories();
@@ -247,6 +309,12 @@ void DownloadManager::setPreferredServers(const std::map<QString, int> &preferre
 }
 
 
+void DownloadManager::setServerSpeeds(const std::map<QString, int> &serverSpeeds)
+{
+  m_ServerSpeeds = serverSpeeds;
+}
+
+
 void DownloadManager::setSupportedExtensions(const QStringList &extensions)
 {
   m_SupportedExtensions = extensions;
@@ -267,6 +335,7 @@ void DownloadManager::refreshList()
     // remove finished downloads
     for (QVector<DownloadInfo*>::iterator iter = m_ActiveDownloads.begin(); iter != m_ActiveDownloads.end();) {
       if (((*iter)->m_State == STATE_READY) || ((*iter)->m_State == STATE_INSTALLED) || ((*iter)->m_State == STATE_UNINSTALLED)) {
+        forgetDownload(*iter);
         delete *iter;
         iter = m_ActiveDownloads.erase(iter);
       } else {
@@ -562,6 +631,7 @@ void DownloadManager::removeDownload(int index, bool deleteFile)
       for (QVector<DownloadInfo*>::iterator iter = m_ActiveDownloads.begin(); iter != m_ActiveDownloads.end();) {
         if ((*iter)->m_State >= minState) {
           removeFile(index, deleteFile);
+          forgetDownload(*iter);
           delete *iter;
           iter = m_ActiveDownloads.erase(iter);
         } else {
@@ -576,6 +646,7 @@ void DownloadManager::removeDownload(int index, bool deleteFile)
       }
 
       removeFile(index, deleteFile);
+      forgetDownload(m_ActiveDownloads.at(index));
       delete m_ActiveDownloads.at(index);
       m_ActiveDownloads.erase(m_ActiveDownloads.begin() + index);
     }
@@ -949,7 +1020,7 @@ void DownloadManager::setState(DownloadManager::DownloadInfo *info, DownloadMana
       m_RequestIDs.insert(m_NexusInterface->requestFiles(info->m_FileInfo->modID, this, info->m_DownloadID, QString()));
     } break;
     case STATE_READY: {
-      createMetaFile(info);
+      writeMetaFile(info);
       emit downloadComplete(row);
     } break;
     default: /* NOP */ break;
@@ -1009,7 +1080,10 @@ void DownloadManager::downloadReadyRead()
   try {
     DownloadInfo *info = findDownload(this->sender());
     if (info != nullptr) {
-      info->m_Output.write(info->m_Reply->readAll());
+      static MOShared::MetricCounter &s_Bytes = MOShared::RuntimeMetrics::instance().counter("download.bytesReceived");
+      QByteArray data = info->m_Reply->readAll();
+      s_Bytes.increment(data.size());
+      info->m_Output.write(data);
     }
   } catch (const std::bad_alloc&) {
     reportError(tr("Memory allocation error (in processing downloaded data)."));
@@ -1017,6 +1091,17 @@ void DownloadManager::downloadReadyRead()
 }
 
 
+void DownloadManager::writeMetaFile(DownloadInfo *info)
+{
+  if (m_Quiescing) {
+    // written in one go once all downloads are paused
+    m_PendingMetaFiles.insert(info);
+  } else {
+    createMetaFile(info);
+  }
+}
+
+
 void DownloadManager::createMetaFile(DownloadInfo *info)
 {
   QSettings metaFile(QString("%1.meta").arg(info->m_Output.fileName()), QSettings::IniFormat);
@@ -1207,7 +1292,8 @@ void DownloadManager::nxmFileInfoAvailable(int modID, int fileID, QVariant userD
   m_RequestIDs.insert(m_NexusInterface->requestDownloadURL(modID, fileID, this, qVariantFromValue(test), QString()));
 }
 
-static int evaluateFileInfoMap(const QVariantMap &map, const std::map<QString, int> &preferredServers)
+static int evaluateFileInfoMap(const QVariantMap &map, const std::map<QString, int> &preferredServers,
+                               const std::map<QString, int> &serverSpeeds)
 {
   int result = 0;
 
@@ -1226,15 +1312,24 @@ static int evaluateFileInfoMap(const QVariantMap &map, const std::map<QString, i
     result += 100 + preference->second * 20;
   }
 
+  // one point per 100KiB/s we measured in earlier downloads. capped so it doesn't override
+  // the user preference
+  auto speed = serverSpeeds.find(map["Name"].toString());
+  if (speed != serverSpeeds.end()) {
+    result += std::min(speed->second / (100 * 1024), 50);
+  }
+
   if (map["IsPremium"].toBool()) result += 5;
 
   return result;
 }
 
 // sort function to sort by best download server
-bool DownloadManager::ServerByPreference(const std::map<QString, int> &preferredServers, const QVariant &LHS, const QVariant &RHS)
+bool DownloadManager::ServerByPreference(const std::map<QString, int> &preferredServers, const std::map<QString, int> &serverSpeeds,
+                                         const QVariant &LHS, const QVariant &RHS)
 {
-  return evaluateFileInfoMap(LHS.toMap(), preferredServers) > evaluateFileInfoMap(RHS.toMap(), preferredServers);
+  return evaluateFileInfoMap(LHS.toMap(), preferredServers, serverSpeeds)
+       > evaluateFileInfoMap(RHS.toMap(), preferredServers, serverSpeeds);
 }
 
 int DownloadManager::startDownloadURLs(const QStringList &urls)
@@ -1283,7 +1378,7 @@ void DownloadManager::nxmDownloadURLsAvailable(int modID, int fileID, QVariant u
     return;
   }
 
-  std::sort(resultList.begin(), resultList.end(), boost::bind(&DownloadManager::ServerByPreference, m_PreferredServers, _1, _2));
+  std::sort(resultList.begin(), resultList.end(), boost::bind(&DownloadManager::ServerByPreference, boost::cref(m_PreferredServers), boost::cref(m_ServerSpeeds), _1, _2));
 
   info->userData["downloadMap"] = resultList;
 
@@ -1312,6 +1407,7 @@ void DownloadManager::nxmRequestFailed(int modID, int fileID, QVariant userData,
     if (info->m_FileInfo->modID == modID) {
       if (info->m_State < STATE_FETCHINGMODINFO) {
         m_ActiveDownloads.erase(iter);
+        forgetDownload(info);
         delete info;
       } else {
         setState(info, STATE_READY);
@@ -1377,14 +1473,23 @@ void DownloadManager::downloadFinished()
     if (info->m_State == STATE_CANCELED) {
       emit aboutToUpdate();
       info->m_Output.remove();
+      m_PendingMetaFiles.remove(info);
       delete info;
       m_ActiveDownloads.erase(m_ActiveDownloads.begin() + index);
       emit update(-1);
     } else if (info->isPausedState()) {
       info->m_Output.close();
-      createMetaFile(info);
+      writeMetaFile(info);
       emit update(index);
     } else {
+      static MOShared::MetricCounter &s_Completed = MOShared::RuntimeMetrics::instance().counter("download.completed");
+      static MOShared::MetricGauge &s_Throughput = MOShared::RuntimeMetrics::instance().gauge("download.lastThroughputKiBps");
+      s_Completed.increment();
+      int elapsed = info->m_StartTime.msecsTo(QTime::currentTime());
+      if (elapsed > 0) {
+        s_Throughput.set(((info->m_Output.size() - info->m_ResumePos) * 1000 / 1024) / elapsed);
+      }
+
       QString url = info->m_Urls[info->m_CurrentUrl];
       if (info->m_FileInfo->userData.contains("downloadMap")) {
         foreach (const QVariant &server, info->m_FileInfo->userData["downloadMap"].toList()) {
@@ -1424,10 +1529,11 @@ void DownloadManager::downloadFinished()
     reply->close();
     reply->deleteLater();
 
-    if ((info->m_Tries > 0) && error) {
+    if ((info->m_Tries > 0) && error && !m_Quiescing) {
       --info->m_Tries;
       resumeDownloadInt(index);
     }
+    checkQuiesced();
   } else {
     qWarning("no download index %d", index);
   }
@@ -34,6 +34,10 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QStringList>
 #include <QFileSystemWatcher>
 #include <QSettings>
+#include <QSet>
+#include <QTimer>
+#include <QFuture>
+#include <QFutureInterface>
 
 namespace MOBase { class IPluginGame; }
 
@@ -151,6 +155,11 @@ public:
    */
   void setPreferredServers(const std::map<QString, int> &preferredServers);
 
+  /**
+   * @brief set the average download speed measured for each server, in bytes per second
+   */
+  void setServerSpeeds(const std::map<QString, int> &serverSpeeds);
+
   /**
    * @brief set the list of supported extensions
    * @param extensions list of supported extensions
@@ -325,7 +334,8 @@ public:
    * @param RHS
    * @return
    */
-  static bool ServerByPreference(const std::map<QString, int> &preferredServers, const QVariant &LHS, const QVariant &RHS);
+  static bool ServerByPreference(const std::map<QString, int> &preferredServers, const std::map<QString, int> &serverSpeeds,
+                                 const QVariant &LHS, const QVariant &RHS);
 
 
   virtual int startDownloadURLs(const QStringList &urls);
@@ -341,7 +351,15 @@ public:
    */
   int indexByName(const QString &fileName) const;
 
-  void pauseAll();
+  /**
+   * @brief pause all running downloads
+   * this doesn't block. Meta files of all affected downloads are written in one batch
+   * once every download has stopped
+   * @param timeout time (in milliseconds) after which remaining transfers are aborted forcefully
+   * @return a future that is finished once no download is active anymore. The result is
+   *         false if the timeout was reached
+   */
+  QFuture<bool> pauseAll(int timeout = 5000);
 
 signals:
 
@@ -427,10 +445,12 @@ private slots:
   void downloadError(QNetworkReply::NetworkError error);
   void metaDataChanged();
   void directoryChanged(const QString &dirctory);
+  void quiesceTimeout();
 
 private:
 
   void createMetaFile(DownloadInfo *info);
+  void writeMetaFile(DownloadInfo *info);
 
 public:
 
@@ -480,6 +500,13 @@ private:
 
   static QString getFileTypeString(int fileType);
 
+  static bool isActiveState(DownloadState state);
+
+  void forgetDownload(DownloadInfo *info);
+
+  void checkQuiesced();
+  void finishQuiesce(bool complete);
+
 private:
 
   static const int AUTOMATIC_RETRIES = 3;
@@ -494,6 +521,7 @@ private:
 
   QString m_OutputDirectory;
   std::map<QString, int> m_PreferredServers;
+  std::map<QString, int> m_ServerSpeeds;
   QStringList m_SupportedExtensions;
   std::set<int> m_RequestIDs;
   QVector<int> m_AlphabeticalTranslation;
@@ -507,6 +535,13 @@ private:
   QRegExp m_DateExpression;
 
   MOBase::IPluginGame const *m_ManagedGame;
+
+  // state of a pending pauseAll. While this is active, meta files are only
+  // written once all downloads have stopped
+  bool m_Quiescing;
+  QFutureInterface<bool> m_QuiesceResult;
+  QTimer m_QuiesceTimer;
+  QSet<DownloadInfo*> m_PendingMetaFiles;
 };
 
 
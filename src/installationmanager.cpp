@@ -47,12 +47,16 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QApplication>
 #include <QDateTime>
 #include <QDirIterator>
+#include <QHash>
+#include <QSet>
 
 #include <Shellapi.h>
 
 #include <boost/assign.hpp>
 #include <boost/scoped_ptr.hpp>
 
+#include <algorithm>
+
 
 using namespace MOBase;
 using namespace MOShared;
@@ -159,16 +163,23 @@ bool InstallationManager::unpackSingleFile(const QString &fileName)
   QString baseName = QFileInfo(fileName).fileName();
 
   bool available = false;
+  std::vector<std::pair<size_t, QString>> extracted;
   for (size_t i = 0; i < size; ++i) {
     if (data[i]->getFileName().compare(fileName, Qt::CaseInsensitive) == 0) {
       available = true;
-      data[i]->addOutputFileName(baseName);
-      m_TempFilesToDelete.insert(baseName);
+      if (!isStaged(i, baseName)) {
+        data[i]->addOutputFileName(baseName);
+        m_TempFilesToDelete.insert(baseName);
+        extracted.push_back(std::make_pair(i, baseName));
+      }
     }
   }
 
   if (!available) {
     return false;
+  } else if (extracted.empty()) {
+    // installers tend to ask for the same files repeatedly
+    return true;
   }
 
   m_InstallationProgress = new QProgressDialog(m_ParentWidget);
@@ -188,6 +199,9 @@ bool InstallationManager::unpackSingleFile(const QString &fileName)
                                 new MethodCallback<InstallationManager, void, float>(this, &InstallationManager::updateProgress),
                                 nullptr,
                                 new MethodCallback<InstallationManager, void, QString const &>(this, &InstallationManager::report7ZipError));
+  if (res) {
+    setStaged(extracted);
+  }
 
   return res;
 }
@@ -218,13 +232,15 @@ static QString canonicalize(const QString &name)
 
 QStringList InstallationManager::extractFiles(const QStringList &filesOrig, bool flatten)
 {
-  QStringList files;
-
+  // archive entries are matched case-insensitively, so compare the case-folded names
+  QSet<QString> files;
+  files.reserve(filesOrig.size());
   for (const QString &file : filesOrig) {
-    files.append(canonicalize(file));
+    files.insert(canonicalize(file).toCaseFolded());
   }
 
   QStringList result;
+  std::vector<std::pair<size_t, QString>> extracted;
 
   FileData* const *data;
   size_t size;
@@ -232,7 +248,7 @@ QStringList InstallationManager::extractFiles(const QStringList &filesOrig, bool
 
   for (size_t i = 0; i < size; ++i) {
     //FIXME Use qstring all the way through
-    if (files.contains(data[i]->getFileName(), Qt::CaseInsensitive)) {
+    if (files.contains(data[i]->getFileName().toCaseFolded())) {
       std::wstring temp = data[i]->getFileName().toStdWString();
       wchar_t const * const origFile = temp.c_str();
       const wchar_t *targetFile = origFile;
@@ -251,14 +267,20 @@ QStringList InstallationManager::extractFiles(const QStringList &filesOrig, bool
           ++targetFile;
         }
       }
-      data[i]->addOutputFileName(ToQString(targetFile));
-
-      result.append(QDir::tempPath().append("/").append(ToQString(targetFile)));
-
-      m_TempFilesToDelete.insert(ToQString(targetFile));
+      QString tempName = ToQString(targetFile);
+      result.append(QDir::tempPath().append("/").append(tempName));
+      if (!isStaged(i, tempName)) {
+        data[i]->addOutputFileName(tempName);
+        m_TempFilesToDelete.insert(tempName);
+        extracted.push_back(std::make_pair(i, tempName));
+      }
     }
   }
 
+  if (extracted.empty()) {
+    return result;
+  }
+
   m_InstallationProgress = new QProgressDialog(m_ParentWidget);
   ON_BLOCK_EXIT([this] () {
     m_InstallationProgress->hide();
@@ -278,10 +300,78 @@ QStringList InstallationManager::extractFiles(const QStringList &filesOrig, bool
          new MethodCallback<InstallationManager, void, QString const &>(this, &InstallationManager::report7ZipError))) {
     throw MyException(QString("extracting failed (%1)").arg(m_ArchiveHandler->getLastError()));
   }
+  setStaged(extracted);
+
+  return result;
+}
+
+
+bool InstallationManager::isStaged(size_t index, const QString &tempName) const
+{
+  auto iter = m_StagedFiles.find(index);
+  return (iter != m_StagedFiles.end())
+      && (iter->second.compare(tempName, Qt::CaseInsensitive) == 0)
+      && QFile::exists(QDir::tempPath() + "/" + tempName);
+}
+
+
+void InstallationManager::setStaged(const std::vector<std::pair<size_t, QString>> &entries)
+{
+  for (const auto &entry : entries) {
+    // another entry extracted to the same name was overwritten
+    auto nameIter = m_StagedNames.find(entry.second);
+    if (nameIter != m_StagedNames.end()) {
+      m_StagedFiles.erase(nameIter->second);
+    }
+    auto fileIter = m_StagedFiles.find(entry.first);
+    if (fileIter != m_StagedFiles.end()) {
+      m_StagedNames.erase(fileIter->second);
+    }
+    m_StagedFiles[entry.first] = entry.second;
+    m_StagedNames[entry.second] = entry.first;
+  }
+}
+
+
+std::vector<std::pair<QString, std::vector<QString>>> InstallationManager::takeStagedMappings()
+{
+  FileData* const *data;
+  size_t size;
+  m_ArchiveHandler->getFileList(data, size);
 
+  std::vector<std::pair<QString, std::vector<QString>>> result;
+  for (const auto &staged : m_StagedFiles) {
+    if ((staged.first < size) && QFile::exists(QDir::tempPath() + "/" + staged.second)) {
+      std::vector<QString> targets = data[staged.first]->getAndClearOutputFileNames();
+      if (!targets.empty()) {
+        result.push_back(std::make_pair(staged.second, targets));
+      }
+    }
+  }
   return result;
 }
 
+
+void InstallationManager::installStagedFiles(const std::vector<std::pair<QString, std::vector<QString>>> &mappings,
+                                             const QString &targetDirectory)
+{
+  for (const auto &mapping : mappings) {
+    QString source = QDir::tempPath() + "/" + mapping.first;
+    for (size_t i = 0; i < mapping.second.size(); ++i) {
+      QString destination = targetDirectory + "/" + QDir::fromNativeSeparators(mapping.second[i]);
+      QDir().mkpath(QFileInfo(destination).absolutePath());
+      // extraction overwrites existing files as well (e.g. when merging)
+      QFile::remove(destination);
+      // the last target can take the file itself, the temp copy isn't needed anymore
+      bool last = i + 1 == mapping.second.size();
+      if (!(last ? QFile::rename(source, destination) : QFile::copy(source, destination))) {
+        reportError(tr("failed to move %1 to %2").arg(QDir::toNativeSeparators(source))
+                                                 .arg(QDir::toNativeSeparators(destination)));
+      }
+    }
+  }
+}
+
 IPluginInstaller::EInstallResult InstallationManager::installArchive(GuessedValue<QString> &modName, const QString &archiveName)
 {
   // in earlier versions the modName was copied here and the copy passed to install. I don't know why I did this and it causes
@@ -304,56 +394,68 @@ DirectoryTree *InstallationManager::createFilesTree()
 
   QScopedPointer<DirectoryTree> result(new DirectoryTree);
 
-  for (size_t i = 0; i < size; ++i) {
-    // the files are in a flat list where each file has a a full path relative to the archive root
-    // to create a tree, we have to iterate over each path component of each. This could be sped up by
-    // grouping the filenames first, but so far there doesn't seem to be an actual performance problem
-    DirectoryTree::Node *currentNode = result.data();
+  // the files are in a flat list where each file has a a full path relative to the archive root.
+  // The subdirectories of each node are hashed by name so finding a path component doesn't
+  // require a search through all siblings. Archives usually list the content of a directory
+  // in one go so the directory of the previous file is tried before walking the path at all
+  QHash<DirectoryTree::Node*, QHash<QString, DirectoryTree::Node*>> subDirectories;
+  QString previousDirectory;
+  DirectoryTree::Node *previousNode = nullptr;
+
+  auto addDirectory = [&subDirectories] (DirectoryTree::Node *parent, const QString &name, int index) {
+    DirectoryTree::Node *newNode = new DirectoryTree::Node;
+    newNode->setData(DirectoryTreeInformation(name, index));
+    parent->addNode(newNode, false);
+    subDirectories[parent].insert(name, newNode);
+    return newNode;
+  };
 
+  for (size_t i = 0; i < size; ++i) {
     QString fileName = data[i]->getFileName();
-    QStringList components = fileName.split("\\");
-
-    // iterate over all path-components of this filename (including the filename itself)
-    for (QStringList::iterator componentIter = components.begin(); componentIter != components.end(); ++componentIter) {
-      if (componentIter->size() == 0) {
-        // empty string indicates fileName is actually only a directory name and we have
-        // completely processed it already.
-        break;
-      }
+    int separator = fileName.lastIndexOf('\\');
+    QString directory = fileName.left(std::max(separator, 0));
+    QString name = fileName.mid(separator + 1);
 
-      bool exists = false;
-      // test if this path is already in the tree
-      for (DirectoryTree::node_iterator nodeIter = currentNode->nodesBegin(); nodeIter != currentNode->nodesEnd(); ++nodeIter) {
-        if ((*nodeIter)->getData().name == *componentIter) {
-          currentNode = *nodeIter;
-          exists = true;
-          break;
-        }
-      }
-
-      if (!exists) {
-        if (componentIter + 1 == components.end()) {
-          // last path component. directory or file?
-          if (data[i]->isDirectory()) {
-            // this is a bit problematic. archives will often only list directories if they are empty,
-            // otherwise the dir only appears in the path of a file. In the UI however we allow the user
-            // to uncheck all files in a directory while keeping the dir checked. Those directories are
-            // currently not installed.
-            DirectoryTree::Node *newNode = new DirectoryTree::Node;
-            newNode->setData(DirectoryTreeInformation(*componentIter, i));
-            currentNode->addNode(newNode, false);
-            currentNode = newNode;
-          } else {
-            currentNode->addLeaf(FileTreeInformation(*componentIter, i));
+    DirectoryTree::Node *currentNode = result.data();
+    if (separator != -1) {
+      if ((previousNode != nullptr) && (directory == previousDirectory)) {
+        currentNode = previousNode;
+      } else {
+        bool valid = true;
+        for (const QString &component : directory.split('\\')) {
+          if (component.size() == 0) {
+            // empty string indicates fileName is actually only a directory name or
+            // malformed, everything after this is ignored
+            valid = false;
+            break;
           }
-        } else {
-          DirectoryTree::Node *newNode = new DirectoryTree::Node;
-          newNode->setData(DirectoryTreeInformation(*componentIter, -1));
-          currentNode->addNode(newNode, false);
-          currentNode = newNode;
+          DirectoryTree::Node *node = subDirectories[currentNode].value(component, nullptr);
+          currentNode = node != nullptr ? node : addDirectory(currentNode, component, -1);
         }
+        if (!valid) {
+          previousNode = nullptr;
+          continue;
+        }
+        previousDirectory = directory;
+        previousNode = currentNode;
       }
     }
+
+    if ((name.size() == 0) || subDirectories[currentNode].contains(name)) {
+      // either a directory name with a trailing separator or a directory that was already created
+      // for the path of a previous file
+      continue;
+    }
+
+    if (data[i]->isDirectory()) {
+      // this is a bit problematic. archives will often only list directories if they are empty,
+      // otherwise the dir only appears in the path of a file. In the UI however we allow the user
+      // to uncheck all files in a directory while keeping the dir checked. Those directories are
+      // currently not installed.
+      addDirectory(currentNode, name, static_cast<int>(i));
+    } else {
+      currentNode->addLeaf(FileTreeInformation(name, i));
+    }
   }
 
   return result.take();
@@ -558,6 +660,10 @@ bool InstallationManager::doInstall(GuessedValue<QString> &modName, int modID,
         m_InstallationProgress->windowFlags() & (~Qt::WindowContextHelpButtonHint));
   m_InstallationProgress->setWindowModality(Qt::WindowModal);
   m_InstallationProgress->show();
+
+  // files the installer already had extracted are moved into place instead of being decompressed again
+  std::vector<std::pair<QString, std::vector<QString>>> stagedMappings = takeStagedMappings();
+
   if (!m_ArchiveHandler->extract(targetDirectory,
          new MethodCallback<InstallationManager, void, float>(this, &InstallationManager::updateProgress),
          new MethodCallback<InstallationManager, void, QString const &>(this, &InstallationManager::updateProgressFile),
@@ -568,6 +674,7 @@ bool InstallationManager::doInstall(GuessedValue<QString> &modName, int modID,
       throw MyException(QString("extracting failed (%1)").arg(m_ArchiveHandler->getLastError()));
     }
   }
+  installStagedFiles(stagedMappings, targetDirectory);
 
   QSettings settingsFile(targetDirectory + "/meta.ini", QSettings::IniFormat);
 
@@ -630,6 +737,8 @@ void InstallationManager::postInstallCleanup()
   }
 
   m_TempFilesToDelete.clear();
+  m_StagedFiles.clear();
+  m_StagedNames.clear();
 
   // try to delete each directory we had temporary files in. the call fails for non-empty directories which is ok
   foreach (const QString &dir, directoriesToRemove) {
@@ -698,6 +807,9 @@ bool InstallationManager::install(const QString &fileName, GuessedValue<QString>
   //installer when it uncompresses a split archive, then finds it has a real archive
   //to deal with.
   m_ArchiveHandler->close();
+  // staged entries are identified by their index in the archive that was open
+  m_StagedFiles.clear();
+  m_StagedNames.clear();
 
   // open the archive and construct the directory tree the installers work on
   bool archiveOpen = m_ArchiveHandler->open(fileName,
@@ -30,7 +30,10 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <Windows.h>
 #include <archive.h>
 #include <QProgressDialog>
+#include <map>
 #include <set>
+#include <utility>
+#include <vector>
 #include <errorcodes.h>
 
 
@@ -164,6 +167,16 @@ private:
   void mapToArchive(const MOBase::DirectoryTree::Node *node, QString path, FileData * const *data);
   bool unpackSingleFile(const QString &fileName);
 
+  // test if an archive entry was already extracted to the temp directory under the specified name
+  bool isStaged(size_t index, const QString &tempName) const;
+  // remember archive entries that were successfully extracted to the temp directory
+  void setStaged(const std::vector<std::pair<size_t, QString>> &entries);
+  // move files that were extracted for the installer to the places they are mapped to
+  // instead of extracting them again. This clears their mapping in the archive
+  std::vector<std::pair<QString, std::vector<QString>>> takeStagedMappings();
+  void installStagedFiles(const std::vector<std::pair<QString, std::vector<QString>>> &mappings,
+                          const QString &targetDirectory);
+
 
   bool isSimpleArchiveTopLayer(const MOBase::DirectoryTree::Node *node, bool bainStyle);
   MOBase::DirectoryTree::Node *getSimpleArchiveBase(MOBase::DirectoryTree *dataTree);
@@ -209,6 +222,10 @@ private:
   QProgressDialog *m_InstallationProgress { nullptr };
 
   std::set<QString> m_TempFilesToDelete;
+  // archive entries extracted to the temp directory for the installer, mapped to their file name
+  // there and the other way around
+  std::map<size_t, QString> m_StagedFiles;
+  std::map<QString, size_t, CaseInsensitive> m_StagedNames;
 
   QString m_URL;
 };
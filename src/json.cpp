@@ -22,35 +22,54 @@
 
 #include "json.h"
 
+#include <cstring>
+#include <limits>
+
 namespace QtJson {
-    static QString sanitizeString(QString str);
-    static QByteArray join(const QList<QByteArray> &list, const QByteArray &sep);
-    static QVariant parseValue(const QString &json, int &index, bool &success);
-    static QVariant parseObject(const QString &json, int &index, bool &success);
-    static QVariant parseArray(const QString &json, int &index, bool &success);
-    static QVariant parseString(const QString &json, int &index, bool &success);
-    static QVariant parseNumber(const QString &json, int &index);
-    static int lastIndexOfNumber(const QString &json, int index);
-    static void eatWhitespace(const QString &json, int &index);
-    static int lookAhead(const QString &json, int index);
-    static int nextToken(const QString &json, int &index);
 
-    template<typename T>
-    QByteArray serializeMap(const T &map, bool &success) {
-        QByteArray str = "{ ";
-        QList<QByteArray> pairs;
-        for (typename T::const_iterator it = map.begin(), itend = map.end(); it != itend; ++it) {
-            QByteArray serializedValue = serialize(it.value());
-            if (serializedValue.isNull()) {
-                success = false;
-                break;
+    /**
+     * \brief cursor over UTF-8 encoded JSON data
+     *
+     * All parsing works on the raw bytes, strings are only decoded once their extent is known.
+     */
+    struct Reader {
+        const char *pos;
+        const char *end;
+
+        Reader(const QByteArray &data)
+            : pos(data.constData()), end(data.constData() + data.size()) {}
+
+        void eatWhitespace() {
+            while ((pos != end) && ((*pos == ' ') || (*pos == '\t') || (*pos == '\n') || (*pos == '\r'))) {
+                ++pos;
+            }
+        }
+
+        bool atEnd() const {
+            return pos == end;
+        }
+
+        bool consumeLiteral(const char *literal, size_t length) {
+            if ((static_cast<size_t>(end - pos) >= length) && (memcmp(pos, literal, length) == 0)) {
+                pos += length;
+                return true;
             }
-            pairs << sanitizeString(it.key()).toUtf8() + " : " + serializedValue;
+            return false;
         }
+    };
 
-        str += join(pairs, ", ");
-        str += " }";
-        return str;
+    static bool readString(Reader &reader, QString &result);
+    static QVariant readNumber(Reader &reader);
+    static QVariant parseValue(Reader &reader, bool &success);
+    static bool parseEvents(Reader &reader, JsonHandler &handler);
+    static bool serializeInto(const QVariant &data, QByteArray &out);
+    static void appendSanitized(const QString &str, QByteArray &out);
+
+    static int hexValue(char c) {
+        if ((c >= '0') && (c <= '9')) return c - '0';
+        if ((c >= 'a') && (c <= 'f')) return c - 'a' + 10;
+        if ((c >= 'A') && (c <= 'F')) return c - 'A' + 10;
+        return -1;
     }
 
 
@@ -68,21 +87,28 @@ namespace QtJson {
     QVariant parse(const QString &json, bool &success) {
         success = true;
 
-        // Return an empty QVariant if the JSON data is either null or empty
-        if (!json.isNull() || !json.isEmpty()) {
-            QString data = json;
-            // We'll start from index 0
-            int index = 0;
-
-            // Parse the first value
-            QVariant value = parseValue(data, index, success);
-
-            // Return the parsed value
-            return value;
-        } else {
-            // Return the empty QVariant
+        // Return an empty QVariant if the JSON data is null
+        if (json.isNull()) {
             return QVariant();
         }
+        return parse(json.toUtf8(), success);
+    }
+
+    /**
+     * parse
+     */
+    QVariant parse(const QByteArray &json, bool &success) {
+        success = true;
+        Reader reader(json);
+        return parseValue(reader, success);
+    }
+
+    /**
+     * parse
+     */
+    bool parse(const QByteArray &json, JsonHandler &handler) {
+        Reader reader(json);
+        return parseEvents(reader, handler);
     }
 
     QByteArray serialize(const QVariant &data) {
@@ -92,431 +118,444 @@ namespace QtJson {
 
     QByteArray serialize(const QVariant &data, bool &success) {
         QByteArray str;
-        success = true;
+        success = serializeInto(data, str);
+
+        if (success) {
+            return str;
+        } else {
+            return QByteArray();
+        }
+    }
 
+    QString serializeStr(const QVariant &data) {
+        return QString::fromUtf8(serialize(data));
+    }
+
+    QString serializeStr(const QVariant &data, bool &success) {
+        return QString::fromUtf8(serialize(data, success));
+    }
+
+
+    template<typename T>
+    static bool serializeMap(const T &map, QByteArray &out) {
+        out.append("{ ");
+        bool first = true;
+        for (typename T::const_iterator it = map.begin(), itend = map.end(); it != itend; ++it) {
+            if (!first) {
+                out.append(", ");
+            }
+            first = false;
+            appendSanitized(it.key(), out);
+            out.append(" : ");
+            if (!serializeInto(it.value(), out)) {
+                return false;
+            }
+        }
+        out.append(" }");
+        return true;
+    }
+
+    /**
+     * serializeInto
+     *
+     * appends the textual representation of data to the output buffer
+     */
+    static bool serializeInto(const QVariant &data, QByteArray &out) {
         if (!data.isValid()) { // invalid or null?
-            str = "null";
+            out.append("null");
         } else if ((data.type() == QVariant::List) ||
                    (data.type() == QVariant::StringList)) { // variant is a list?
-            QList<QByteArray> values;
+            out.append("[ ");
             const QVariantList list = data.toList();
-            Q_FOREACH(const QVariant& v, list) {
-                QByteArray serializedValue = serialize(v);
-                if (serializedValue.isNull()) {
-                    success = false;
-                    break;
+            for (int i = 0; i < list.size(); ++i) {
+                if (i != 0) {
+                    out.append(", ");
+                }
+                if (!serializeInto(list.at(i), out)) {
+                    return false;
                 }
-                values << serializedValue;
             }
-
-            str = "[ " + join( values, ", " ) + " ]";
+            out.append(" ]");
         } else if (data.type() == QVariant::Hash) { // variant is a hash?
-            str = serializeMap<>(data.toHash(), success);
+            return serializeMap<>(data.toHash(), out);
         } else if (data.type() == QVariant::Map) { // variant is a map?
-            str = serializeMap<>(data.toMap(), success);
+            return serializeMap<>(data.toMap(), out);
         } else if ((data.type() == QVariant::String) ||
                    (data.type() == QVariant::ByteArray)) {// a string or a byte array?
-            str = sanitizeString(data.toString()).toUtf8();
+            appendSanitized(data.toString(), out);
         } else if (data.type() == QVariant::Double) { // double?
             double value = data.toDouble();
             if ((value - value) == 0.0) {
-                str = QByteArray::number(value, 'g');
+                QByteArray str = QByteArray::number(value, 'g');
+                out.append(str);
                 if (!str.contains(".") && ! str.contains("e")) {
-                    str += ".0";
+                    out.append(".0");
                 }
             } else {
-                success = false;
+                return false;
             }
         } else if (data.type() == QVariant::Bool) { // boolean value?
-            str = data.toBool() ? "true" : "false";
+            out.append(data.toBool() ? "true" : "false");
         } else if (data.type() == QVariant::ULongLong) { // large unsigned number?
-            str = QByteArray::number(data.value<qulonglong>());
+            out.append(QByteArray::number(data.value<qulonglong>()));
         } else if (data.canConvert<qlonglong>()) { // any signed number?
-            str = QByteArray::number(data.value<qlonglong>());
-        } else if (data.canConvert<long>()) { //TODO: this code is never executed
-            str = QString::number(data.value<long>()).toUtf8();
+            out.append(QByteArray::number(data.value<qlonglong>()));
         } else if (data.canConvert<QString>()) { // can value be converted to string?
             // this will catch QDate, QDateTime, QUrl, ...
-            str = sanitizeString(data.toString()).toUtf8();
+            appendSanitized(data.toString(), out);
         } else {
-            success = false;
+            return false;
         }
-
-        if (success) {
-            return str;
-        } else {
-            return QByteArray();
-        }
-    }
-
-    QString serializeStr(const QVariant &data) {
-        return QString::fromUtf8(serialize(data));
-    }
-
-    QString serializeStr(const QVariant &data, bool &success) {
-        return QString::fromUtf8(serialize(data, success));
+        return true;
     }
 
-
     /**
-     * \enum JsonToken
+     * appendSanitized
+     *
+     * appends str as a quoted and escaped json string
      */
-    enum JsonToken {
-        JsonTokenNone = 0,
-        JsonTokenCurlyOpen = 1,
-        JsonTokenCurlyClose = 2,
-        JsonTokenSquaredOpen = 3,
-        JsonTokenSquaredClose = 4,
-        JsonTokenColon = 5,
-        JsonTokenComma = 6,
-        JsonTokenString = 7,
-        JsonTokenNumber = 8,
-        JsonTokenTrue = 9,
-        JsonTokenFalse = 10,
-        JsonTokenNull = 11
-    };
-
-    static QString sanitizeString(QString str) {
-        str.replace(QLatin1String("\\"), QLatin1String("\\\\"));
-        str.replace(QLatin1String("\""), QLatin1String("\\\""));
-        str.replace(QLatin1String("\b"), QLatin1String("\\b"));
-        str.replace(QLatin1String("\f"), QLatin1String("\\f"));
-        str.replace(QLatin1String("\n"), QLatin1String("\\n"));
-        str.replace(QLatin1String("\r"), QLatin1String("\\r"));
-        str.replace(QLatin1String("\t"), QLatin1String("\\t"));
-        return QString(QLatin1String("\"%1\"")).arg(str);
-    }
-
-    static QByteArray join(const QList<QByteArray> &list, const QByteArray &sep) {
-        QByteArray res;
-        Q_FOREACH(const QByteArray &i, list) {
-            if (!res.isEmpty()) {
-                res += sep;
+    static void appendSanitized(const QString &str, QByteArray &out) {
+        QByteArray utf8 = str.toUtf8();
+        out.reserve(out.size() + utf8.size() + 2);
+        out.append('"');
+        const char *run = utf8.constData();
+        const char *end = run + utf8.size();
+        for (const char *iter = run; iter != end; ++iter) {
+            const char *escape = nullptr;
+            switch (*iter) {
+                case '\\': escape = "\\\\"; break;
+                case '"':  escape = "\\\""; break;
+                case '\b': escape = "\\b"; break;
+                case '\f': escape = "\\f"; break;
+                case '\n': escape = "\\n"; break;
+                case '\r': escape = "\\r"; break;
+                case '\t': escape = "\\t"; break;
+            }
+            if (escape != nullptr) {
+                out.append(run, static_cast<int>(iter - run));
+                out.append(escape);
+                run = iter + 1;
             }
-            res += i;
         }
-        return res;
+        out.append(run, static_cast<int>(end - run));
+        out.append('"');
     }
 
-    /**
-     * parseValue
-     */
-    static QVariant parseValue(const QString &json, int &index, bool &success) {
-        // Determine what kind of data we should parse by
-        // checking out the upcoming token
-        switch(lookAhead(json, index)) {
-            case JsonTokenString:
-                return parseString(json, index, success);
-            case JsonTokenNumber:
-                return parseNumber(json, index);
-            case JsonTokenCurlyOpen:
-                return parseObject(json, index, success);
-            case JsonTokenSquaredOpen:
-                return parseArray(json, index, success);
-            case JsonTokenTrue:
-                nextToken(json, index);
-                return QVariant(true);
-            case JsonTokenFalse:
-                nextToken(json, index);
-                return QVariant(false);
-            case JsonTokenNull:
-                nextToken(json, index);
-                return QVariant();
-            case JsonTokenNone:
-                break;
-        }
-
-        // If there were no tokens, flag the failure and return an empty QVariant
-        success = false;
-        return QVariant();
-    }
 
     /**
-     * parseObject
+     * readString
+     *
+     * expects the reader to be positioned on the opening quote
      */
-    static QVariant parseObject(const QString &json, int &index, bool &success) {
-        QVariantMap map;
-        int token;
-
-        // Get rid of the whitespace and increment index
-        nextToken(json, index);
-
-        // Loop through all of the key/value pairs of the object
-        bool done = false;
-        while (!done) {
-            // Get the upcoming token
-            token = lookAhead(json, index);
-
-            if (token == JsonTokenNone) {
-                success = false;
-                return QVariantMap();
-            } else if (token == JsonTokenComma) {
-                nextToken(json, index);
-            } else if (token == JsonTokenCurlyClose) {
-                nextToken(json, index);
-                return map;
-            } else {
-                // Parse the key/value pair's name
-                QString name = parseString(json, index, success).toString();
-
-                if (!success) {
-                    return QVariantMap();
-                }
-
-                // Get the next token
-                token = nextToken(json, index);
-
-                // If the next token is not a colon, flag the failure
-                // return an empty QVariant
-                if (token != JsonTokenColon) {
-                    success = false;
-                    return QVariant(QVariantMap());
-                }
+    static bool readString(Reader &reader, QString &result) {
+        ++reader.pos;
 
-                // Parse the key/value pair's value
-                QVariant value = parseValue(json, index, success);
+        // fast path: most strings contain no escape sequences and can be decoded in one go
+        const char *run = reader.pos;
+        while ((reader.pos != reader.end) && (*reader.pos != '"') && (*reader.pos != '\\')) {
+            ++reader.pos;
+        }
+        if (reader.pos == reader.end) {
+            return false;
+        }
+        if (*reader.pos == '"') {
+            result = QString::fromUtf8(run, static_cast<int>(reader.pos - run));
+            ++reader.pos;
+            return true;
+        }
 
-                if (!success) {
-                    return QVariantMap();
-                }
+        result.clear();
+        while (reader.pos != reader.end) {
+            char c = *reader.pos;
+            if ((c != '"') && (c != '\\')) {
+                ++reader.pos;
+                continue;
+            }
+            result.append(QString::fromUtf8(run, static_cast<int>(reader.pos - run)));
+            ++reader.pos;
+            if (c == '"') {
+                return true;
+            }
 
-                // Assign the value to the key in the map
-                map[name] = value;
+            if (reader.pos == reader.end) {
+                return false;
+            }
+            c = *reader.pos++;
+            switch (c) {
+                case '"':  result.append(QChar('"')); break;
+                case '\\': result.append(QChar('\\')); break;
+                case '/':  result.append(QChar('/')); break;
+                case 'b':  result.append(QChar('\b')); break;
+                case 'f':  result.append(QChar('\f')); break;
+                case 'n':  result.append(QChar('\n')); break;
+                case 'r':  result.append(QChar('\r')); break;
+                case 't':  result.append(QChar('\t')); break;
+                case 'u': {
+                    if (reader.end - reader.pos < 4) {
+                        return false;
+                    }
+                    int symbol = 0;
+                    for (int i = 0; i < 4; ++i) {
+                        int digit = hexValue(reader.pos[i]);
+                        if (digit < 0) {
+                            // consistent with the previous parser: invalid sequences decode to 0
+                            symbol = 0;
+                            break;
+                        }
+                        symbol = (symbol << 4) | digit;
+                    }
+                    // surrogate pairs arrive as two escapes and end up as valid utf-16 this way
+                    result.append(QChar(symbol));
+                    reader.pos += 4;
+                } break;
+                default: {
+                    // unknown escape sequences are dropped
+                } break;
             }
+            run = reader.pos;
         }
-
-        // Return the map successfully
-        return QVariant(map);
+        return false;
     }
 
     /**
-     * parseArray
+     * readNumber
      */
-    static QVariant parseArray(const QString &json, int &index, bool &success) {
-        QVariantList list;
-
-        nextToken(json, index);
-
-        bool done = false;
-        while(!done) {
-            int token = lookAhead(json, index);
-
-            if (token == JsonTokenNone) {
-                success = false;
-                return QVariantList();
-            } else if (token == JsonTokenComma) {
-                nextToken(json, index);
-            } else if (token == JsonTokenSquaredClose) {
-                nextToken(json, index);
-                break;
+    static QVariant readNumber(Reader &reader) {
+        const char *start = reader.pos;
+        bool simple = true;
+        bool negative = (*reader.pos == '-');
+        if (negative) {
+            ++reader.pos;
+        }
+        const char *digits = reader.pos;
+        while (reader.pos != reader.end) {
+            char c = *reader.pos;
+            if ((c >= '0') && (c <= '9')) {
+                ++reader.pos;
+            } else if ((c == '+') || (c == '-') || (c == '.') || (c == 'e') || (c == 'E')) {
+                simple = false;
+                ++reader.pos;
             } else {
-                QVariant value = parseValue(json, index, success);
-                if (!success) {
-                    return QVariantList();
-                }
-                list.push_back(value);
+                break;
             }
         }
 
-        return QVariant(list);
-    }
-
-    /**
-     * parseString
-     */
-    static QVariant parseString(const QString &json, int &index, bool &success) {
-        QString s;
-        QChar c;
-
-        eatWhitespace(json, index);
-
-        c = json[index++];
-
-        bool complete = false;
-        while(!complete) {
-            if (index == json.size()) {
-                break;
+        if (simple && (reader.pos != digits) && (reader.pos - digits <= 19)) {
+            // plain integer: convert without intermediate string. 19 digits always fit into 64 bits
+            quint64 value = 0;
+            for (const char *iter = digits; iter != reader.pos; ++iter) {
+                value = value * 10 + (*iter - '0');
             }
-
-            c = json[index++];
-
-            if (c == '\"') {
-                complete = true;
-                break;
-            } else if (c == '\\') {
-                if (index == json.size()) {
-                    break;
-                }
-
-                c = json[index++];
-
-                if (c == '\"') {
-                    s.append('\"');
-                } else if (c == '\\') {
-                    s.append('\\');
-                } else if (c == '/') {
-                    s.append('/');
-                } else if (c == 'b') {
-                    s.append('\b');
-                } else if (c == 'f') {
-                    s.append('\f');
-                } else if (c == 'n') {
-                    s.append('\n');
-                } else if (c == 'r') {
-                    s.append('\r');
-                } else if (c == 't') {
-                    s.append('\t');
-                } else if (c == 'u') {
-                    int remainingLength = json.size() - index;
-                    if (remainingLength >= 4) {
-                        QString unicodeStr = json.mid(index, 4);
-
-                        int symbol = unicodeStr.toInt(0, 16);
-
-                        s.append(QChar(symbol));
-
-                        index += 4;
-                    } else {
-                        break;
-                    }
+            if (negative) {
+                if (value <= static_cast<quint64>(std::numeric_limits<int>::max()) + 1) {
+                    return static_cast<int>(-static_cast<qint64>(value));
+                } else if (value <= static_cast<quint64>(std::numeric_limits<qint64>::max())) {
+                    return -static_cast<qlonglong>(value);
                 }
             } else {
-                s.append(c);
+                if (value <= std::numeric_limits<uint>::max()) {
+                    return static_cast<uint>(value);
+                } else {
+                    return static_cast<qulonglong>(value);
+                }
             }
         }
 
-        if (!complete) {
-            success = false;
-            return QVariant();
-        }
-
-        return QVariant(s);
-    }
-
-    /**
-     * parseNumber
-     */
-    static QVariant parseNumber(const QString &json, int &index) {
-        eatWhitespace(json, index);
-
-        int lastIndex = lastIndexOfNumber(json, index);
-        int charLength = (lastIndex - index) + 1;
-        QString numberStr;
-
-        numberStr = json.mid(index, charLength);
-
-        index = lastIndex + 1;
+        // anything else uses the same conversion rules as the previous parser
+        QByteArray numberStr(start, static_cast<int>(reader.pos - start));
         bool ok;
-
         if (numberStr.contains('.')) {
             return QVariant(numberStr.toDouble(nullptr));
         } else if (numberStr.startsWith('-')) {
             int i = numberStr.toInt(&ok);
             if (!ok) {
                 qlonglong ll = numberStr.toLongLong(&ok);
-                return ok ? ll : QVariant(numberStr);
+                return ok ? ll : QVariant(QString::fromLatin1(numberStr));
             }
             return i;
         } else {
             uint u = numberStr.toUInt(&ok);
             if (!ok) {
                 qulonglong ull = numberStr.toULongLong(&ok);
-                return ok ? ull : QVariant(numberStr);
+                return ok ? ull : QVariant(QString::fromLatin1(numberStr));
             }
             return u;
         }
     }
 
     /**
-     * lastIndexOfNumber
+     * parseValue
      */
-    static int lastIndexOfNumber(const QString &json, int index) {
-        int lastIndex;
-
-        for(lastIndex = index; lastIndex < json.size(); lastIndex++) {
-            if (QString("0123456789+-.eE").indexOf(json[lastIndex]) == -1) {
-                break;
-            }
+    static QVariant parseValue(Reader &reader, bool &success) {
+        reader.eatWhitespace();
+        if (reader.atEnd()) {
+            success = false;
+            return QVariant();
         }
 
-        return lastIndex -1;
-    }
-
-    /**
-     * eatWhitespace
-     */
-    static void eatWhitespace(const QString &json, int &index) {
-        for(; index < json.size(); index++) {
-            if (QString(" \t\n\r").indexOf(json[index]) == -1) {
-                break;
-            }
+        switch (*reader.pos) {
+            case '"': {
+                QString result;
+                if (!readString(reader, result)) {
+                    success = false;
+                    return QVariant();
+                }
+                return result;
+            } break;
+            case '0': case '1': case '2': case '3': case '4':
+            case '5': case '6': case '7': case '8': case '9':
+            case '-': {
+                return readNumber(reader);
+            } break;
+            case '{': {
+                ++reader.pos;
+                QVariantMap map;
+                QString name;
+                for (;;) {
+                    reader.eatWhitespace();
+                    if (reader.atEnd()) {
+                        success = false;
+                        return QVariantMap();
+                    } else if (*reader.pos == ',') {
+                        ++reader.pos;
+                    } else if (*reader.pos == '}') {
+                        ++reader.pos;
+                        return map;
+                    } else if ((*reader.pos != '"') || !readString(reader, name)) {
+                        success = false;
+                        return QVariantMap();
+                    } else {
+                        reader.eatWhitespace();
+                        if (reader.atEnd() || (*reader.pos != ':')) {
+                            success = false;
+                            return QVariantMap();
+                        }
+                        ++reader.pos;
+                        QVariant value = parseValue(reader, success);
+                        if (!success) {
+                            return QVariantMap();
+                        }
+                        map.insert(name, value);
+                    }
+                }
+            } break;
+            case '[': {
+                ++reader.pos;
+                QVariantList list;
+                for (;;) {
+                    reader.eatWhitespace();
+                    if (reader.atEnd()) {
+                        success = false;
+                        return QVariantList();
+                    } else if (*reader.pos == ',') {
+                        ++reader.pos;
+                    } else if (*reader.pos == ']') {
+                        ++reader.pos;
+                        return list;
+                    } else {
+                        QVariant value = parseValue(reader, success);
+                        if (!success) {
+                            return QVariantList();
+                        }
+                        list.append(value);
+                    }
+                }
+            } break;
+            default: {
+                if (reader.consumeLiteral("true", 4)) {
+                    return QVariant(true);
+                } else if (reader.consumeLiteral("false", 5)) {
+                    return QVariant(false);
+                } else if (reader.consumeLiteral("null", 4)) {
+                    return QVariant();
+                }
+            } break;
         }
-    }
 
-    /**
-     * lookAhead
-     */
-    static int lookAhead(const QString &json, int index) {
-        int saveIndex = index;
-        return nextToken(json, saveIndex);
+        // If there were no tokens, flag the failure and return an empty QVariant
+        success = false;
+        return QVariant();
     }
 
     /**
-     * nextToken
+     * parseEvents
+     *
+     * same grammar as parseValue but reports to a handler instead of building a hierarchy
      */
-    static int nextToken(const QString &json, int &index) {
-        eatWhitespace(json, index);
-
-        if (index == json.size()) {
-            return JsonTokenNone;
+    static bool parseEvents(Reader &reader, JsonHandler &handler) {
+        reader.eatWhitespace();
+        if (reader.atEnd()) {
+            return false;
         }
 
-        QChar c = json[index];
-        index++;
-        switch(c.toLatin1()) {
-            case '{': return JsonTokenCurlyOpen;
-            case '}': return JsonTokenCurlyClose;
-            case '[': return JsonTokenSquaredOpen;
-            case ']': return JsonTokenSquaredClose;
-            case ',': return JsonTokenComma;
-            case '"': return JsonTokenString;
+        switch (*reader.pos) {
+            case '"': {
+                QString result;
+                return readString(reader, result) && handler.value(result);
+            } break;
             case '0': case '1': case '2': case '3': case '4':
             case '5': case '6': case '7': case '8': case '9':
-            case '-': return JsonTokenNumber;
-            case ':': return JsonTokenColon;
-        }
-        index--; // ^ WTF?
-
-        int remainingLength = json.size() - index;
-
-        // True
-        if (remainingLength >= 4) {
-            if (json[index] == 't' && json[index + 1] == 'r' &&
-                json[index + 2] == 'u' && json[index + 3] == 'e') {
-                index += 4;
-                return JsonTokenTrue;
-            }
-        }
-
-        // False
-        if (remainingLength >= 5) {
-            if (json[index] == 'f' && json[index + 1] == 'a' &&
-                json[index + 2] == 'l' && json[index + 3] == 's' &&
-                json[index + 4] == 'e') {
-                index += 5;
-                return JsonTokenFalse;
-            }
-        }
-
-        // Null
-        if (remainingLength >= 4) {
-            if (json[index] == 'n' && json[index + 1] == 'u' &&
-                json[index + 2] == 'l' && json[index + 3] == 'l') {
-                index += 4;
-                return JsonTokenNull;
-            }
+            case '-': {
+                return handler.value(readNumber(reader));
+            } break;
+            case '{': {
+                ++reader.pos;
+                if (!handler.startObject()) {
+                    return false;
+                }
+                QString name;
+                for (;;) {
+                    reader.eatWhitespace();
+                    if (reader.atEnd()) {
+                        return false;
+                    } else if (*reader.pos == ',') {
+                        ++reader.pos;
+                    } else if (*reader.pos == '}') {
+                        ++reader.pos;
+                        return handler.endObject();
+                    } else if ((*reader.pos != '"') || !readString(reader, name) || !handler.key(name)) {
+                        return false;
+                    } else {
+                        reader.eatWhitespace();
+                        if (reader.atEnd() || (*reader.pos != ':')) {
+                            return false;
+                        }
+                        ++reader.pos;
+                        if (!parseEvents(reader, handler)) {
+                            return false;
+                        }
+                    }
+                }
+            } break;
+            case '[': {
+                ++reader.pos;
+                if (!handler.startArray()) {
+                    return false;
+                }
+                for (;;) {
+                    reader.eatWhitespace();
+                    if (reader.atEnd()) {
+                        return false;
+                    } else if (*reader.pos == ',') {
+                        ++reader.pos;
+                    } else if (*reader.pos == ']') {
+                        ++reader.pos;
+                        return handler.endArray();
+                    } else if (!parseEvents(reader, handler)) {
+                        return false;
+                    }
+                }
+            } break;
+            default: {
+                if (reader.consumeLiteral("true", 4)) {
+                    return handler.value(QVariant(true));
+                } else if (reader.consumeLiteral("false", 5)) {
+                    return handler.value(QVariant(false));
+                } else if (reader.consumeLiteral("null", 4)) {
+                    return handler.value(QVariant());
+                }
+            } break;
         }
-
-        return JsonTokenNone;
+        return false;
     }
 } //end namespace
@@ -25,6 +25,7 @@
 
 #include <QVariant>
 #include <QString>
+#include <QByteArray>
 
 
 /**
@@ -52,6 +53,43 @@ namespace QtJson {
      */
     QVariant parse(const QString &json, bool &success);
 
+    /**
+     * Parse UTF-8 encoded JSON data, i.e. a network reply, directly
+     *
+     * \param json The JSON data
+     * \param success The success of the parsing
+     */
+    QVariant parse(const QByteArray &json, bool &success);
+
+    /**
+     * \brief Receives parse events from the streaming interface
+     *
+     * Each callback may return false to abort parsing.
+     */
+    class JsonHandler {
+    public:
+        virtual ~JsonHandler() {}
+        virtual bool startObject() = 0;
+        virtual bool key(const QString &name) = 0;
+        virtual bool endObject() = 0;
+        virtual bool startArray() = 0;
+        virtual bool endArray() = 0;
+        /**
+         * called for strings, numbers, booleans and null (as an invalid QVariant)
+         */
+        virtual bool value(const QVariant &value) = 0;
+    };
+
+    /**
+     * Parse UTF-8 encoded JSON data without building a QVariant hierarchy
+     *
+     * \param json The JSON data
+     * \param handler Receives the parse events
+     *
+     * \return true if the data was parsed completely
+     */
+    bool parse(const QByteArray &json, JsonHandler &handler);
+
     /**
      * This method generates a textual JSON representation
      *
@@ -0,0 +1,387 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "listexporter.h"
+
+#include <utility.h>
+
+#include <QFile>
+#include <QMutexLocker>
+#include <QRunnable>
+
+
+using namespace MOBase;
+using namespace MOShared;
+
+
+class ListExportWorker : public QRunnable
+{
+public:
+  ListExportWorker(ListExporter *exporter, const QString &fileName)
+    : m_Exporter(exporter), m_FileName(fileName) {}
+
+  virtual void run() { m_Exporter->run(m_FileName); }
+
+private:
+  ListExporter *m_Exporter;
+  QString m_FileName;
+};
+
+
+TableExportSource::TableExportSource(const Columns &columns)
+  : m_Columns(columns)
+{
+}
+
+
+void TableExportSource::addRow(const std::vector<QVariant> &values)
+{
+  m_Rows.push_back(values);
+}
+
+
+ExportSource::Columns TableExportSource::columns() const
+{
+  return m_Columns;
+}
+
+
+size_t TableExportSource::rowCount() const
+{
+  return m_Rows.size();
+}
+
+
+void TableExportSource::row(size_t index, std::vector<QVariant> &values) const
+{
+  values = m_Rows[index];
+}
+
+
+DataTreeExportSource::DataTreeExportSource(const DirectoryEntry &root, const QString &rootName,
+                                           const std::function<void()> &release)
+  : m_Root(root)
+  , m_RootName(rootName)
+  , m_Release(release)
+{
+}
+
+
+DataTreeExportSource::~DataTreeExportSource()
+{
+  if (m_Release) {
+    m_Release();
+  }
+}
+
+
+void DataTreeExportSource::prepare()
+{
+  addDirectory(m_Root, m_RootName);
+}
+
+
+void DataTreeExportSource::addDirectory(const DirectoryEntry &directory, const QString &path)
+{
+  int directoryIndex = static_cast<int>(m_Directories.size());
+  m_Directories.push_back(path);
+
+  for (const FileEntry::Ptr &file : directory.getFiles()) {
+    File entry;
+    entry.entry = file;
+    entry.origin = file->getOrigin(entry.archive);
+    entry.directory = directoryIndex;
+    if (m_OriginNames.find(entry.origin) == m_OriginNames.end()) {
+      m_OriginNames[entry.origin] = ToQString(directory.getOriginByID(entry.origin).getName());
+    }
+    m_Files.push_back(entry);
+  }
+
+  std::vector<DirectoryEntry*>::const_iterator current, end;
+  directory.getSubDirectories(current, end);
+  for (; current != end; ++current) {
+    addDirectory(**current, path + "\\" + ToQString((*current)->getName()));
+  }
+}
+
+
+ExportSource::Columns DataTreeExportSource::columns() const
+{
+  Columns result;
+  result.push_back(std::make_pair(QString("path"), CSVBuilder::TYPE_STRING));
+  result.push_back(std::make_pair(QString("origin"), CSVBuilder::TYPE_STRING));
+  result.push_back(std::make_pair(QString("archive"), CSVBuilder::TYPE_INTEGER));
+  return result;
+}
+
+
+size_t DataTreeExportSource::rowCount() const
+{
+  return m_Files.size();
+}
+
+
+void DataTreeExportSource::row(size_t index, std::vector<QVariant> &values) const
+{
+  const File &file = m_Files[index];
+  values.resize(3);
+  values[0] = m_Directories[file.directory] + "\\" + ToQString(file.entry->getName());
+  values[1] = m_OriginNames.at(file.origin);
+  values[2] = file.archive ? 1 : 0;
+}
+
+
+ListExporter::ListExporter(ExportSource *source, EFormat format, QObject *parent)
+  : QObject(parent)
+  , m_Source(source)
+  , m_Format(format)
+  , m_Success(false)
+{
+  m_Pool.setMaxThreadCount(1);
+  m_ProgressTimer.setInterval(PROGRESS_INTERVAL);
+  connect(&m_ProgressTimer, SIGNAL(timeout()), this, SLOT(updateProgress()));
+}
+
+
+ListExporter::~ListExporter()
+{
+  cancel();
+  // the worker accesses members that are destroyed before the pool
+  m_Pool.waitForDone();
+}
+
+
+void ListExporter::setColumns(const QStringList &columns)
+{
+  m_Columns = columns;
+}
+
+
+void ListExporter::addFilter(const QString &column, const Filter &filter)
+{
+  m_Filters.push_back(std::make_pair(column, filter));
+}
+
+
+bool ListExporter::write(QIODevice *target)
+{
+  m_RowsDone.store(0);
+  m_RowsTotal.store(0);
+  m_Canceled.store(0);
+  return exportTo(*target);
+}
+
+
+void ListExporter::start(const QString &fileName)
+{
+  m_RowsDone.store(0);
+  m_RowsTotal.store(0);
+  m_Canceled.store(0);
+  m_Running.store(1);
+  m_Pool.start(new ListExportWorker(this, fileName));
+  m_ProgressTimer.start();
+}
+
+
+void ListExporter::cancel()
+{
+  m_Canceled.store(1);
+}
+
+
+QString ListExporter::errorString() const
+{
+  QMutexLocker lock(&m_Mutex);
+  return m_Error;
+}
+
+
+void ListExporter::setError(const QString &error)
+{
+  QMutexLocker lock(&m_Mutex);
+  m_Error = error;
+}
+
+
+void ListExporter::run(const QString &fileName)
+{
+  QFile file(fileName);
+  bool success = false;
+  if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    success = exportTo(file);
+    file.close();
+    if (!success) {
+      file.remove();
+    }
+  } else {
+    setError(tr("failed to write to file %1").arg(fileName));
+  }
+
+  {
+    QMutexLocker lock(&m_Mutex);
+    m_Success = success;
+  }
+  m_Running.store(0);
+}
+
+
+void ListExporter::updateProgress()
+{
+  int total = m_RowsTotal.load();
+  if (total != 0) {
+    emit progress(static_cast<int>((m_RowsDone.load() * 100LL) / total));
+  }
+
+  if (m_Running.load() == 0) {
+    m_ProgressTimer.stop();
+    bool success;
+    {
+      QMutexLocker lock(&m_Mutex);
+      success = m_Success;
+    }
+    emit finished(success);
+  }
+}
+
+
+bool ListExporter::exportTo(QIODevice &target)
+{
+  m_Source->prepare();
+  m_RowsTotal.store(static_cast<int>(m_Source->rowCount()));
+
+  ExportSource::Columns columns = m_Source->columns();
+  auto columnIndex = [&columns] (const QString &name) -> int {
+    for (size_t i = 0; i < columns.size(); ++i) {
+      if (columns[i].first == name) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  };
+
+  // resolve column names once instead of for every row
+  std::vector<int> projection;
+  if (m_Columns.isEmpty()) {
+    for (size_t i = 0; i < columns.size(); ++i) {
+      projection.push_back(static_cast<int>(i));
+    }
+  } else {
+    for (const QString &name : m_Columns) {
+      int index = columnIndex(name);
+      if (index == -1) {
+        setError(tr("invalid field name \"%1\"").arg(name));
+        return false;
+      }
+      projection.push_back(index);
+    }
+  }
+
+  std::vector<std::pair<int, Filter>> filters;
+  for (const auto &filter : m_Filters) {
+    int index = columnIndex(filter.first);
+    if (index == -1) {
+      setError(tr("invalid field name \"%1\"").arg(filter.first));
+      return false;
+    }
+    filters.push_back(std::make_pair(index, filter.second));
+  }
+
+  QByteArray buffer;
+  // reserved so emptying the buffer after each write doesn't release the memory
+  buffer.reserve(BUFFER_SIZE + BUFFER_SIZE / 8);
+
+  if (m_Format == FORMAT_CSV) {
+    for (size_t i = 0; i < projection.size(); ++i) {
+      if (i != 0) {
+        buffer.append(',');
+      }
+      buffer.append(columns[projection[i]].first.toUtf8());
+    }
+    buffer.append("\r\n");
+  }
+
+  std::vector<QVariant> values;
+  size_t count = m_Source->rowCount();
+  for (size_t row = 0; row < count; ++row) {
+    if (m_Canceled.load() != 0) {
+      setError(tr("export canceled"));
+      return false;
+    }
+
+    m_Source->row(row, values);
+
+    bool include = true;
+    for (const auto &filter : filters) {
+      if (!filter.second(values[filter.first])) {
+        include = false;
+        break;
+      }
+    }
+
+    if (include) {
+      for (size_t i = 0; i < projection.size(); ++i) {
+        if (i != 0) {
+          buffer.append(m_Format == FORMAT_CSV ? ',' : '\t');
+        }
+        appendValue(buffer, values[projection[i]], columns[projection[i]].second);
+      }
+      buffer.append("\r\n");
+    }
+
+    if ((buffer.size() >= BUFFER_SIZE) && !flushBuffer(target, buffer)) {
+      return false;
+    }
+    m_RowsDone.store(static_cast<int>(row + 1));
+  }
+
+  return flushBuffer(target, buffer);
+}
+
+
+bool ListExporter::flushBuffer(QIODevice &target, QByteArray &buffer)
+{
+  if (target.write(buffer) != buffer.size()) {
+    setError(target.errorString());
+    return false;
+  }
+  buffer.resize(0);
+  return true;
+}
+
+
+void ListExporter::appendValue(QByteArray &buffer, const QVariant &value, CSVBuilder::EFieldType type) const
+{
+  switch (type) {
+    case CSVBuilder::TYPE_INTEGER: {
+      buffer.append(QByteArray::number(value.toInt()));
+    } break;
+    case CSVBuilder::TYPE_FLOAT: {
+      buffer.append(QByteArray::number(value.toFloat()));
+    } break;
+    case CSVBuilder::TYPE_STRING: {
+      QByteArray text = value.toString().toUtf8();
+      if (m_Format == FORMAT_CSV) {
+        buffer.append('"').append(text.replace("\"", "\"\"")).append('"');
+      } else {
+        // there is no quoting so the separators must not appear in values
+        buffer.append(text.replace('\t', ' ').replace('\r', ' ').replace('\n', ' '));
+      }
+    } break;
+  }
+}
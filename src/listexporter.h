@@ -0,0 +1,265 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LISTEXPORTER_H
+#define LISTEXPORTER_H
+
+#include "csvbuilder.h"
+#include <directoryentry.h>
+
+#include <QAtomicInt>
+#include <QIODevice>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVariant>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @brief a table of data to export
+ *
+ * Sources are set up in the main thread and have to take a snapshot of everything they
+ * need at that point or keep it alive otherwise. Everything else, starting with prepare, is
+ * called from the thread doing the export.
+ */
+class ExportSource
+{
+public:
+
+  typedef std::vector<std::pair<QString, CSVBuilder::EFieldType>> Columns;
+
+public:
+
+  virtual ~ExportSource() {}
+
+  /**
+   * @brief called before any rows are read. Expensive setup should happen here
+   */
+  virtual void prepare() {}
+
+  virtual Columns columns() const = 0;
+
+  virtual size_t rowCount() const = 0;
+
+  /**
+   * @brief retrieve a row
+   * @param index index of the row
+   * @param values receives the values in the order of the columns
+   */
+  virtual void row(size_t index, std::vector<QVariant> &values) const = 0;
+
+};
+
+
+/**
+ * @brief rows that are fully determined upfront
+ */
+class TableExportSource : public ExportSource
+{
+public:
+
+  TableExportSource(const Columns &columns);
+
+  void addRow(const std::vector<QVariant> &values);
+
+  virtual Columns columns() const override;
+  virtual size_t rowCount() const override;
+  virtual void row(size_t index, std::vector<QVariant> &values) const override;
+
+private:
+
+  Columns m_Columns;
+  std::vector<std::vector<QVariant>> m_Rows;
+
+};
+
+
+/**
+ * @brief all files of a directory structure with their origin
+ *
+ * Columns are "path", "origin" and "archive" (1 if the file is provided by an archive).
+ * The structure is only traversed in prepare, so it has to stay alive and unchanged until the
+ * source is destroyed.
+ */
+class DataTreeExportSource : public ExportSource
+{
+public:
+
+  /**
+   * @param root the structure to export
+   * @param rootName name all paths are prefixed with
+   * @param release called when the source is destroyed, i.e. to unpin the structure
+   */
+  DataTreeExportSource(const MOShared::DirectoryEntry &root, const QString &rootName,
+                       const std::function<void()> &release);
+
+  ~DataTreeExportSource();
+
+  virtual void prepare() override;
+
+  virtual Columns columns() const override;
+  virtual size_t rowCount() const override;
+  virtual void row(size_t index, std::vector<QVariant> &values) const override;
+
+private:
+
+  struct File {
+    MOShared::FileEntry::Ptr entry;
+    int directory;
+    int origin;
+    bool archive;
+  };
+
+private:
+
+  void addDirectory(const MOShared::DirectoryEntry &directory, const QString &path);
+
+private:
+
+  const MOShared::DirectoryEntry &m_Root;
+  QString m_RootName;
+  std::function<void()> m_Release;
+
+  std::vector<QString> m_Directories;
+  std::vector<File> m_Files;
+  std::map<int, QString> m_OriginNames;
+
+};
+
+
+/**
+ * @brief writes an export source as csv or as tab separated lines
+ *
+ * Rows are formatted into a buffer that is written to the target in large blocks. Exports can
+ * run in the calling thread or in the background, in which case progress is reported at most
+ * every PROGRESS_INTERVAL milliseconds.
+ */
+class ListExporter : public QObject
+{
+
+  Q_OBJECT
+
+public:
+
+  enum EFormat {
+    /// header line followed by comma separated values, strings quoted
+    FORMAT_CSV,
+    /// tab separated values, no header and no quoting
+    FORMAT_LINES
+  };
+
+  /**
+   * @brief decides whether a row is exported based on the value of one column
+   */
+  typedef std::function<bool(const QVariant&)> Filter;
+
+public:
+
+  /**
+   * @param source the data to export. The exporter takes ownership
+   * @param format output format
+   * @param parent parent object
+   */
+  ListExporter(ExportSource *source, EFormat format, QObject *parent = nullptr);
+
+  /**
+   * @brief cancels a background export if it's still running and waits for it to stop
+   */
+  ~ListExporter();
+
+  /**
+   * @brief restrict the export to the specified columns in the specified order
+   */
+  void setColumns(const QStringList &columns);
+
+  void addFilter(const QString &column, const Filter &filter);
+
+  /**
+   * @brief export in the calling thread
+   * @return true on success
+   */
+  bool write(QIODevice *target);
+
+  /**
+   * @brief export to a file in the background. finished is emitted once done
+   */
+  void start(const QString &fileName);
+
+  QString errorString() const;
+
+public slots:
+
+  void cancel();
+
+signals:
+
+  void progress(int percentage);
+
+  void finished(bool success);
+
+private slots:
+
+  void updateProgress();
+
+private:
+
+  friend class ListExportWorker;
+
+  static const int BUFFER_SIZE = 1024 * 1024;
+  static const int PROGRESS_INTERVAL = 100;
+
+private:
+
+  void run(const QString &fileName);
+  bool exportTo(QIODevice &target);
+  bool flushBuffer(QIODevice &target, QByteArray &buffer);
+  void appendValue(QByteArray &buffer, const QVariant &value, CSVBuilder::EFieldType type) const;
+  void setError(const QString &error);
+
+private:
+
+  std::unique_ptr<ExportSource> m_Source;
+  EFormat m_Format;
+  QStringList m_Columns;
+  std::vector<std::pair<QString, Filter>> m_Filters;
+
+  QThreadPool m_Pool;
+  QTimer m_ProgressTimer;
+
+  QAtomicInt m_RowsDone;
+  // set once the source is prepared, the source itself can't be asked from the main thread
+  QAtomicInt m_RowsTotal;
+  QAtomicInt m_Running;
+  QAtomicInt m_Canceled;
+
+  mutable QMutex m_Mutex;
+  QString m_Error;
+  bool m_Success;
+
+};
+
+#endif // LISTEXPORTER_H
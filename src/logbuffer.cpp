@@ -18,38 +18,243 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "logbuffer.h"
-#include <scopeguard.h>
-#include <report.h>
 #include <QMutexLocker>
 #include <QFile>
 #include <QIcon>
 #include <QDateTime>
-#include <Windows.h>
+#include <QThread>
+#include <QSemaphore>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+
+
+/**
+ * @brief background thread that appends log messages to the log file
+ * Messages are handed over through a lock-free multi-producer/single-consumer queue
+ * (Vyukov style) so logging threads never wait for file io or for each other.
+ * The file is rotated once it exceeds a size limit.
+ * This must not use qDebug & co. as those would end up in this very queue
+ */
+class LogWriter : public QThread
+{
+public:
+
+  explicit LogWriter(const QString &fileName);
+
+  /**
+   * writes all pending messages before returning
+   */
+  ~LogWriter();
+
+  void enqueue(const LogBuffer::Message &message);
+
+  bool flush(int timeout);
+
+protected:
+
+  virtual void run();
+
+private:
+
+  struct Node {
+    Node() : next(nullptr) {}
+    std::atomic<Node*> next;
+    LogBuffer::Message message;
+  };
+
+private:
+
+  bool pop(LogBuffer::Message &message);
+  void writePending(QFile &file);
+  void rotate(QFile &file);
+  bool open(QFile &file);
+
+private:
+
+  static const qint64 MAX_FILE_SIZE = 2 * 1024 * 1024;
+  static const int MAX_BACKUPS = 3;
+
+private:
+
+  QString m_FileName;
+
+  // producers append at the head, the writer consumes from the tail. The tail
+  // always points to an already consumed (stub) node
+  std::atomic<Node*> m_Head;
+  Node *m_Tail;
+
+  QSemaphore m_Pending;
+  QSemaphore m_Flushed;
+  std::atomic<int> m_FlushRequests;
+  std::atomic<bool> m_Stop;
+
+};
+
+
+LogWriter::LogWriter(const QString &fileName)
+  : m_FileName(fileName)
+  , m_Head(nullptr)
+  , m_Tail(new Node)
+  , m_FlushRequests(0)
+  , m_Stop(false)
+{
+  m_Head.store(m_Tail);
+  start(QThread::LowPriority);
+}
+
+
+LogWriter::~LogWriter()
+{
+  m_Stop.store(true);
+  m_Pending.release();
+  wait();
+
+  LogBuffer::Message discard;
+  while (pop(discard)) {}
+  delete m_Tail;
+}
+
+
+void LogWriter::enqueue(const LogBuffer::Message &message)
+{
+  Node *node = new Node;
+  node->message = message;
+  Node *previous = m_Head.exchange(node, std::memory_order_acq_rel);
+  previous->next.store(node, std::memory_order_release);
+  m_Pending.release();
+}
+
+
+bool LogWriter::flush(int timeout)
+{
+  if (QThread::currentThread() == this) {
+    return false;
+  }
+  m_FlushRequests.fetch_add(1);
+  m_Pending.release();
+  return m_Flushed.tryAcquire(1, timeout);
+}
+
+
+bool LogWriter::pop(LogBuffer::Message &message)
+{
+  Node *next = m_Tail->next.load(std::memory_order_acquire);
+  if (next == nullptr) {
+    // empty, or a producer is just linking in its node. It signals m_Pending afterwards
+    return false;
+  }
+  message = std::move(next->message);
+  next->message = LogBuffer::Message();
+  delete m_Tail;
+  m_Tail = next;
+  return true;
+}
+
+
+bool LogWriter::open(QFile &file)
+{
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+    fprintf(stderr, "failed to open log %s: %s\n",
+            qPrintable(m_FileName), qPrintable(file.errorString()));
+    return false;
+  }
+  return true;
+}
+
+
+void LogWriter::rotate(QFile &file)
+{
+  if (file.isOpen()) {
+    file.close();
+  }
+  QFile::remove(QString("%1.%2").arg(m_FileName).arg(MAX_BACKUPS));
+  for (int i = MAX_BACKUPS - 1; i > 0; --i) {
+    QFile::rename(QString("%1.%2").arg(m_FileName).arg(i),
+                  QString("%1.%2").arg(m_FileName).arg(i + 1));
+  }
+  QFile::rename(m_FileName, m_FileName + ".1");
+}
 
 
-using MOBase::reportError;
+void LogWriter::writePending(QFile &file)
+{
+  QByteArray buffer;
+  LogBuffer::Message message;
+  while (pop(message)) {
+    buffer.append(message.toString().toUtf8());
+    buffer.append("\r\n");
+  }
+  if (buffer.isEmpty()) {
+    return;
+  }
+
+  if (!file.isOpen() && !open(file)) {
+    return;
+  }
+  file.write(buffer);
+  file.flush();
+
+  if (file.size() > MAX_FILE_SIZE) {
+    rotate(file);
+    open(file);
+  }
+}
+
+
+void LogWriter::run()
+{
+  QFile file(m_FileName);
+  // every session starts with a fresh file, the previous one is kept as a backup
+  if (QFile::exists(m_FileName)) {
+    rotate(file);
+  }
+
+  for (;;) {
+    m_Pending.acquire();
+    // a single pass handles all messages that arrived in the meantime
+    m_Pending.tryAcquire(m_Pending.available());
+
+    // read before writing so that everything enqueued before a flush request gets written
+    int flushRequests = m_FlushRequests.exchange(0);
+    bool stop = m_Stop.load();
+
+    writePending(file);
+
+    if (flushRequests > 0) {
+      m_Flushed.release(flushRequests);
+    }
+    if (stop) {
+      break;
+    }
+  }
+}
 
-QScopedPointer<LogBuffer> LogBuffer::s_Instance;
+
+std::atomic<LogBuffer*> LogBuffer::s_Instance(nullptr);
+std::vector<std::unique_ptr<LogBuffer>> LogBuffer::s_Instances;
 QMutex LogBuffer::s_Mutex;
 
 
 LogBuffer::LogBuffer(int messageCount, QtMsgType minMsgType, const QString &outputFileName)
-  : QAbstractItemModel(nullptr), m_OutFileName(outputFileName), m_ShutDown(false),
-    m_MinMsgType(minMsgType), m_NumMessages(0)
+  : QAbstractItemModel(nullptr), m_OutFileName(outputFileName),
+    m_MinMsgType(minMsgType), m_NumMessages(0), m_Writer(new LogWriter(outputFileName))
 {
   m_Messages.resize(messageCount);
 }
 
 LogBuffer::~LogBuffer()
 {
+  LogBuffer *self = this;
+  if (s_Instance.compare_exchange_strong(self, nullptr)) {
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
-  qInstallMessageHandler(0);
+    qInstallMessageHandler(0);
 #else
-  qInstallMsgHandler(0);
+    qInstallMsgHandler(0);
 #endif
-//  if (!m_ShutDown) {
-    write();
-//  }
+  }
+  // destroying the writer writes all remaining messages
+  m_Writer.reset();
 }
 
 
@@ -57,44 +262,39 @@ void LogBuffer::logMessage(QtMsgType type, const QString &message)
 {
   if (type >= m_MinMsgType) {
     Message msg = { type, QTime::currentTime(), message };
-    if (m_NumMessages < m_Messages.size()) {
-      beginInsertRows(QModelIndex(), m_NumMessages, m_NumMessages + 1);
-    }
-    m_Messages.at(m_NumMessages % m_Messages.size()) = msg;
-    if (m_NumMessages < m_Messages.size()) {
-      endInsertRows();
+    m_Writer->enqueue(msg);
+    if (QThread::currentThread() == thread()) {
+      addMessage(type, msg.time, message);
     } else {
-      emit dataChanged(createIndex(0, 0), createIndex(m_Messages.size(), 0));
-    }
-    ++m_NumMessages;
-    if (type >= QtCriticalMsg) {
-      write();
+      // the model may only be changed from the thread it lives in
+      QMetaObject::invokeMethod(this, "addMessage", Qt::QueuedConnection,
+                                Q_ARG(int, type), Q_ARG(QTime, msg.time), Q_ARG(QString, message));
     }
   }
 }
 
 
-void LogBuffer::write() const
+void LogBuffer::addMessage(int type, const QTime &time, const QString &message)
 {
-  if (m_NumMessages == 0) {
-    return;
+  Message msg = { static_cast<QtMsgType>(type), time, message };
+  if (m_NumMessages < m_Messages.size()) {
+    beginInsertRows(QModelIndex(), m_NumMessages, m_NumMessages + 1);
   }
-
-  DWORD lastError = ::GetLastError();
-
-  QFile file(m_OutFileName);
-  if (!file.open(QIODevice::WriteOnly)) {
-    reportError(tr("failed to write log to %1: %2").arg(m_OutFileName).arg(file.errorString()));
-    return;
+  m_Messages.at(m_NumMessages % m_Messages.size()) = msg;
+  if (m_NumMessages < m_Messages.size()) {
+    endInsertRows();
+  } else {
+    emit dataChanged(createIndex(0, 0), createIndex(m_Messages.size(), 0));
   }
+  ++m_NumMessages;
+}
+
 
-  unsigned int i = (m_NumMessages > m_Messages.size()) ? m_NumMessages - m_Messages.size()
-                                                       : 0U;
-  for (; i < m_NumMessages; ++i) {
-    file.write(m_Messages.at(i % m_Messages.size()).toString().toUtf8());
-    file.write("\r\n");
+void LogBuffer::flush(int timeout)
+{
+  if (!m_Writer->flush(timeout)) {
+    fprintf(stderr, "log not flushed in time\n");
   }
-  ::SetLastError(lastError);
 }
 
 
@@ -102,10 +302,9 @@ void LogBuffer::init(int messageCount, QtMsgType minMsgType, const QString &outp
 {
   QMutexLocker guard(&s_Mutex);
 
-  if (!s_Instance.isNull()) {
-    s_Instance.reset();
-  }
-  s_Instance.reset(new LogBuffer(messageCount, minMsgType, outputFileName));
+  // a previous instance may still be in use by a logging thread so it's kept alive
+  s_Instances.emplace_back(new LogBuffer(messageCount, minMsgType, outputFileName));
+  s_Instance.store(s_Instances.back().get(), std::memory_order_release);
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
   qInstallMessageHandler(LogBuffer::log);
 #else
@@ -128,17 +327,9 @@ char LogBuffer::msgTypeID(QtMsgType type)
 
 void LogBuffer::log(QtMsgType type, const QMessageLogContext &context, const QString &message)
 {
-  // QMutexLocker doesn't support timeout...
-  if (!s_Mutex.tryLock(100)) {
-    fprintf(stderr, "failed to log: %s", qPrintable(message));
-    return;
-  }
-  ON_BLOCK_EXIT([] () {
-    s_Mutex.unlock();
-  });
-
-  if (!s_Instance.isNull()) {
-    s_Instance->logMessage(type, message);
+  LogBuffer *instance = LogBuffer::instance();
+  if (instance != nullptr) {
+    instance->logMessage(type, message);
   }
 //  fprintf(stdout, "(%s:%u) %s\n", context.file, context.line, qPrintable(message));
   if (type == QtDebugMsg) {
@@ -152,18 +343,27 @@ void LogBuffer::log(QtMsgType type, const QMessageLogContext &context, const QSt
     }
   }
   fflush(stdout);
+
+  if ((type == QtFatalMsg) && (instance != nullptr)) {
+    // the application is about to be terminated
+    instance->flush();
+  }
 }
 
 #else
 
 void LogBuffer::log(QtMsgType type, const char *message)
 {
-  QMutexLocker guard(&s_Mutex);
-  if (!s_Instance.isNull()) {
-    s_Instance->logMessage(type, message);
+  LogBuffer *instance = LogBuffer::instance();
+  if (instance != nullptr) {
+    instance->logMessage(type, message);
   }
   fprintf(stdout, "%s [%c] %s\n", qPrintable(QTime::currentTime().toString()), msgTypeID(type), message);
   fflush(stdout);
+
+  if ((type == QtFatalMsg) && (instance != nullptr)) {
+    instance->flush();
+  }
 }
 
 #endif
@@ -237,19 +437,17 @@ QVariant LogBuffer::data(const QModelIndex &index, int role) const
 
 void LogBuffer::writeNow()
 {
-  QMutexLocker guard(&s_Mutex);
-  if (!s_Instance.isNull()) {
-    s_Instance->write();
+  LogBuffer *instance = LogBuffer::instance();
+  if (instance != nullptr) {
+    instance->flush();
   }
 }
 
 
 void LogBuffer::cleanQuit()
 {
-  QMutexLocker guard(&s_Mutex);
-  if (!s_Instance.isNull()) {
-    s_Instance->m_ShutDown = true;
-  }
+  // the buffer itself has to outlive threads that may still log during shutdown
+  writeNow();
 }
 
 void log(const char *format, ...)
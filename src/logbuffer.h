@@ -22,12 +22,20 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QObject>
 #include <QMutex>
-#include <QScopedPointer>
 #include <QStringListModel>
 #include <QTime>
+#include <atomic>
+#include <memory>
 #include <vector>
 
 
+class LogWriter;
+
+
+/**
+ * @brief in-memory log of recent messages for the ui, also forwards all messages
+ *        to a background thread that appends them to the log file
+ */
 class LogBuffer : public QAbstractItemModel
 {
   Q_OBJECT
@@ -42,16 +50,29 @@ public:
 #endif
 
   static void writeNow();
+
+  /**
+   * @brief write everything logged so far. Logging remains possible afterwards
+   */
   static void cleanQuit();
 
-  static LogBuffer *instance() { return s_Instance.data(); }
+  static LogBuffer *instance() { return s_Instance.load(std::memory_order_acquire); }
 
 public:
 
   virtual ~LogBuffer();
 
+  /**
+   * @brief record a message. This is thread-safe and doesn't block
+   */
   void logMessage(QtMsgType type, const QString &message);
 
+  /**
+   * @brief block until all messages recorded so far have been written to disc
+   * @param timeout maximum time (in milliseconds) to wait
+   */
+  void flush(int timeout = 2000);
+
   // QAbstractItemModel interface
 public:
   QModelIndex index(int row, int column, const QModelIndex &parent) const;
@@ -64,18 +85,22 @@ signals:
 
 public slots:
 
+private slots:
+
+  void addMessage(int type, const QTime &time, const QString &message);
+
 private:
 
   explicit LogBuffer(int messageCount, QtMsgType minMsgType, const QString &outputFileName);
   LogBuffer(const LogBuffer &reference); // not implemented
   LogBuffer &operator=(const LogBuffer &reference); // not implemented
 
-  void write() const;
-
   static char msgTypeID(QtMsgType type);
 
 private:
 
+  friend class LogWriter;
+
   struct Message {
     QtMsgType type;
     QTime time;
@@ -85,15 +110,19 @@ private:
 
 private:
 
-  static QScopedPointer<LogBuffer> s_Instance;
+  // published without a lock so logging never blocks. Instances are only destroyed on exit,
+  // a second init retires the previous one instead
+  static std::atomic<LogBuffer*> s_Instance;
+  static std::vector<std::unique_ptr<LogBuffer>> s_Instances;
+  // serializes init
   static QMutex s_Mutex;
 
   QString m_OutFileName;
-  bool m_ShutDown;
   QtMsgType m_MinMsgType;
   size_t m_NumMessages;
   std::vector<Message> m_Messages;
-  
+  QScopedPointer<LogWriter> m_Writer;
+
 };
 
 #endif // LOGBUFFER_H
@@ -45,6 +45,8 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "moapplication.h"
 #include "tutorialmanager.h"
 #include "nxmaccessmanager.h"
+#include "phasetracer.h"
+#include <runtimemetrics.h>
 #include <eh.h>
 #include <windows_error.h>
 
@@ -452,6 +454,12 @@ int main(int argc, char *argv[])
 {
   MOApplication application(argc, argv);
 
+  if (application.arguments().contains("trace")) {
+    // record the duration of startup and refresh phases. Written to logs/trace.json on exit
+    PhaseTracer::instance().setEnabled(true);
+  }
+  TraceSpan startupSpan("startup");
+
   qDebug("application name: %s", qPrintable(application.applicationName()));
 
   QString instanceID;
@@ -492,6 +500,7 @@ int main(int argc, char *argv[])
   QSplashScreen splash(pixmap);
 
   try {
+    TraceSpan bootstrapSpan("bootstrap");
     if (!bootstrap()) {
       return -1;
     }
@@ -535,6 +544,8 @@ int main(int argc, char *argv[])
 
   QStringList arguments = application.arguments();
 
+  arguments.removeAll("trace");
+
   bool forcePrimary = false;
   if (arguments.contains("update")) {
     arguments.removeAll("update");
@@ -556,7 +567,9 @@ int main(int argc, char *argv[])
 
     QSettings settings(dataPath + "/" + QString::fromStdWString(AppConfig::iniFileName()), QSettings::IniFormat);
     qDebug("initializing core");
+    TraceSpan coreSpan("OrganizerCore");
     OrganizerCore organizer(settings);
+    coreSpan.finish();
     qDebug("initialize plugins");
     PluginContainer pluginContainer(&organizer);
     pluginContainer.loadPlugins();
@@ -595,7 +608,10 @@ int main(int argc, char *argv[])
     organizer.updateExecutablesList(settings);
 
     QString selectedProfileName = determineProfile(arguments, settings);
-    organizer.setCurrentProfile(selectedProfileName);
+    {
+      TraceSpan profileSpan("OrganizerCore::setCurrentProfile");
+      organizer.setCurrentProfile(selectedProfileName);
+    }
 
     // if we have a command line parameter, it is either a nxm link or
     // a binary to start
@@ -629,7 +645,9 @@ int main(int argc, char *argv[])
     int res = 1;
     { // scope to control lifetime of mainwindow
       // set up main window and its data structures
+      TraceSpan windowSpan("MainWindow");
       MainWindow mainWindow(argv[0], settings, organizer, pluginContainer);
+      windowSpan.finish();
 
       QObject::connect(&mainWindow, SIGNAL(styleChanged(QString)), &application, SLOT(setStyleFile(QString)));
       QObject::connect(&instance, SIGNAL(messageSent(QString)), &organizer, SLOT(externalMessage(QString)));
@@ -645,8 +663,18 @@ int main(int argc, char *argv[])
         organizer.externalMessage(arguments.at(1));
       }
       splash.finish(&mainWindow);
+      startupSpan.finish();
       res = application.exec();
     }
+    if (PhaseTracer::enabled()) {
+      PhaseTracer::instance().write(dataPath + "/logs/trace.json");
+    }
+    { // keep the numbers of this session around for comparison
+      QFile metricsFile(dataPath + "/logs/metrics.json");
+      if (metricsFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        metricsFile.write(RuntimeMetrics::instance().toJSON().c_str());
+      }
+    }
     return res;
   } catch (const std::exception &e) {
     reportError(e.what());
@@ -20,6 +20,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
+#include "datatreemodel.h"
 #include "directoryentry.h"
 #include "directoryrefresher.h"
 #include "executableinfo.h"
@@ -66,12 +67,15 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "modflagicondelegate.h"
 #include "genericicondelegate.h"
 #include "selectiondialog.h"
-#include "csvbuilder.h"
+#include "listexporter.h"
 #include "savetextasdialog.h"
+#include <runtimemetrics.h>
 #include "problemsdialog.h"
 #include "previewdialog.h"
 #include "browserdialog.h"
 #include "aboutdialog.h"
+#include "bsaextractor.h"
+#include "savegamecatalogue.h"
 #include "safewritefile.h"
 #include "nxmaccessmanager.h"
 #include "appconfig.h"
@@ -98,9 +102,11 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QDragEnterEvent>
 #include <QDropEvent>
 #include <QEvent>
+#include <QEventLoop>
 #include <QFileDialog>
 #include <QFont>
 #include <QFuture>
+#include <QFutureWatcher>
 #include <QHash>
 #include <QIODevice>
 #include <QIcon>
@@ -128,6 +134,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QRect>
 #include <QRegExp>
 #include <QResizeEvent>
+#include <QSet>
 #include <QSettings>
 #include <QScopedPointer>
 #include <QSizePolicy>
@@ -307,9 +314,10 @@ MainWindow::MainWindow(const QString &exeName
 
   connect(ui->bsaList, SIGNAL(itemsMoved()), this, SLOT(bsaList_itemMoved()));
 
-  connect(ui->dataTree, SIGNAL(itemExpanded(QTreeWidgetItem*)), this, SLOT(expandDataTreeItem(QTreeWidgetItem*)));
+  m_DataTreeModel = new DataTreeModel(this);
+  ui->dataTree->setModel(m_DataTreeModel);
 
-  connect(m_OrganizerCore.directoryRefresher(), SIGNAL(refreshed()), this, SLOT(directory_refreshed()));
+  connect(&m_OrganizerCore, SIGNAL(directoryStructureChanged()), this, SLOT(directory_refreshed()));
   connect(m_OrganizerCore.directoryRefresher(), SIGNAL(progress(int)), this, SLOT(refresher_progress(int)));
   connect(m_OrganizerCore.directoryRefresher(), SIGNAL(error(QString)), this, SLOT(showError(QString)));
 
@@ -392,6 +400,7 @@ MainWindow::~MainWindow()
   m_PluginContainer.setUserInterface(nullptr, nullptr);
   m_OrganizerCore.setUserInterface(nullptr, nullptr);
   m_IntegratedBrowser.close();
+  SaveGameCatalogue::instance()->shutdown();
   delete ui;
 }
 
@@ -664,6 +673,10 @@ void MainWindow::createHelpWidget()
   connect(issueAction, SIGNAL(triggered()), this, SLOT(issueTriggered()));
   buttonMenu->addAction(issueAction);
 
+  QAction *diagnosticsAction = new QAction(tr("Diagnostics"), buttonMenu);
+  connect(diagnosticsAction, SIGNAL(triggered()), this, SLOT(diagnosticsTriggered()));
+  buttonMenu->addAction(diagnosticsAction);
+
   QMenu *tutorialMenu = new QMenu(tr("Tutorials"), buttonMenu);
 
   typedef std::vector<std::pair<int, QAction*> > ActionList;
@@ -849,7 +862,16 @@ void MainWindow::closeEvent(QCloseEvent* event)
       event->ignore();
       return;
     } else {
-      m_OrganizerCore.downloadManager()->pauseAll();
+      // wait for the transfers to stop without spinning. User input is held back
+      // so the window can't be interacted with in the meantime
+      QFuture<bool> paused = m_OrganizerCore.downloadManager()->pauseAll();
+      if (!paused.isFinished()) {
+        QEventLoop loop;
+        QFutureWatcher<bool> watcher;
+        connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+        watcher.setFuture(paused);
+        loop.exec(QEventLoop::ExcludeUserInputEvents);
+      }
     }
   }
 
@@ -1065,132 +1087,6 @@ void MainWindow::on_profileBox_currentIndexChanged(int index)
   }
 }
 
-void MainWindow::updateTo(QTreeWidgetItem *subTree, const std::wstring &directorySoFar, const DirectoryEntry &directoryEntry, bool conflictsOnly)
-{
-  {
-    std::vector<FileEntry::Ptr> files = directoryEntry.getFiles();
-    for (auto iter = files.begin(); iter != files.end(); ++iter) {
-      FileEntry::Ptr current = *iter;
-      if (conflictsOnly && (current->getAlternatives().size() == 0)) {
-        continue;
-      }
-
-      QString fileName = ToQString(current->getName());
-      QStringList columns(fileName);
-      bool isArchive = false;
-      int originID = current->getOrigin(isArchive);
-      FilesOrigin origin = m_OrganizerCore.directoryStructure()->getOriginByID(originID);
-      QString source("data");
-      unsigned int modIndex = ModInfo::getIndex(ToQString(origin.getName()));
-      if (modIndex != UINT_MAX) {
-        ModInfo::Ptr modInfo = ModInfo::getByIndex(modIndex);
-        source = modInfo->name();
-      }
-
-      std::wstring archive = current->getArchive();
-      if (archive.length() != 0) {
-        source.append(" (").append(ToQString(archive)).append(")");
-      }
-      columns.append(source);
-      QTreeWidgetItem *fileChild = new QTreeWidgetItem(columns);
-      if (isArchive) {
-        QFont font = fileChild->font(0);
-        font.setItalic(true);
-        fileChild->setFont(0, font);
-        fileChild->setFont(1, font);
-      } else if (fileName.endsWith(ModInfo::s_HiddenExt)) {
-        QFont font = fileChild->font(0);
-        font.setStrikeOut(true);
-        fileChild->setFont(0, font);
-        fileChild->setFont(1, font);
-      }
-      fileChild->setData(0, Qt::UserRole, ToQString(current->getFullPath()));
-      fileChild->setData(0, Qt::UserRole + 1, isArchive);
-      fileChild->setData(1, Qt::UserRole, source);
-      fileChild->setData(1, Qt::UserRole + 1, originID);
-
-      std::vector<int> alternatives = current->getAlternatives();
-
-      if (!alternatives.empty()) {
-        std::wostringstream altString;
-        altString << ToWString(tr("Also in: <br>"));
-        for (std::vector<int>::iterator altIter = alternatives.begin();
-             altIter != alternatives.end(); ++altIter) {
-          if (altIter != alternatives.begin()) {
-            altString << " , ";
-          }
-          altString << "<span style=\"white-space: nowrap;\"><i>" << m_OrganizerCore.directoryStructure()->getOriginByID(*altIter).getName() << "</font></span>";
-        }
-        fileChild->setToolTip(1, QString("%1").arg(ToQString(altString.str())));
-        fileChild->setForeground(1, QBrush(Qt::red));
-      } else {
-        fileChild->setToolTip(1, tr("No conflict"));
-      }
-      subTree->addChild(fileChild);
-    }
-  }
-
-  std::wostringstream temp;
-  temp << directorySoFar << "\\" << directoryEntry.getName();
-  {
-    std::vector<DirectoryEntry*>::const_iterator current, end;
-    directoryEntry.getSubDirectories(current, end);
-    for (; current != end; ++current) {
-      QString pathName = ToQString((*current)->getName());
-      QStringList columns(pathName);
-      columns.append("");
-      if (!(*current)->isEmpty()) {
-        QTreeWidgetItem *directoryChild = new QTreeWidgetItem(columns);
-        if (conflictsOnly) {
-          updateTo(directoryChild, temp.str(), **current, conflictsOnly);
-          if (directoryChild->childCount() != 0) {
-            subTree->addChild(directoryChild);
-          } else {
-            delete directoryChild;
-          }
-        } else {
-          QTreeWidgetItem *onDemandLoad = new QTreeWidgetItem(QStringList());
-          onDemandLoad->setData(0, Qt::UserRole + 0, "__loaded_on_demand__");
-          onDemandLoad->setData(0, Qt::UserRole + 1, ToQString(temp.str()));
-          onDemandLoad->setData(0, Qt::UserRole + 2, conflictsOnly);
-          directoryChild->addChild(onDemandLoad);
-          subTree->addChild(directoryChild);
-        }
-      }
-    }
-  }
-
-  subTree->sortChildren(0, Qt::AscendingOrder);
-}
-
-void MainWindow::delayedRemove()
-{
-  foreach (QTreeWidgetItem *item, m_RemoveWidget) {
-    item->removeChild(item->child(0));
-  }
-  m_RemoveWidget.clear();
-}
-
-void MainWindow::expandDataTreeItem(QTreeWidgetItem *item)
-{
-  if ((item->childCount() == 1) && (item->child(0)->data(0, Qt::UserRole).toString() == "__loaded_on_demand__")) {
-    // read the data we need from the sub-item, then dispose of it
-    QTreeWidgetItem *onDemandDataItem = item->child(0);
-    std::wstring path = ToWString(onDemandDataItem->data(0, Qt::UserRole + 1).toString());
-    bool conflictsOnly = onDemandDataItem->data(0, Qt::UserRole + 2).toBool();
-
-    std::wstring virtualPath = (path + L"\\").substr(6) + ToWString(item->text(0));
-    DirectoryEntry *dir = m_OrganizerCore.directoryStructure()->findSubDirectoryRecursive(virtualPath);
-    if (dir != nullptr) {
-      updateTo(item, path, *dir, conflictsOnly);
-    } else {
-      qWarning("failed to update view of %ls", path.c_str());
-    }
-    m_RemoveWidget.push_back(item);
-    QTimer::singleShot(5, this, SLOT(delayedRemove()));
-  }
-}
-
 
 bool MainWindow::refreshProfiles(bool selectProfile)
 {
@@ -1255,16 +1151,9 @@ void MainWindow::refreshExecutablesList()
 
 void MainWindow::refreshDataTree()
 {
-  QCheckBox *conflictsBox = findChild<QCheckBox*>("conflictsCheckBox");
-  QTreeWidget *tree = findChild<QTreeWidget*>("dataTree");
-  tree->clear();
-  QStringList columns("data");
-  columns.append("");
-  QTreeWidgetItem *subTree = new QTreeWidgetItem(columns);
-  updateTo(subTree, L"", *m_OrganizerCore.directoryStructure(), conflictsBox->isChecked());
-  tree->insertTopLevelItem(0, subTree);
-  subTree->setExpanded(true);
-  tree->header()->resizeSection(0, 200);
+  m_DataTreeModel->refresh(m_OrganizerCore.directoryStructure(), ui->conflictsCheckBox->isChecked());
+  ui->dataTree->expand(m_DataTreeModel->index(0, 0));
+  ui->dataTree->header()->resizeSection(0, 200);
 }
 
 
@@ -1311,21 +1200,40 @@ void MainWindow::stopMonitorSaves()
 
 void MainWindow::refreshSaveList()
 {
-  ui->savegameList->clear();
-
   startMonitorSaves(); // re-starts monitoring
 
-  QStringList filters;
-  filters << QString("*.") + m_OrganizerCore.managedGame()->savegameExtension();
+  SaveGameInfo const *info = m_OrganizerCore.managedGame()->feature<SaveGameInfo>();
+  QList<SaveGameCatalogue::Entry> saves = SaveGameCatalogue::instance()->saves(
+        currentSavesDir().absolutePath(), m_OrganizerCore.managedGame()->savegameExtension(), info);
+
+  // update the list in place so selection and scroll position survive the refresh
+  QSet<QString> paths;
+  for (const SaveGameCatalogue::Entry &save : saves) {
+    paths.insert(save.path);
+  }
 
-  QDir savesDir = currentSavesDir();
-  savesDir.setNameFilters(filters);
+  QHash<QString, QListWidgetItem*> items;
+  for (int i = ui->savegameList->count() - 1; i >= 0; --i) {
+    QListWidgetItem *item = ui->savegameList->item(i);
+    QString path = item->data(Qt::UserRole).toString();
+    if (paths.contains(path)) {
+      items.insert(path, item);
+    } else {
+      delete item;
+    }
+  }
 
-  QFileInfoList files = savesDir.entryInfoList(QDir::Files, QDir::Time);
-  foreach (const QFileInfo &file, files) {
-    QListWidgetItem *item = new QListWidgetItem(file.fileName());
-    item->setData(Qt::UserRole, file.absoluteFilePath());
-    ui->savegameList->addItem(item);
+  for (int row = 0; row < saves.size(); ++row) {
+    const QString &path = saves[row].path;
+    QListWidgetItem *item = items.value(path, nullptr);
+    if (item == nullptr) {
+      item = new QListWidgetItem(QFileInfo(path).fileName());
+      item->setData(Qt::UserRole, path);
+      ui->savegameList->insertItem(row, item);
+    } else if (ui->savegameList->item(row) != item) {
+      ui->savegameList->takeItem(ui->savegameList->row(item));
+      ui->savegameList->insertItem(row, item);
+    }
   }
 }
 
@@ -1843,6 +1751,13 @@ void MainWindow::issueTriggered()
   ::ShellExecuteW(nullptr, L"open", L"http://issue.tannin.eu/tbg", nullptr, nullptr, SW_SHOWNORMAL);
 }
 
+void MainWindow::diagnosticsTriggered()
+{
+  SaveTextAsDialog dialog(this);
+  dialog.setText(QString::fromStdString(RuntimeMetrics::instance().toText()));
+  dialog.exec();
+}
+
 void MainWindow::tutorialTriggered()
 {
   QAction *tutorialAction = qobject_cast<QAction*>(sender());
@@ -3010,19 +2925,13 @@ void MainWindow::exportModListCSV()
     unsigned int numMods = ModInfo::getNumMods();
 
     try {
-      QBuffer buffer;
-      buffer.open(QIODevice::ReadWrite);
-      CSVBuilder builder(&buffer);
-      builder.setEscapeMode(CSVBuilder::TYPE_STRING, CSVBuilder::QUOTE_ALWAYS);
-      std::vector<std::pair<QString, CSVBuilder::EFieldType> > fields;
+      ExportSource::Columns fields;
       fields.push_back(std::make_pair(QString("mod_id"), CSVBuilder::TYPE_INTEGER));
       fields.push_back(std::make_pair(QString("mod_installed_name"), CSVBuilder::TYPE_STRING));
       fields.push_back(std::make_pair(QString("mod_version"), CSVBuilder::TYPE_STRING));
       fields.push_back(std::make_pair(QString("file_installed_name"), CSVBuilder::TYPE_STRING));
 //      fields.push_back(std::make_pair(QString("file_category"), CSVBuilder::TYPE_INTEGER));
-      builder.setFields(fields);
-
-      builder.writeHeader();
+      TableExportSource *source = new TableExportSource(fields);
 
       for (unsigned int i = 0; i < numMods; ++i) {
         ModInfo::Ptr info = ModInfo::getByIndex(i);
@@ -3035,14 +2944,18 @@ void MainWindow::exportModListCSV()
         std::vector<ModInfo::EFlag> flags = info->getFlags();
         if ((std::find(flags.begin(), flags.end(), ModInfo::FLAG_OVERWRITE) == flags.end()) &&
             (std::find(flags.begin(), flags.end(), ModInfo::FLAG_BACKUP) == flags.end())) {
-          builder.setRowField("mod_id", info->getNexusID());
-          builder.setRowField("mod_installed_name", info->name());
-          builder.setRowField("mod_version", info->getVersion().canonicalString());
-          builder.setRowField("file_installed_name", info->getInstallationFile());
-          builder.writeRow();
+          source->addRow({ info->getNexusID(), info->name(),
+                           info->getVersion().canonicalString(), info->getInstallationFile() });
         }
       }
 
+      QBuffer buffer;
+      buffer.open(QIODevice::ReadWrite);
+      ListExporter exporter(source, ListExporter::FORMAT_CSV);
+      if (!exporter.write(&buffer)) {
+        throw MyException(exporter.errorString());
+      }
+
       SaveTextAsDialog saveDialog(this);
       saveDialog.setText(buffer.data());
       saveDialog.exec();
@@ -3241,12 +3154,7 @@ void MainWindow::deleteSavegame_clicked()
     }
     ++count;
 
-    if (info == nullptr) {
-      deleteFiles.push_back(name);
-    } else {
-      ISaveGame const *save = info->getSaveGameInfo(name);
-      deleteFiles += save->allFiles();
-    }
+    deleteFiles += SaveGameCatalogue::instance()->allFiles(name, info);
   }
 
   if (count > 10) {
@@ -3493,43 +3401,47 @@ void MainWindow::languageChange(const QString &newLanguage)
   ui->listOptionsBtn->setMenu(modListContextMenu());
 }
 
-void MainWindow::writeDataToFile(QFile &file, const QString &directory, const DirectoryEntry &directoryEntry)
-{
-  for (FileEntry::Ptr current : directoryEntry.getFiles()) {
-    bool isArchive = false;
-    int origin = current->getOrigin(isArchive);
-    if (isArchive) {
-      // TODO: don't list files from archives. maybe make this an option?
-      continue;
-    }
-    QString fullName = directory + "\\" + ToQString(current->getName());
-    file.write(fullName.toUtf8());
-
-    file.write("\t(");
-    file.write(ToQString(m_OrganizerCore.directoryStructure()->getOriginByID(origin).getName()).toUtf8());
-    file.write(")\r\n");
-  }
-
-  // recurse into subdirectories
-  std::vector<DirectoryEntry*>::const_iterator current, end;
-  directoryEntry.getSubDirectories(current, end);
-  for (; current != end; ++current) {
-    writeDataToFile(file, directory + "\\" + ToQString((*current)->getName()), **current);
-  }
-}
-
 void MainWindow::writeDataToFile()
 {
-  QString fileName = QFileDialog::getSaveFileName(this);
-  QFile file(fileName);
-  if (!file.open(QIODevice::WriteOnly)) {
-    reportError(tr("failed to write to file %1").arg(fileName));
+  QString fileName = QFileDialog::getSaveFileName(this, QString(), QString(),
+                                                  tr("Text Files (*.txt);;CSV Files (*.csv)"));
+  if (fileName.isEmpty()) {
+    return;
   }
 
-  writeDataToFile(file, "data", *m_OrganizerCore.directoryStructure());
-  file.close();
-
-  MessageDialog::showMessage(tr("%1 written").arg(QDir::toNativeSeparators(fileName)), this);
+  ListExporter::EFormat format = fileName.endsWith(".csv", Qt::CaseInsensitive) ? ListExporter::FORMAT_CSV
+                                                                                : ListExporter::FORMAT_LINES;
+  // the structure is traversed by the export thread. Pinning it keeps a refresh from deleting it,
+  // the modal progress dialog keeps the user from changing it
+  OrganizerCore *core = &m_OrganizerCore;
+  const DirectoryEntry *structure = core->pinStructure();
+  ListExporter *exporter = new ListExporter(new DataTreeExportSource(*structure, "data",
+                                                                     [core] () { core->releaseStructure(); }),
+                                            format, this);
+  exporter->setColumns(QStringList() << "path" << "origin");
+  // TODO: don't list files from archives. maybe make this an option?
+  exporter->addFilter("archive", [] (const QVariant &archive) { return archive.toInt() == 0; });
+
+  QProgressDialog *progress = new QProgressDialog(this);
+  progress->setLabelText(tr("Writing %1").arg(QDir::toNativeSeparators(fileName)));
+  progress->setMaximum(100);
+  progress->setValue(0);
+  progress->setAutoClose(false);
+  progress->setWindowModality(Qt::WindowModal);
+  connect(progress, SIGNAL(canceled()), exporter, SLOT(cancel()));
+  connect(exporter, &ListExporter::progress, progress, &QProgressDialog::setValue);
+  connect(exporter, &ListExporter::finished, this, [this, exporter, progress, fileName] (bool success) {
+    bool canceled = progress->wasCanceled();
+    progress->deleteLater();
+    exporter->deleteLater();
+    if (success) {
+      MessageDialog::showMessage(tr("%1 written").arg(QDir::toNativeSeparators(fileName)), this);
+    } else if (!canceled) {
+      reportError(tr("failed to write to file %1: %2").arg(fileName, exporter->errorString()));
+    }
+  });
+  progress->show();
+  exporter->start(fileName);
 }
 
 
@@ -3590,8 +3502,8 @@ int MainWindow::getBinaryExecuteInfo(const QFileInfo &targetInfo, QFileInfo &bin
 
 void MainWindow::addAsExecutable()
 {
-  if (m_ContextItem != nullptr) {
-    QFileInfo targetInfo(m_ContextItem->data(0, Qt::UserRole).toString());
+  if (m_DataContextIdx.isValid()) {
+    QFileInfo targetInfo(m_DataContextIdx.data(Qt::UserRole).toString());
     QFileInfo binaryInfo;
     QString arguments;
     switch (getBinaryExecuteInfo(targetInfo, binaryInfo, arguments)) {
@@ -3633,7 +3545,7 @@ void MainWindow::originModified(int originID)
 
 void MainWindow::hideFile()
 {
-  QString oldName = m_ContextItem->data(0, Qt::UserRole).toString();
+  QString oldName = m_DataContextIdx.data(Qt::UserRole).toString();
   QString newName = oldName + ModInfo::s_HiddenExt;
 
   if (QFileInfo(newName).exists()) {
@@ -3649,7 +3561,7 @@ void MainWindow::hideFile()
   }
 
   if (QFile::rename(oldName, newName)) {
-    originModified(m_ContextItem->data(1, Qt::UserRole + 1).toInt());
+    originModified(m_DataContextIdx.sibling(m_DataContextIdx.row(), DataTreeModel::COL_ORIGIN).data(Qt::UserRole + 1).toInt());
     refreshDataTree();
   } else {
     reportError(tr("failed to rename \"%1\" to \"%2\"").arg(oldName).arg(QDir::toNativeSeparators(newName)));
@@ -3659,7 +3571,7 @@ void MainWindow::hideFile()
 
 void MainWindow::unhideFile()
 {
-  QString oldName = m_ContextItem->data(0, Qt::UserRole).toString();
+  QString oldName = m_DataContextIdx.data(Qt::UserRole).toString();
   QString newName = oldName.left(oldName.length() - ModInfo::s_HiddenExt.length());
   if (QFileInfo(newName).exists()) {
     if (QMessageBox::question(this, tr("Replace file?"), tr("There already is a visible version of this file. Replace it?"),
@@ -3673,7 +3585,7 @@ void MainWindow::unhideFile()
     }
   }
   if (QFile::rename(oldName, newName)) {
-    originModified(m_ContextItem->data(1, Qt::UserRole + 1).toInt());
+    originModified(m_DataContextIdx.sibling(m_DataContextIdx.row(), DataTreeModel::COL_ORIGIN).data(Qt::UserRole + 1).toInt());
     refreshDataTree();
   } else {
     reportError(tr("failed to rename \"%1\" to \"%2\"").arg(QDir::toNativeSeparators(oldName)).arg(QDir::toNativeSeparators(newName)));
@@ -3682,7 +3594,7 @@ void MainWindow::unhideFile()
 
 void MainWindow::previewDataFile()
 {
-  QString fileName = QDir::fromNativeSeparators(m_ContextItem->data(0, Qt::UserRole).toString());
+  QString fileName = QDir::fromNativeSeparators(m_DataContextIdx.data(Qt::UserRole).toString());
 
   // what we have is an absolute path to the file in its actual location (for the primary origin)
   // what we want is the path relative to the virtual data directory
@@ -3728,8 +3640,8 @@ void MainWindow::previewDataFile()
 
 void MainWindow::openDataFile()
 {
-  if (m_ContextItem != nullptr) {
-    QFileInfo targetInfo(m_ContextItem->data(0, Qt::UserRole).toString());
+  if (m_DataContextIdx.isValid()) {
+    QFileInfo targetInfo(m_DataContextIdx.data(Qt::UserRole).toString());
     QFileInfo binaryInfo;
     QString arguments;
     switch (getBinaryExecuteInfo(targetInfo, binaryInfo, arguments)) {
@@ -3784,22 +3696,23 @@ void MainWindow::notEndorsedYet()
 
 void MainWindow::on_dataTree_customContextMenuRequested(const QPoint &pos)
 {
-  QTreeWidget *dataTree = findChild<QTreeWidget*>("dataTree");
-  m_ContextItem = dataTree->itemAt(pos.x(), pos.y());
+  QTreeView *dataTree = ui->dataTree;
+  QModelIndex index = dataTree->indexAt(pos);
+  m_DataContextIdx = index.sibling(index.row(), DataTreeModel::COL_NAME);
 
   QMenu menu;
-  if ((m_ContextItem != nullptr) && (m_ContextItem->childCount() == 0)) {
+  if (m_DataTreeModel->isFile(m_DataContextIdx)) {
     menu.addAction(tr("Open/Execute"), this, SLOT(openDataFile()));
     menu.addAction(tr("Add as Executable"), this, SLOT(addAsExecutable()));
 
-    QString fileName = m_ContextItem->text(0);
+    QString fileName = m_DataContextIdx.data().toString();
     if (m_PluginContainer.previewGenerator().previewSupported(QFileInfo(fileName).suffix())) {
       menu.addAction(tr("Preview"), this, SLOT(previewDataFile()));
     }
 
     // offer to hide/unhide file, but not for files from archives
-    if (!m_ContextItem->data(0, Qt::UserRole + 1).toBool()) {
-      if (m_ContextItem->text(0).endsWith(ModInfo::s_HiddenExt)) {
+    if (!m_DataContextIdx.data(Qt::UserRole + 1).toBool()) {
+      if (fileName.endsWith(ModInfo::s_HiddenExt)) {
         menu.addAction(tr("Un-Hide"), this, SLOT(unhideFile()));
       } else {
         menu.addAction(tr("Hide"), this, SLOT(hideFile()));
@@ -3972,81 +3885,40 @@ void MainWindow::nxmRequestFailed(int modID, int, QVariant, int, const QString &
 }
 
 
-BSA::EErrorCode MainWindow::extractBSA(BSA::Archive &archive, BSA::Folder::Ptr folder, const QString &destination,
-                           QProgressDialog &progress)
-{
-  QDir().mkdir(destination);
-  BSA::EErrorCode result = BSA::ERROR_NONE;
-  QString errorFile;
-
-  for (unsigned int i = 0; i < folder->getNumFiles(); ++i) {
-    BSA::File::Ptr file = folder->getFile(i);
-    BSA::EErrorCode res = archive.extract(file, destination.toUtf8().constData());
-    if (res != BSA::ERROR_NONE) {
-      reportError(tr("failed to read %1: %2").arg(file->getName().c_str()).arg(res));
-      result = res;
-    }
-    progress.setLabelText(file->getName().c_str());
-    progress.setValue(progress.value() + 1);
-    QCoreApplication::processEvents();
-    if (progress.wasCanceled()) {
-      result = BSA::ERROR_CANCELED;
-    }
-  }
-
-  if (result != BSA::ERROR_NONE) {
-    if (QMessageBox::critical(this, tr("Error"), tr("failed to extract %1 (errorcode %2)").arg(errorFile).arg(result),
-                              QMessageBox::Ok | QMessageBox::Cancel) == QMessageBox::Cancel) {
-      return result;
-    }
-  }
-
-  for (unsigned int i = 0; i < folder->getNumSubFolders(); ++i) {
-    BSA::Folder::Ptr subFolder = folder->getSubFolder(i);
-    BSA::EErrorCode res = extractBSA(archive, subFolder,
-                                     destination.mid(0).append("/").append(subFolder->getName().c_str()), progress);
-    if (res != BSA::ERROR_NONE) {
-      return res;
-    }
-  }
-  return BSA::ERROR_NONE;
-}
-
-
-bool MainWindow::extractProgress(QProgressDialog &progress, int percentage, std::string fileName)
-{
-  progress.setLabelText(fileName.c_str());
-  progress.setValue(percentage);
-  QCoreApplication::processEvents();
-  return !progress.wasCanceled();
-}
-
-
 void MainWindow::extractBSATriggered()
 {
   QTreeWidgetItem *item = m_ContextItem;
 
   QString targetFolder = FileDialogMemory::getExistingDirectory("extractBSA", this, tr("Extract BSA"));
   if (!targetFolder.isEmpty()) {
-    BSA::Archive archive;
     QString originPath = QDir::fromNativeSeparators(ToQString(m_OrganizerCore.directoryStructure()->getOriginByName(ToWString(item->text(1))).getPath()));
     QString archivePath =  QString("%1\\%2").arg(originPath).arg(item->text(0));
 
-    BSA::EErrorCode result = archive.read(archivePath.toLocal8Bit().constData(), true);
-    if ((result != BSA::ERROR_NONE) && (result != BSA::ERROR_INVALIDHASHES)) {
-      reportError(tr("failed to read %1: %2").arg(archivePath).arg(result));
-      return;
-    }
-
-    QProgressDialog progress(this);
-    progress.setMaximum(100);
-    progress.setValue(0);
-    progress.show();
-    archive.extractAll(QDir::toNativeSeparators(targetFolder).toLocal8Bit().constData(),
-                       boost::bind(&MainWindow::extractProgress, this, boost::ref(progress), _1, _2));
-    if (result == BSA::ERROR_INVALIDHASHES) {
-      reportError(tr("This archive contains invalid hashes. Some files may be broken."));
-    }
+    // extraction runs in the background, the dialog only reports progress
+    BSAExtractor *extractor = new BSAExtractor(archivePath, targetFolder, this);
+    QProgressDialog *progress = new QProgressDialog(this);
+    progress->setMaximum(100);
+    progress->setValue(0);
+    progress->setAutoClose(false);
+    connect(progress, SIGNAL(canceled()), extractor, SLOT(cancel()));
+    connect(extractor, &BSAExtractor::progress, progress, [progress] (int percentage, const QString &fileName) {
+      progress->setLabelText(fileName);
+      progress->setValue(percentage);
+    });
+    connect(extractor, &BSAExtractor::finished, this, [this, extractor, progress] () {
+      progress->deleteLater();
+      extractor->deleteLater();
+      if (extractor->invalidHashes()) {
+        reportError(tr("This archive contains invalid hashes. Some files may be broken."));
+      }
+      QStringList errors = extractor->errors();
+      if (!errors.isEmpty()) {
+        reportError(errors.size() == 1 ? errors.first()
+                                       : tr("%1 (and %2 more errors)").arg(errors.first()).arg(errors.size() - 1));
+      }
+    });
+    progress->show();
+    extractor->start();
   }
 }
 
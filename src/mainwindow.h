@@ -35,6 +35,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 //when I get round to cleaning up main.cpp
 struct Executable;
 class CategoryFactory;
+class DataTreeModel;
 class LockedDialog;
 class OrganizerCore;
 #include "plugincontainer.h" //class PluginContainer;
@@ -202,7 +203,6 @@ private:
 
   void startSteam();
 
-  void updateTo(QTreeWidgetItem *subTree, const std::wstring &directorySoFar, const MOShared::DirectoryEntry &directoryEntry, bool conflictsOnly);
   bool refreshProfiles(bool selectProfile = true);
   void refreshExecutablesList();
   void installMod(QString fileName = "");
@@ -213,7 +213,6 @@ private:
   void displayModInformation(int row, int tab = 0);
   void testExtractBSA(int modIndex);
 
-  void writeDataToFile(QFile &file, const QString &directory, const MOShared::DirectoryEntry &directoryEntry);
 
   void renameModInList(QFile &modList, const QString &oldName, const QString &newName);
 
@@ -245,7 +244,6 @@ private:
 
   void createHelpWidget();
 
-  bool extractProgress(QProgressDialog &extractProgress, int percentage, std::string fileName);
 
   int checkForProblems();
 
@@ -313,11 +311,14 @@ private:
 
   PluginListSortProxy *m_PluginListSortProxy;
 
+  DataTreeModel *m_DataTreeModel;
+
   int m_OldExecutableIndex;
 
   int m_ContextRow;
   QPersistentModelIndex m_ContextIdx;
   QTreeWidgetItem *m_ContextItem;
+  QPersistentModelIndex m_DataContextIdx;
   QAction *m_ContextAction;
 
   CategoryFactory &m_CategoryFactory;
@@ -344,8 +345,6 @@ private:
 
   QFileSystemWatcher m_SavesWatcher;
 
-  std::vector<QTreeWidgetItem*> m_RemoveWidget;
-
   QByteArray m_ArchiveListHash;
 
   bool m_DidUpdateMasterList;
@@ -374,6 +373,7 @@ private slots:
   // main window actions
   void helpTriggered();
   void issueTriggered();
+  void diagnosticsTriggered();
   void wikiTriggered();
   void tutorialTriggered();
   void extractBSATriggered();
@@ -412,7 +412,6 @@ private slots:
 
   void windowTutorialFinished(const QString &windowName);
 
-  BSA::EErrorCode extractBSA(BSA::Archive &archive, BSA::Folder::Ptr folder, const QString &destination, QProgressDialog &extractProgress);
 
   void createModFromOverwrite();
 
@@ -513,9 +512,7 @@ private slots:
   void unignoreUpdate();
 
   void refreshSavesIfOpen();
-  void expandDataTreeItem(QTreeWidgetItem *item);
   void about();
-  void delayedRemove();
 
   void modlistSelectionChanged(const QModelIndex &current, const QModelIndex &previous);
   void modListSortIndicatorChanged(int column, Qt::SortOrder order);
@@ -0,0 +1,140 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "modfilescanner.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QRunnable>
+#include <QThread>
+
+#include <algorithm>
+
+
+class ModFileScanWorker : public QRunnable
+{
+public:
+  ModFileScanWorker(ModFileScanner *scanner, bool scan)
+    : m_Scanner(scanner), m_Scan(scan) {}
+
+  virtual void run()
+  {
+    if (m_Scan) {
+      m_Scanner->scan();
+    } else {
+      m_Scanner->loadThumbnails();
+    }
+    m_Scanner->workerDone();
+  }
+
+private:
+  ModFileScanner *m_Scanner;
+  bool m_Scan;
+};
+
+
+ModFileScanner::ModFileScanner(const QString &rootPath, const QString &thumbnailDirectory, QObject *parent)
+  : QObject(parent)
+  , m_RootPath(rootPath)
+  , m_Thumbnails(thumbnailDirectory)
+{
+}
+
+
+ModFileScanner::~ModFileScanner()
+{
+  cancel();
+  // the workers access members that are destroyed before the pool
+  m_Pool.waitForDone();
+}
+
+
+void ModFileScanner::start()
+{
+  m_Images.clear();
+  m_NextImage.store(0);
+  m_Canceled.store(0);
+  m_Pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount(), static_cast<int>(MAX_THREADS)));
+  m_ActiveWorkers.store(1);
+  m_Pool.start(new ModFileScanWorker(this, true));
+}
+
+
+void ModFileScanner::cancel()
+{
+  m_Canceled.store(1);
+}
+
+
+void ModFileScanner::scan()
+{
+  QStringList batch;
+  QDirIterator dirIterator(m_RootPath, QDir::Files, QDirIterator::Subdirectories);
+  while (dirIterator.hasNext() && (m_Canceled.load() == 0)) {
+    QString fileName = dirIterator.next();
+    batch.append(fileName);
+    if (batch.size() >= BATCH_SIZE) {
+      emit filesFound(batch);
+      batch.clear();
+    }
+    if (fileName.endsWith(".png", Qt::CaseInsensitive) ||
+        fileName.endsWith(".jpg", Qt::CaseInsensitive)) {
+      m_Images.append(fileName);
+    }
+  }
+  if (!batch.isEmpty()) {
+    emit filesFound(batch);
+  }
+
+  if ((m_Canceled.load() != 0) || m_Images.isEmpty()) {
+    return;
+  }
+
+  // this worker continues with thumbnails as well so only start the additional ones
+  int additional = std::min(m_Pool.maxThreadCount(), m_Images.size()) - 1;
+  m_ActiveWorkers.fetchAndAddOrdered(additional);
+  for (int i = 0; i < additional; ++i) {
+    m_Pool.start(new ModFileScanWorker(this, false));
+  }
+  loadThumbnails();
+}
+
+
+void ModFileScanner::loadThumbnails()
+{
+  while (m_Canceled.load() == 0) {
+    int index = m_NextImage.fetchAndAddOrdered(1);
+    if (index >= m_Images.size()) {
+      break;
+    }
+    QString fileName = m_Images.at(index);
+    QImage thumbnail = m_Thumbnails.thumbnail(fileName);
+    if (!thumbnail.isNull()) {
+      emit thumbnailLoaded(index, fileName, thumbnail);
+    }
+  }
+}
+
+
+void ModFileScanner::workerDone()
+{
+  if (m_ActiveWorkers.fetchAndAddOrdered(-1) == 1) {
+    emit finished();
+  }
+}
@@ -0,0 +1,108 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MODFILESCANNER_H
+#define MODFILESCANNER_H
+
+#include "thumbnailcache.h"
+
+#include <QAtomicInt>
+#include <QImage>
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+
+
+/**
+ * @brief lists the files of a mod and creates thumbnails for its images in the background
+ *
+ * File names are reported in batches in the order they are found. Once the directory has been
+ * walked the images are handed to a pool of workers, so thumbnails may arrive out of order;
+ * their index tells the position of the image among all images found.
+ * Signals are emitted from the worker threads, receivers in other threads get them queued.
+ */
+class ModFileScanner : public QObject
+{
+
+  Q_OBJECT
+
+public:
+
+  /**
+   * @param rootPath directory to scan
+   * @param thumbnailDirectory directory of the thumbnail cache
+   * @param parent parent object
+   */
+  ModFileScanner(const QString &rootPath, const QString &thumbnailDirectory, QObject *parent = nullptr);
+
+  /**
+   * @brief cancels the scan if it's still running and waits for the workers to stop
+   */
+  ~ModFileScanner();
+
+  void start();
+
+public slots:
+
+  void cancel();
+
+signals:
+
+  /**
+   * @param fileNames absolute paths of the files found since the last batch
+   */
+  void filesFound(const QStringList &fileNames);
+
+  void thumbnailLoaded(int index, const QString &fileName, const QImage &thumbnail);
+
+  /**
+   * @brief emitted once all workers have stopped, whether they completed or not
+   */
+  void finished();
+
+private:
+
+  friend class ModFileScanWorker;
+
+  static const int BATCH_SIZE = 256;
+  static const int MAX_THREADS = 4;
+
+private:
+
+  void scan();
+  void loadThumbnails();
+  void workerDone();
+
+private:
+
+  QString m_RootPath;
+  ThumbnailCache m_Thumbnails;
+
+  QThreadPool m_Pool;
+
+  // written by the scan before any thumbnail worker is started
+  QStringList m_Images;
+
+  QAtomicInt m_NextImage;
+  QAtomicInt m_ActiveWorkers;
+  QAtomicInt m_Canceled;
+
+};
+
+#endif // MODFILESCANNER_H
@@ -30,6 +30,8 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "overwriteinfodialog.h"
 #include "filenamestring.h"
 #include "versioninfo.h"
+#include "phasetracer.h"
+#include <runtimemetrics.h>
 
 #include <iplugingame.h>
 #include <versioninfo.h>
@@ -118,6 +120,9 @@ unsigned int ModInfo::getNumMods()
 
 ModInfo::Ptr ModInfo::getByIndex(unsigned int index)
 {
+  static MetricCounter &s_Calls = RuntimeMetrics::instance().counter("modinfo.getByIndex");
+  s_Calls.increment();
+
   QMutexLocker locker(&s_Mutex);
 
   if (index >= s_Collection.size()) {
@@ -206,6 +211,8 @@ void ModInfo::updateFromDisc(const QString &modDirectory,
                              bool displayForeign,
                              MOBase::IPluginGame const *game)
 {
+  TraceSpan span("ModInfo::updateFromDisc");
+
   QMutexLocker lock(&s_Mutex);
   s_Collection.clear();
   s_NextID = 0;
@@ -29,6 +29,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "questionboxmemory.h"
 #include "settings.h"
 #include "categories.h"
+#include "modfilescanner.h"
 
 #include <QDir>
 #include <QDirIterator>
@@ -41,7 +42,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <Shlwapi.h>
 
-#include <sstream>
+#include <iterator>
 
 
 using namespace MOBase;
@@ -66,7 +67,8 @@ static bool operator<(const ModFileListWidget &LHS, const ModFileListWidget &RHS
 
 ModInfoDialog::ModInfoDialog(ModInfo::Ptr modInfo, const DirectoryEntry *directory, bool unmanaged, QWidget *parent)
   : TutorableDialog("ModInfoDialog", parent), ui(new Ui::ModInfoDialog), m_ModInfo(modInfo),
-  m_ThumbnailMapper(this), m_RequestStarted(false),
+  m_ThumbnailMapper(this), m_FileScanner(nullptr), m_InitialTab(nullptr), m_PendingTab(nullptr),
+  m_RequestStarted(false),
   m_DeleteAction(nullptr), m_RenameAction(nullptr), m_OpenAction(nullptr),
   m_Directory(directory), m_Origin(nullptr)
 {
@@ -98,7 +100,7 @@ ModInfoDialog::ModInfoDialog(ModInfo::Ptr modInfo, const DirectoryEntry *directo
     }
   }
 
-  refreshLists();
+  refreshConflictLists();
 
   if (unmanaged) {
     ui->tabWidget->setTabEnabled(TAB_INIFILES, false);
@@ -113,9 +115,8 @@ ModInfoDialog::ModInfoDialog(ModInfo::Ptr modInfo, const DirectoryEntry *directo
     initFiletree(modInfo);
     addCategories(CategoryFactory::instance(), modInfo->getCategories(), ui->categoriesTree->invisibleRootItem(), 0);
     refreshPrimaryCategoriesBox();
-    ui->tabWidget->setTabEnabled(TAB_TEXTFILES, ui->textFileList->count() != 0);
-    ui->tabWidget->setTabEnabled(TAB_IMAGES, ui->thumbnailArea->count() != 0);
-    ui->tabWidget->setTabEnabled(TAB_ESPS, (ui->inactiveESPList->count() != 0) || (ui->activeESPList->count() != 0));
+    refreshINITweakFiles();
+    startFileScan();
   }
   initINITweaks();
 
@@ -128,18 +129,15 @@ ModInfoDialog::ModInfoDialog(ModInfo::Ptr modInfo, const DirectoryEntry *directo
   ui->endorseBtn->setEnabled((m_ModInfo->endorsedState() == ModInfo::ENDORSED_FALSE) ||
                              (m_ModInfo->endorsedState() == ModInfo::ENDORSED_NEVER));
 
-  // activate first enabled tab
-  for (int i = 0; i < ui->tabWidget->count(); ++i) {
-    if (ui->tabWidget->isTabEnabled(i)) {
-      ui->tabWidget->setCurrentIndex(i);
-      break;
-    }
-  }
+  activateFirstEnabledTab();
+  m_InitialTab = ui->tabWidget->currentWidget();
 }
 
 
 ModInfoDialog::~ModInfoDialog()
 {
+  // stop the scan before the widgets it reports to go away
+  delete m_FileScanner;
   m_ModInfo->setNotes(ui->notesEdit->toPlainText());
   saveCategories(ui->categoriesTree->invisibleRootItem());
   saveIniTweaks(); // ini tweaks are written to the ini file directly. This is the only information not managed by ModInfo
@@ -243,7 +241,7 @@ QByteArray ModInfoDialog::saveTabState() const
 }
 
 
-void ModInfoDialog::refreshLists()
+void ModInfoDialog::refreshConflictLists()
 {
   int numNonConflicting = 0;
   int numOverwrite = 0;
@@ -253,99 +251,171 @@ void ModInfoDialog::refreshLists()
   ui->overwrittenTree->clear();
 
   if (m_Origin != nullptr) {
+    // most files conflict with the same few origins, convert each name only once
+    std::map<int, QString> originNames;
+    auto originName = [&] (int originID) -> const QString& {
+      auto iter = originNames.find(originID);
+      if (iter == originNames.end()) {
+        iter = originNames.insert(std::make_pair(originID, ToQString(m_Directory->getOriginByID(originID).getName()))).first;
+      }
+      return iter->second;
+    };
+
+    QList<QTreeWidgetItem*> overwriteItems;
+    QList<QTreeWidgetItem*> overwrittenItems;
     std::vector<FileEntry::Ptr> files = m_Origin->getFiles();
     for (auto iter = files.begin(); iter != files.end(); ++iter) {
       QString relativeName = QDir::fromNativeSeparators(ToQString((*iter)->getRelativePath()));
       QString fileName = relativeName.mid(0).prepend(m_RootPath);
       bool archive;
-      if ((*iter)->getOrigin(archive) == m_Origin->getID()) {
+      int originID = (*iter)->getOrigin(archive);
+      if (originID == m_Origin->getID()) {
         std::vector<int> alternatives = (*iter)->getAlternatives();
         if (!alternatives.empty()) {
-          std::wostringstream altString;
-          for (std::vector<int>::iterator altIter = alternatives.begin();
-               altIter != alternatives.end(); ++altIter) {
-            if (altIter != alternatives.begin()) {
-              altString << ", ";
-            }
-            altString << m_Directory->getOriginByID(*altIter).getName();
+          QStringList altNames;
+          for (int altID : alternatives) {
+            altNames.append(originName(altID));
           }
           QStringList fields(relativeName.prepend("..."));
-          fields.append(ToQString(altString.str()));
+          fields.append(altNames.join(", "));
           QTreeWidgetItem *item = new QTreeWidgetItem(fields);
           item->setData(0, Qt::UserRole, fileName);
-          item->setData(1, Qt::UserRole, ToQString(m_Directory->getOriginByID(alternatives[0]).getName()));
+          item->setData(1, Qt::UserRole, altNames.at(0));
           item->setData(1, Qt::UserRole + 1, alternatives[0]);
           item->setData(1, Qt::UserRole + 2, archive);
-          ui->overwriteTree->addTopLevelItem(item);
+          overwriteItems.append(item);
           ++numOverwrite;
         } else {// otherwise don't display the file
           ++numNonConflicting;
         }
       } else {
-        FilesOrigin &realOrigin = m_Directory->getOriginByID((*iter)->getOrigin(archive));
         QStringList fields(relativeName);
-        fields.append(ToQString(realOrigin.getName()));
+        fields.append(originName(originID));
         QTreeWidgetItem *item = new QTreeWidgetItem(fields);
-        item->setData(1, Qt::UserRole, ToQString(realOrigin.getName()));
-        ui->overwrittenTree->addTopLevelItem(item);
+        item->setData(1, Qt::UserRole, fields.at(1));
+        overwrittenItems.append(item);
         ++numOverwritten;
       }
     }
+    ui->overwriteTree->addTopLevelItems(overwriteItems);
+    ui->overwrittenTree->addTopLevelItems(overwrittenItems);
   }
 
-  if (m_RootPath.length() > 0) {
-    QDirIterator dirIterator(m_RootPath, QDir::Files, QDirIterator::Subdirectories);
-    while (dirIterator.hasNext()) {
-      QString fileName = dirIterator.next();
-
-      if (fileName.endsWith(".txt", Qt::CaseInsensitive)) {
-        ui->textFileList->addItem(fileName.mid(m_RootPath.length() + 1));
-      } else if ((fileName.endsWith(".ini", Qt::CaseInsensitive) || fileName.endsWith(".cfg", Qt::CaseInsensitive)) &&
-                 !fileName.endsWith("meta.ini")) {
-        QString namePart = fileName.mid(m_RootPath.length() + 1);
-        if (namePart.startsWith("INI Tweaks", Qt::CaseInsensitive)) {
-          QListWidgetItem *newItem = new QListWidgetItem(namePart.mid(11), ui->iniTweaksList);
-          newItem->setData(Qt::UserRole, namePart);
-          newItem->setFlags(newItem->flags() | Qt::ItemIsUserCheckable);
-          newItem->setCheckState(Qt::Unchecked);
-          ui->iniTweaksList->addItem(newItem);
-        } else {
-          ui->iniFileList->addItem(namePart);
-        }
-      } else if (fileName.endsWith(".esp", Qt::CaseInsensitive) ||
-                 fileName.endsWith(".esm", Qt::CaseInsensitive)) {
-        QString relativePath = fileName.mid(m_RootPath.length() + 1);
-        if (relativePath.contains('/')) {
-          QFileInfo fileInfo(fileName);
-          QListWidgetItem *newItem = new QListWidgetItem(fileInfo.fileName());
-          newItem->setData(Qt::UserRole, relativePath);
-          ui->inactiveESPList->addItem(newItem);
-        } else {
-          ui->activeESPList->addItem(relativePath);
-        }
-      } else if ((fileName.endsWith(".png", Qt::CaseInsensitive)) ||
-                 (fileName.endsWith(".jpg", Qt::CaseInsensitive))) {
-        QImage image = QImage(fileName);
-        if (!image.isNull()) {
-          if (static_cast<float>(image.width()) / static_cast<float>(image.height()) > 1.34) {
-            image = image.scaledToWidth(128);
-          } else {
-            image = image.scaledToHeight(96);
-          }
+  ui->overwriteCount->display(numOverwrite);
+  ui->overwrittenCount->display(numOverwritten);
+  ui->noConflictCount->display(numNonConflicting);
+}
 
-          QPushButton *thumbnailButton = new QPushButton(QPixmap::fromImage(image), "");
-          thumbnailButton->setIconSize(QSize(image.width(), image.height()));
-          connect(thumbnailButton, SIGNAL(clicked()), &m_ThumbnailMapper, SLOT(map()));
-          m_ThumbnailMapper.setMapping(thumbnailButton, fileName);
-          ui->thumbnailArea->addWidget(thumbnailButton);
-        }
+
+void ModInfoDialog::refreshINITweakFiles()
+{
+  // tweaks are needed right away to restore their check state so they aren't left to the scan
+  QString tweaksPath = m_RootPath + "/INI Tweaks";
+  QDirIterator dirIterator(tweaksPath, QStringList() << "*.ini" << "*.cfg", QDir::Files, QDirIterator::Subdirectories);
+  while (dirIterator.hasNext()) {
+    QString namePart = dirIterator.next().mid(m_RootPath.length() + 1);
+    QListWidgetItem *newItem = new QListWidgetItem(namePart.mid(11), ui->iniTweaksList);
+    newItem->setData(Qt::UserRole, namePart);
+    newItem->setFlags(newItem->flags() | Qt::ItemIsUserCheckable);
+    newItem->setCheckState(Qt::Unchecked);
+    ui->iniTweaksList->addItem(newItem);
+  }
+}
+
+
+void ModInfoDialog::startFileScan()
+{
+  updateFileTabs();
+  if (m_RootPath.length() == 0) {
+    return;
+  }
+
+  m_FileScanner = new ModFileScanner(m_RootPath, Settings::instance().getCacheDirectory() + "/thumbnails", this);
+  connect(m_FileScanner, SIGNAL(filesFound(QStringList)), this, SLOT(addFiles(QStringList)));
+  connect(m_FileScanner, SIGNAL(thumbnailLoaded(int,QString,QImage)), this, SLOT(addThumbnail(int,QString,QImage)));
+  connect(m_FileScanner, SIGNAL(finished()), this, SLOT(fileScanFinished()));
+  m_FileScanner->start();
+}
+
+
+void ModInfoDialog::updateFileTabs()
+{
+  ui->tabWidget->setTabEnabled(ui->tabWidget->indexOf(ui->tabText), ui->textFileList->count() != 0);
+  ui->tabWidget->setTabEnabled(ui->tabWidget->indexOf(ui->tabImages), ui->thumbnailArea->count() != 0);
+  ui->tabWidget->setTabEnabled(ui->tabWidget->indexOf(ui->tabESPs),
+                               (ui->inactiveESPList->count() != 0) || (ui->activeESPList->count() != 0));
+}
+
+
+void ModInfoDialog::activateFirstEnabledTab()
+{
+  for (int i = 0; i < ui->tabWidget->count(); ++i) {
+    if (ui->tabWidget->isTabEnabled(i)) {
+      ui->tabWidget->setCurrentIndex(i);
+      break;
+    }
+  }
+}
+
+
+void ModInfoDialog::addFiles(const QStringList &fileNames)
+{
+  for (const QString &fileName : fileNames) {
+    if (fileName.endsWith(".txt", Qt::CaseInsensitive)) {
+      ui->textFileList->addItem(fileName.mid(m_RootPath.length() + 1));
+    } else if ((fileName.endsWith(".ini", Qt::CaseInsensitive) || fileName.endsWith(".cfg", Qt::CaseInsensitive)) &&
+               !fileName.endsWith("meta.ini")) {
+      QString namePart = fileName.mid(m_RootPath.length() + 1);
+      if (!namePart.startsWith("INI Tweaks", Qt::CaseInsensitive)) {
+        ui->iniFileList->addItem(namePart);
+      }
+    } else if (fileName.endsWith(".esp", Qt::CaseInsensitive) ||
+               fileName.endsWith(".esm", Qt::CaseInsensitive)) {
+      QString relativePath = fileName.mid(m_RootPath.length() + 1);
+      if (relativePath.contains('/')) {
+        QFileInfo fileInfo(fileName);
+        QListWidgetItem *newItem = new QListWidgetItem(fileInfo.fileName());
+        newItem->setData(Qt::UserRole, relativePath);
+        ui->inactiveESPList->addItem(newItem);
+      } else {
+        ui->activeESPList->addItem(relativePath);
       }
     }
   }
+  updateFileTabs();
+}
 
-  ui->overwriteCount->display(numOverwrite);
-  ui->overwrittenCount->display(numOverwritten);
-  ui->noConflictCount->display(numNonConflicting);
+
+void ModInfoDialog::addThumbnail(int index, const QString &fileName, const QImage &thumbnail)
+{
+  QPushButton *thumbnailButton = new QPushButton(QPixmap::fromImage(thumbnail), "");
+  thumbnailButton->setIconSize(QSize(thumbnail.width(), thumbnail.height()));
+  connect(thumbnailButton, SIGNAL(clicked()), &m_ThumbnailMapper, SLOT(map()));
+  m_ThumbnailMapper.setMapping(thumbnailButton, fileName);
+
+  // thumbnails arrive in any order, keep them in the order the images were found
+  auto iter = m_Thumbnails.insert(std::make_pair(index, thumbnailButton)).first;
+  ui->thumbnailArea->insertWidget(static_cast<int>(std::distance(m_Thumbnails.begin(), iter)), thumbnailButton);
+  if (m_Thumbnails.size() == 1) {
+    updateFileTabs();
+  }
+}
+
+
+void ModInfoDialog::fileScanFinished()
+{
+  m_FileScanner->deleteLater();
+  m_FileScanner = nullptr;
+
+  updateFileTabs();
+  if ((m_PendingTab != nullptr) && ui->tabWidget->isTabEnabled(ui->tabWidget->indexOf(m_PendingTab))) {
+    ui->tabWidget->setCurrentWidget(m_PendingTab);
+  } else if (ui->tabWidget->currentWidget() == m_InitialTab) {
+    // the user didn't pick a tab yet, so pick the one that would have been shown if the files
+    // had been known from the start
+    activateFirstEnabledTab();
+  }
+  m_PendingTab = nullptr;
 }
 
 
@@ -403,6 +473,9 @@ void ModInfoDialog::openTab(int tab)
   QTabWidget *tabWidget = findChild<QTabWidget*>("tabWidget");
   if (tabWidget->isTabEnabled(tab)) {
     tabWidget->setCurrentIndex(tab);
+  } else if (m_FileScanner != nullptr) {
+    // the tab may still be enabled once the scan found the files it shows
+    m_PendingTab = tabWidget->widget(tab);
   }
 }
 
@@ -1170,7 +1243,7 @@ void ModInfoDialog::hideConflictFile()
 {
   if (hideFile(m_ConflictsContextItem->data(0, Qt::UserRole).toString())) {
     emit originModified(m_Origin->getID());
-    refreshLists();
+    refreshConflictLists();
   }
 }
 
@@ -1179,7 +1252,7 @@ void ModInfoDialog::unhideConflictFile()
 {
   if (unhideFile(m_ConflictsContextItem->data(0, Qt::UserRole).toString())) {
     emit originModified(m_Origin->getID());
-    refreshLists();
+    refreshConflictLists();
   }
 }
 
@@ -34,6 +34,8 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QListWidgetItem>
 #include <QTreeWidgetItem>
 #include <QTextCodec>
+#include <QImage>
+#include <map>
 #include <set>
 #include <directoryentry.h>
 
@@ -45,6 +47,7 @@ namespace Ui {
 class QFileSystemModel;
 class QTreeView;
 class CategoryFactory;
+class ModFileScanner;
 
 /**
  * this is a larger dialog used to visualise information abount the mod.
@@ -124,7 +127,11 @@ private:
   void initFiletree(ModInfo::Ptr modInfo);
   void initINITweaks();
 
-  void refreshLists();
+  void refreshConflictLists();
+  void refreshINITweakFiles();
+  void startFileScan();
+  void updateFileTabs();
+  void activateFirstEnabledTab();
 
   void addCategories(const CategoryFactory &factory, const std::set<int> &enabledCategories, QTreeWidgetItem *root, int rootLevel);
 
@@ -157,6 +164,9 @@ private slots:
   void unhideConflictFile();
 
   void thumbnailClicked(const QString &fileName);
+  void addFiles(const QStringList &fileNames);
+  void addThumbnail(int index, const QString &fileName, const QImage &thumbnail);
+  void fileScanFinished();
   void linkClicked(const QUrl &url);
 
   void deleteTriggered();
@@ -208,6 +218,12 @@ private:
   QSignalMapper m_ThumbnailMapper;
   QString m_RootPath;
 
+  ModFileScanner *m_FileScanner;
+  // thumbnail buttons by the position of their image in the scan
+  std::map<int, QWidget*> m_Thumbnails;
+  QWidget *m_InitialTab;
+  QWidget *m_PendingTab;
+
   QFileSystemModel *m_FileSystemModel;
   QTreeView *m_FileTree;
   QModelIndexList m_FileSelection;
@@ -2,6 +2,7 @@
 
 #include "directoryentry.h"
 #include "utility.h"
+#include <runtimemetrics.h>
 
 using namespace MOBase;
 using namespace MOShared;
@@ -38,6 +39,9 @@ std::vector<ModInfo::EFlag> ModInfoWithConflictInfo::getFlags() const
 
 void ModInfoWithConflictInfo::doConflictCheck() const
 {
+  static MetricCounter &s_Checks = RuntimeMetrics::instance().counter("modinfo.conflictChecks");
+  s_Checks.increment();
+
   m_OverwriteList.clear();
   m_OverwrittenList.clear();
 
@@ -607,20 +607,18 @@ void ModList::changeModPriority(std::vector<int> sourceIndices, int newPriority)
               return profile->getModPriority(LHS) < profile->getModPriority(RHS);
             });
 
-  // odd stuff: if any of the dragged sources has priority lower than the destination then the
-  // target idx is that of the row BELOW the dropped location, otherwise it's the one above. why?
-  for (std::vector<int>::const_iterator iter = sourceIndices.begin();
-       iter != sourceIndices.end(); ++iter) {
-    if (profile->getModPriority(*iter) < newPriority) {
-      --newPriority;
-      break;
-    }
+  std::vector<int> oldPriorities;
+  for (int index : sourceIndices) {
+    oldPriorities.push_back(profile->getModPriority(index));
   }
-  for (std::vector<int>::const_iterator iter = sourceIndices.begin();
-       iter != sourceIndices.end(); ++iter) {
-    int oldPriority = m_Profile->getModPriority(*iter);
-    m_Profile->setModPriority(*iter, newPriority);
-    m_ModMoved(ModInfo::getByIndex(*iter)->name(), oldPriority, newPriority);
+
+  // the whole selection is moved in one go so the modlist is only reordered and written once
+  profile->setModsPriority(std::vector<unsigned int>(sourceIndices.begin(), sourceIndices.end()),
+                           newPriority);
+
+  for (size_t i = 0; i < sourceIndices.size(); ++i) {
+    m_ModMoved(ModInfo::getByIndex(sourceIndices[i])->name(), oldPriorities[i],
+               profile->getModPriority(sourceIndices[i]));
   }
 
   emit layoutChanged();
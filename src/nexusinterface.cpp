@@ -22,12 +22,15 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "iplugingame.h"
 #include "nxmaccessmanager.h"
 #include "json.h"
+#include "responsecache.h"
 #include "selectiondialog.h"
 #include <utility.h>
 #include <util.h>
+#include <runtimemetrics.h>
 
 #include <QApplication>
 
+#include <algorithm>
 #include <regex>
 
 
@@ -48,7 +51,7 @@ void NexusBridge::requestDescription(int modID, QVariant userData)
 
 void NexusBridge::requestFiles(int modID, QVariant userData)
 {
-  m_RequestIDs.insert(m_Interface->requestFiles(modID, this, userData, m_SubModule));
+  m_RequestIDs.insert(m_Interface->requestFiles(modID, this, userData, m_SubModule, true));
 }
 
 void NexusBridge::requestFileInfo(int modID, int fileID, QVariant userData)
@@ -145,6 +148,9 @@ QAtomicInt NexusInterface::NXMRequestInfo::s_NextID(0);
 
 NexusInterface::NexusInterface()
   : m_NMMVersion()
+  , m_ResponseCache(nullptr)
+  , m_MaxActiveRequests(2)
+  , m_SuccessStreak(0)
 {
   VS_FIXEDFILEINFO version = GetFileVersion(ToWString(QApplication::applicationFilePath()));
   m_MOVersion = VersionInfo(version.dwFileVersionMS >> 16,
@@ -164,6 +170,7 @@ NXMAccessManager *NexusInterface::getAccessManager()
 NexusInterface::~NexusInterface()
 {
   cleanup();
+  delete m_ResponseCache;
 }
 
 NexusInterface *NexusInterface::instance()
@@ -176,6 +183,9 @@ void NexusInterface::setCacheDirectory(const QString &directory)
 {
   m_DiskCache->setCacheDirectory(directory);
   m_AccessManager->setCache(m_DiskCache);
+
+  delete m_ResponseCache;
+  m_ResponseCache = new ResponseCache(directory + "/nexus_api", RESPONSE_CACHE_SIZE, RESPONSE_CACHE_MEMORY);
 }
 
 void NexusInterface::setNMMVersion(const QString &nmmVersion)
@@ -278,7 +288,7 @@ int NexusInterface::requestDescription(int modID, QObject *receiver, QVariant us
                                        const QString &subModule, MOBase::IPluginGame const *game)
 {
   NXMRequestInfo requestInfo(modID, NXMRequestInfo::TYPE_DESCRIPTION, userData, subModule, game);
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(this, SIGNAL(nxmDescriptionAvailable(int,QVariant,QVariant,int)),
           receiver, SLOT(nxmDescriptionAvailable(int,QVariant,QVariant,int)), Qt::UniqueConnection);
@@ -295,7 +305,7 @@ int NexusInterface::requestUpdates(const std::vector<int> &modIDs, QObject *rece
                                    const QString &subModule, MOBase::IPluginGame const *game)
 {
   NXMRequestInfo requestInfo(modIDs, NXMRequestInfo::TYPE_GETUPDATES, userData, subModule, game);
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(this, SIGNAL(nxmUpdatesAvailable(std::vector<int>,QVariant,QVariant,int)),
           receiver, SLOT(nxmUpdatesAvailable(std::vector<int>,QVariant,QVariant,int)), Qt::UniqueConnection);
@@ -328,10 +338,12 @@ void NexusInterface::fakeFiles()
 
 
 int NexusInterface::requestFiles(int modID, QObject *receiver, QVariant userData,
-                                 const QString &subModule, MOBase::IPluginGame const *game)
+                                 const QString &subModule, MOBase::IPluginGame const *game,
+                                 bool allowCached)
 {
   NXMRequestInfo requestInfo(modID, NXMRequestInfo::TYPE_FILES, userData, subModule, game);
-  m_RequestQueue.enqueue(requestInfo);
+  requestInfo.m_SkipCache = !allowCached;
+  enqueue(requestInfo);
   connect(this, SIGNAL(nxmFilesAvailable(int,QVariant,QVariant,int)),
           receiver, SLOT(nxmFilesAvailable(int,QVariant,QVariant,int)), Qt::UniqueConnection);
 
@@ -351,7 +363,7 @@ int NexusInterface::requestFileInfo(int modID, int fileID, QObject *receiver, QV
                                      MOBase::IPluginGame const *game)
 {
   NXMRequestInfo requestInfo(modID, fileID, NXMRequestInfo::TYPE_FILEINFO, userData, subModule, game);
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(this, SIGNAL(nxmFileInfoAvailable(int,int,QVariant,QVariant,int)),
           receiver, SLOT(nxmFileInfoAvailable(int,int,QVariant,QVariant,int)), Qt::UniqueConnection);
@@ -368,7 +380,7 @@ int NexusInterface::requestDownloadURL(int modID, int fileID, QObject *receiver,
                                        const QString &subModule, MOBase::IPluginGame const *game)
 {
   NXMRequestInfo requestInfo(modID, fileID, NXMRequestInfo::TYPE_DOWNLOADURL, userData, subModule, game);
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(this, SIGNAL(nxmDownloadURLsAvailable(int,int,QVariant,QVariant,int)),
           receiver, SLOT(nxmDownloadURLsAvailable(int,int,QVariant,QVariant,int)), Qt::UniqueConnection);
@@ -386,7 +398,7 @@ int NexusInterface::requestToggleEndorsement(int modID, bool endorse, QObject *r
 {
   NXMRequestInfo requestInfo(modID, NXMRequestInfo::TYPE_TOGGLEENDORSEMENT, userData, subModule, game);
   requestInfo.m_Endorse = endorse;
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(this, SIGNAL(nxmEndorsementToggled(int,QVariant,QVariant,int)),
           receiver, SLOT(nxmEndorsementToggled(int,QVariant,QVariant,int)), Qt::UniqueConnection);
@@ -410,16 +422,213 @@ void NexusInterface::cleanup()
 //  delete m_DiskCache;
   m_AccessManager = nullptr;
   m_DiskCache = nullptr;
+  if (m_ResponseCache != nullptr) {
+    m_ResponseCache->flush();
+  }
+}
+
+
+bool NexusInterface::cacheLifetime(NXMRequestInfo::Type type, int &ttl, int &staleWindow)
+{
+  switch (type) {
+    case NXMRequestInfo::TYPE_DESCRIPTION:
+    case NXMRequestInfo::TYPE_FILES:
+    case NXMRequestInfo::TYPE_GETUPDATES: {
+      ttl = 60 * 60;
+      staleWindow = 24 * 60 * 60;
+      return true;
+    } break;
+    case NXMRequestInfo::TYPE_FILEINFO: {
+      // file information hardly ever changes after upload
+      ttl = 24 * 60 * 60;
+      staleWindow = 7 * 24 * 60 * 60;
+      return true;
+    } break;
+    default: {
+      // download urls expire, endorsements change server state
+      return false;
+    } break;
+  }
+}
+
+
+QString NexusInterface::updateCacheKey(int nexusGameID, int modID)
+{
+  return QString("update|%1|%2").arg(nexusGameID).arg(modID);
+}
+
+
+bool NexusInterface::serveFromCache(NXMRequestInfo &info)
+{
+  int ttl, staleWindow;
+  if ((m_ResponseCache == nullptr) || info.m_Reroute || info.m_Revalidate || info.m_SkipCache
+      || !cacheLifetime(info.m_Type, ttl, staleWindow)) {
+    return false;
+  }
+
+  if (info.m_Type == NXMRequestInfo::TYPE_GETUPDATES) {
+    // update checks are cached per mod so only expired mods need to be requested again
+    std::vector<int> missing;
+    std::vector<int> stale;
+    for (int modID : info.m_ModIDList) {
+      QVariant value;
+      switch (m_ResponseCache->lookup(updateCacheKey(info.m_NexusGameID, modID), value)) {
+        case ResponseCache::FRESH: {
+          info.m_CachedResult.append(value);
+        } break;
+        case ResponseCache::STALE: {
+          info.m_CachedResult.append(value);
+          stale.push_back(modID);
+        } break;
+        case ResponseCache::MISS: {
+          missing.push_back(modID);
+        } break;
+      }
+    }
+
+    if (!stale.empty()) {
+      NXMRequestInfo revalidate(info);
+      revalidate.m_ModIDList = stale;
+      revalidate.m_FetchModIDList = stale;
+      revalidate.m_CachedResult.clear();
+      revalidate.m_Revalidate = true;
+      revalidate.m_Priority = NXMRequestInfo::PRIORITY_BACKGROUND;
+      enqueue(revalidate);
+    }
+
+    if (!missing.empty()) {
+      info.m_FetchModIDList = missing;
+      return false;
+    }
+    QVariant result = info.m_CachedResult;
+    QTimer::singleShot(0, this, [this, info, result] () {
+      emitResult(info, Recipients() << qMakePair(info.m_ID, info.m_UserData), result);
+    });
+    return true;
+  } else {
+    QVariant result;
+    ResponseCache::Freshness freshness = m_ResponseCache->lookup(info.key(), result);
+    if (freshness == ResponseCache::MISS) {
+      return false;
+    }
+    QTimer::singleShot(0, this, [this, info, result] () {
+      emitResult(info, Recipients() << qMakePair(info.m_ID, info.m_UserData), result);
+    });
+    if (freshness == ResponseCache::STALE) {
+      // caller was served, fetch an up-to-date response for the next one
+      info.m_Revalidate = true;
+      info.m_Priority = NXMRequestInfo::PRIORITY_BACKGROUND;
+      return false;
+    }
+    return true;
+  }
+}
+
+
+void NexusInterface::storeInCache(const NXMRequestInfo &info, QVariant &result)
+{
+  if (m_ResponseCache == nullptr) {
+    return;
+  }
+
+  if (info.m_Type == NXMRequestInfo::TYPE_TOGGLEENDORSEMENT) {
+    // cached responses contain the endorsement state
+    NXMRequestInfo description(info);
+    description.m_Type = NXMRequestInfo::TYPE_DESCRIPTION;
+    m_ResponseCache->remove(description.key());
+    m_ResponseCache->remove(updateCacheKey(info.m_NexusGameID, info.m_ModID));
+    return;
+  }
+
+  int ttl, staleWindow;
+  if (!cacheLifetime(info.m_Type, ttl, staleWindow)) {
+    return;
+  }
+
+  if (info.m_Type == NXMRequestInfo::TYPE_GETUPDATES) {
+    QVariantList resultList = result.toList();
+    for (const QVariant &mod : resultList) {
+      int modID = mod.toMap()["id"].toInt();
+      m_ResponseCache->insert(updateCacheKey(info.m_NexusGameID, modID), mod, ttl, staleWindow);
+    }
+    // complete the response with the mods that didn't have to be requested
+    resultList.append(info.m_CachedResult);
+    result = resultList;
+  } else {
+    m_ResponseCache->insert(info.key(), result, ttl, staleWindow);
+  }
+}
+
+void NexusInterface::enqueue(NXMRequestInfo info)
+{
+  if (serveFromCache(info)) {
+    return;
+  }
+
+  QString key = info.key();
+  if (!key.isEmpty()) {
+    QHash<QString, Recipients>::iterator iter = m_Coalesced.find(key);
+    if (iter != m_Coalesced.end()) {
+      if (info.m_Revalidate) {
+        // a fresh response is already on its way
+        return;
+      }
+      // an identical request is already under way, just wait for its result
+      iter->append(qMakePair(info.m_ID, info.m_UserData));
+
+      if (info.m_Priority == NXMRequestInfo::PRIORITY_INTERACTIVE) {
+        // someone is waiting on this now, don't leave it behind background work
+        QQueue<NXMRequestInfo> &background = m_RequestQueue[NXMRequestInfo::PRIORITY_BACKGROUND];
+        for (int i = 0; i < background.size(); ++i) {
+          if (background.at(i).key() == key) {
+            NXMRequestInfo promoted = background.takeAt(i);
+            promoted.m_Priority = NXMRequestInfo::PRIORITY_INTERACTIVE;
+            m_RequestQueue[NXMRequestInfo::PRIORITY_INTERACTIVE].enqueue(promoted);
+            break;
+          }
+        }
+      }
+      return;
+    }
+    m_Coalesced.insert(key, Recipients());
+  }
+  info.m_Queued.start();
+  m_RequestQueue[info.m_Priority].enqueue(info);
+  updateQueueDepth();
+}
+
+
+void NexusInterface::updateQueueDepth()
+{
+  static MetricGauge &s_QueueDepth = RuntimeMetrics::instance().gauge("nexus.queueDepth");
+  int depth = 0;
+  for (int i = 0; i < NXMRequestInfo::PRIORITY_COUNT; ++i) {
+    depth += m_RequestQueue[i].size();
+  }
+  s_QueueDepth.set(depth);
 }
 
+
+NexusInterface::NXMRequestInfo *NexusInterface::nextQueued()
+{
+  for (int i = 0; i < NXMRequestInfo::PRIORITY_COUNT; ++i) {
+    if (!m_RequestQueue[i].isEmpty()) {
+      return &m_RequestQueue[i].head();
+    }
+  }
+  return nullptr;
+}
+
+
 void NexusInterface::nextRequest()
 {
-  if ((m_ActiveRequest.size() >= MAX_ACTIVE_DOWNLOADS)
-      || m_RequestQueue.isEmpty()) {
+  NXMRequestInfo *head = nextQueued();
+  if ((m_ActiveRequest.size() >= m_MaxActiveRequests)
+      || (head == nullptr)) {
     return;
   }
 
-  if (requiresLogin(m_RequestQueue.head()) && !getAccessManager()->loggedIn()) {
+  if (requiresLogin(*head) && !getAccessManager()->loggedIn()) {
     if (!getAccessManager()->loginAttempted()) {
       emit needLogin();
       return;
@@ -428,7 +637,12 @@ void NexusInterface::nextRequest()
     }
   }
 
-  NXMRequestInfo info = m_RequestQueue.dequeue();
+  NXMRequestInfo info = m_RequestQueue[head->m_Priority].dequeue();
+  updateQueueDepth();
+  if (info.m_Queued.isValid()) {
+    static MetricHistogram &s_QueueWait = RuntimeMetrics::instance().histogram("nexus.queueWait");
+    s_QueueWait.record(info.m_Queued.nsecsElapsed() / 1000);
+  }
   info.m_Timeout = new QTimer(this);
   info.m_Timeout->setInterval(60000);
 
@@ -453,7 +667,7 @@ void NexusInterface::nextRequest()
         hasParams = true;
       } break;
       case NXMRequestInfo::TYPE_GETUPDATES: {
-        QString modIDList = VectorJoin<int>(info.m_ModIDList, ",");
+        QString modIDList = VectorJoin<int>(info.m_FetchModIDList, ",");
         modIDList = "[" + modIDList + "]";
         url = QString("%1/Mods/GetUpdates?ModList=%2").arg(info.m_URL).arg(modIDList);
         hasParams = true;
@@ -467,13 +681,19 @@ void NexusInterface::nextRequest()
   request.setHeader(QNetworkRequest::ContentTypeHeader, "application/xml");
   request.setRawHeader("User-Agent", m_AccessManager->userAgent(info.m_SubModule).toUtf8());
 
-  info.m_Reply = m_AccessManager->get(request);
+  QNetworkReply *reply = m_AccessManager->get(request);
+  info.m_Reply = reply;
 
-  connect(info.m_Reply, SIGNAL(finished()), this, SLOT(requestFinished()));
-  connect(info.m_Reply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(requestError(QNetworkReply::NetworkError)));
-  connect(info.m_Timeout, SIGNAL(timeout()), this, SLOT(requestTimeout()));
+  connect(reply, SIGNAL(finished()), this, SLOT(requestFinished()));
+  connect(reply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(requestError(QNetworkReply::NetworkError)));
+  // this abort causes a "request failed" which cleans up the rest
+  connect(info.m_Timeout, &QTimer::timeout, [reply] () { reply->abort(); });
   info.m_Timeout->start();
-  m_ActiveRequest.push_back(info);
+  info.m_Started.start();
+  m_ActiveRequest.insert(reply, info);
+
+  // there may be room for more than one request
+  nextRequest();
 }
 
 
@@ -482,21 +702,85 @@ void NexusInterface::downloadRequestedNXM(const QString &url)
   emit requestNXMDownload(url);
 }
 
-void NexusInterface::requestFinished(std::list<NXMRequestInfo>::iterator iter)
+NexusInterface::Recipients NexusInterface::takeRecipients(const NXMRequestInfo &info)
+{
+  Recipients result;
+  if (!info.m_Revalidate) {
+    result.append(qMakePair(info.m_ID, info.m_UserData));
+  }
+  QString key = info.key();
+  if (!key.isEmpty()) {
+    result.append(m_Coalesced.take(key));
+  }
+  return result;
+}
+
+
+void NexusInterface::emitResult(const NXMRequestInfo &info, const Recipients &recipients, const QVariant &result)
+{
+  for (const QPair<int, QVariant> &recipient : recipients) {
+    switch (info.m_Type) {
+      case NXMRequestInfo::TYPE_DESCRIPTION: {
+        emit nxmDescriptionAvailable(info.m_ModID, recipient.second, result, recipient.first);
+      } break;
+      case NXMRequestInfo::TYPE_FILES: {
+        emit nxmFilesAvailable(info.m_ModID, recipient.second, result, recipient.first);
+      } break;
+      case NXMRequestInfo::TYPE_FILEINFO: {
+        emit nxmFileInfoAvailable(info.m_ModID, info.m_FileID, recipient.second, result, recipient.first);
+      } break;
+      case NXMRequestInfo::TYPE_DOWNLOADURL: {
+        emit nxmDownloadURLsAvailable(info.m_ModID, info.m_FileID, recipient.second, result, recipient.first);
+      } break;
+      case NXMRequestInfo::TYPE_GETUPDATES: {
+        emit nxmUpdatesAvailable(info.m_ModIDList, recipient.second, result, recipient.first);
+      } break;
+      case NXMRequestInfo::TYPE_TOGGLEENDORSEMENT: {
+        emit nxmEndorsementToggled(info.m_ModID, recipient.second, result, recipient.first);
+      } break;
+    }
+  }
+}
+
+
+void NexusInterface::adjustConcurrency(bool success, qint64 latency)
 {
-  QNetworkReply *reply = iter->m_Reply;
+  if (!success || (latency > SLOW_REQUEST_MS)) {
+    // back off quickly when the server struggles
+    m_MaxActiveRequests = std::max<int>(MIN_ACTIVE_REQUESTS, m_MaxActiveRequests / 2);
+    m_SuccessStreak = 0;
+  } else if (++m_SuccessStreak >= RAMP_UP_STREAK) {
+    m_MaxActiveRequests = std::min<int>(MAX_ACTIVE_REQUESTS, m_MaxActiveRequests + 1);
+    m_SuccessStreak = 0;
+  }
+}
+
+
+void NexusInterface::requestFinished(NXMRequestInfo &info)
+{
+  static MetricHistogram &s_Latency = RuntimeMetrics::instance().histogram("nexus.requestLatency");
+  s_Latency.record(info.m_Started.nsecsElapsed() / 1000);
+
+  QNetworkReply *reply = info.m_Reply;
 
   if (reply->error() != QNetworkReply::NoError) {
     qWarning("request failed: %s", reply->errorString().toUtf8().constData());
-    emit nxmRequestFailed(iter->m_ModID, iter->m_FileID, iter->m_UserData, iter->m_ID, reply->errorString());
+    adjustConcurrency(false, info.m_Started.elapsed());
+    for (const QPair<int, QVariant> &recipient : takeRecipients(info)) {
+      emit nxmRequestFailed(info.m_ModID, info.m_FileID, recipient.second, recipient.first, reply->errorString());
+    }
   } else {
+    adjustConcurrency(true, info.m_Started.elapsed());
     int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
     if (statusCode == 301) {
-      // redirect request, return request to queue
-      iter->m_URL = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toString();
-      iter->m_Reroute = true;
-      m_RequestQueue.enqueue(*iter);
-      nextRequest();
+      // redirect request, return request to queue. Coalesced callers keep waiting on it
+      info.m_URL = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toString();
+      info.m_Reroute = true;
+      info.m_Reply = nullptr;
+      info.m_Timeout = nullptr;
+      info.m_Queued.start();
+      m_RequestQueue[info.m_Priority].enqueue(info);
+      updateQueueDepth();
       return;
     }
     QByteArray data = reply->readAll();
@@ -506,33 +790,20 @@ void NexusInterface::requestFinished(std::list<NXMRequestInfo>::iterator iter)
         nexusError = tr("empty response");
       }
       qDebug("nexus error: %s", qPrintable(nexusError));
-      emit nxmRequestFailed(iter->m_ModID, iter->m_FileID, iter->m_UserData, iter->m_ID, nexusError);
+      for (const QPair<int, QVariant> &recipient : takeRecipients(info)) {
+        emit nxmRequestFailed(info.m_ModID, info.m_FileID, recipient.second, recipient.first, nexusError);
+      }
     } else {
       bool ok;
       QVariant result = QtJson::parse(data, ok);
       if (result.isValid() && ok) {
-        switch (iter->m_Type) {
-          case NXMRequestInfo::TYPE_DESCRIPTION: {
-            emit nxmDescriptionAvailable(iter->m_ModID, iter->m_UserData, result, iter->m_ID);
-          } break;
-          case NXMRequestInfo::TYPE_FILES: {
-            emit nxmFilesAvailable(iter->m_ModID, iter->m_UserData, result, iter->m_ID);
-          } break;
-          case NXMRequestInfo::TYPE_FILEINFO: {
-            emit nxmFileInfoAvailable(iter->m_ModID, iter->m_FileID, iter->m_UserData, result, iter->m_ID);
-          } break;
-          case NXMRequestInfo::TYPE_DOWNLOADURL: {
-            emit nxmDownloadURLsAvailable(iter->m_ModID, iter->m_FileID, iter->m_UserData, result, iter->m_ID);
-          } break;
-          case NXMRequestInfo::TYPE_GETUPDATES: {
-            emit nxmUpdatesAvailable(iter->m_ModIDList, iter->m_UserData, result, iter->m_ID);
-          } break;
-          case NXMRequestInfo::TYPE_TOGGLEENDORSEMENT: {
-            emit nxmEndorsementToggled(iter->m_ModID, iter->m_UserData, result, iter->m_ID);
-          } break;
-        }
+        storeInCache(info, result);
+        // the response is parsed once and handed to everyone who asked for it
+        emitResult(info, takeRecipients(info), result);
       } else {
-        emit nxmRequestFailed(iter->m_ModID, iter->m_FileID, iter->m_UserData, iter->m_ID, tr("invalid response"));
+        for (const QPair<int, QVariant> &recipient : takeRecipients(info)) {
+          emit nxmRequestFailed(info.m_ModID, info.m_FileID, recipient.second, recipient.first, tr("invalid response"));
+        }
       }
     }
   }
@@ -542,16 +813,15 @@ void NexusInterface::requestFinished(std::list<NXMRequestInfo>::iterator iter)
 void NexusInterface::requestFinished()
 {
   QNetworkReply *reply = static_cast<QNetworkReply*>(sender());
-  for (std::list<NXMRequestInfo>::iterator iter = m_ActiveRequest.begin(); iter != m_ActiveRequest.end(); ++iter) {
-    if (iter->m_Reply == reply) {
-      iter->m_Timeout->stop();
-      iter->m_Timeout->deleteLater();
-      requestFinished(iter);
-      iter->m_Reply->deleteLater();
-      m_ActiveRequest.erase(iter);
-      nextRequest();
-      return;
-    }
+  QHash<QNetworkReply*, NXMRequestInfo>::iterator iter = m_ActiveRequest.find(reply);
+  if (iter != m_ActiveRequest.end()) {
+    NXMRequestInfo info = *iter;
+    m_ActiveRequest.erase(iter);
+    info.m_Timeout->stop();
+    info.m_Timeout->deleteLater();
+    requestFinished(info);
+    reply->deleteLater();
+    nextRequest();
   }
 }
 
@@ -569,22 +839,6 @@ void NexusInterface::requestError(QNetworkReply::NetworkError)
 }
 
 
-void NexusInterface::requestTimeout()
-{
-  QTimer *timer =  qobject_cast<QTimer*>(sender());
-  if (timer == nullptr) {
-    qWarning("invalid sender type");
-    return;
-  }
-  for (std::list<NXMRequestInfo>::iterator iter = m_ActiveRequest.begin(); iter != m_ActiveRequest.end(); ++iter) {
-    if (iter->m_Timeout == timer) {
-      // this abort causes a "request failed" which cleans up the rest
-      iter->m_Reply->abort();
-      return;
-    }
-  }
-}
-
 void NexusInterface::managedGameChanged(IPluginGame const *game)
 {
   m_Game = game;
@@ -607,9 +861,12 @@ NexusInterface::NXMRequestInfo::NXMRequestInfo(int modID
   , m_FileID(0)
   , m_Reply(nullptr)
   , m_Type(type)
+  , m_Priority(type == TYPE_GETUPDATES ? PRIORITY_BACKGROUND : PRIORITY_INTERACTIVE)
   , m_UserData(userData)
   , m_Timeout(nullptr)
   , m_Reroute(false)
+  , m_Revalidate(false)
+  , m_SkipCache(false)
   , m_ID(s_NextID.fetchAndAddAcquire(1))
   , m_URL(get_management_url(game))
   , m_SubModule(subModule)
@@ -625,12 +882,16 @@ NexusInterface::NXMRequestInfo::NXMRequestInfo(std::vector<int> modIDList
                                                )
   : m_ModID(-1)
   , m_ModIDList(modIDList)
+  , m_FetchModIDList(modIDList)
   , m_FileID(0)
   , m_Reply(nullptr)
   , m_Type(type)
+  , m_Priority(type == TYPE_GETUPDATES ? PRIORITY_BACKGROUND : PRIORITY_INTERACTIVE)
   , m_UserData(userData)
   , m_Timeout(nullptr)
   , m_Reroute(false)
+  , m_Revalidate(false)
+  , m_SkipCache(false)
   , m_ID(s_NextID.fetchAndAddAcquire(1))
   , m_URL(get_management_url(game))
   , m_SubModule(subModule)
@@ -649,12 +910,28 @@ NexusInterface::NXMRequestInfo::NXMRequestInfo(int modID
   , m_FileID(fileID)
   , m_Reply(nullptr)
   , m_Type(type)
+  , m_Priority(type == TYPE_GETUPDATES ? PRIORITY_BACKGROUND : PRIORITY_INTERACTIVE)
   , m_UserData(userData)
   , m_Timeout(nullptr)
   , m_Reroute(false)
+  , m_Revalidate(false)
+  , m_SkipCache(false)
   , m_ID(s_NextID.fetchAndAddAcquire(1))
   , m_URL(get_management_url(game))
   , m_SubModule(subModule)
   , m_NexusGameID(game->nexusGameID())
   , m_Endorse(false)
 {}
+
+QString NexusInterface::NXMRequestInfo::key() const
+{
+  if (m_Type == TYPE_TOGGLEENDORSEMENT) {
+    // not idempotent
+    return QString();
+  }
+  return QString("%1|%2|%3|%4|%5").arg(m_Type)
+                                  .arg(m_NexusGameID)
+                                  .arg(m_ModID)
+                                  .arg(m_FileID)
+                                  .arg(VectorJoin<int>(m_ModIDList, ","));
+}
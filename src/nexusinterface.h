@@ -27,8 +27,11 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QNetworkReply>
 #include <QNetworkDiskCache>
 #include <QQueue>
+#include <QHash>
+#include <QPair>
 #include <QVariant>
 #include <QTimer>
+#include <QElapsedTimer>
 
 #include <list>
 #include <set>
@@ -37,6 +40,7 @@ namespace MOBase { class IPluginGame; }
 
 class NexusInterface;
 class NXMAccessManager;
+class ResponseCache;
 
 /**
  * @brief convenience class to make nxm requests easier
@@ -120,7 +124,10 @@ private:
  *
  * This class can be used to make asynchronous requests to the Nexus API.
  * Currently, responses are sent to all receivers that have sent a request of the relevant type, so the
- * recipient has to filter the response by the id returned when making the request
+ * recipient has to filter the response by the id returned when making the request.
+ * Identical requests that are issued while one is already pending are not sent again, all callers
+ * receive the same response (each with their own request id and user data).
+ * Background requests (update checks) are only sent when no interactive request is waiting
  **/
 class NexusInterface : public QObject
 {
@@ -196,11 +203,14 @@ public:
    * @param modID id of the mod caller is interested in (assumed to be for the current game)
    * @param receiver the object to receive the result asynchronously via a signal (nxmFilesAvailable)
    * @param userData user data to be returned with the result
+   * @param allowCached if true, the list may be answered from the response cache. Leave
+   *                    this off when the result is used to find a file to download
    * @return int an id to identify the request
    **/
-  int requestFiles(int modID, QObject *receiver, QVariant userData, const QString &subModule)
+  int requestFiles(int modID, QObject *receiver, QVariant userData, const QString &subModule,
+                   bool allowCached = false)
   {
-    return requestFiles(modID, receiver, userData, subModule, m_Game);
+    return requestFiles(modID, receiver, userData, subModule, m_Game, allowCached);
   }
 
 
@@ -211,10 +221,12 @@ public:
    * @param receiver the object to receive the result asynchronously via a signal (nxmFilesAvailable)
    * @param userData user data to be returned with the result
    * @param game the game with which the mods are associated
+   * @param allowCached if true, the list may be answered from the response cache. Leave
+   *                    this off when the result is used to find a file to download
    * @return int an id to identify the request
    **/
   int requestFiles(int modID, QObject *receiver, QVariant userData, const QString &subModule,
-                   MOBase::IPluginGame const *game);
+                   MOBase::IPluginGame const *game, bool allowCached = false);
 
   /**
    * @brief request info about a single file of a mod
@@ -374,7 +386,6 @@ private slots:
 
   void requestFinished();
   void requestError(QNetworkReply::NetworkError error);
-  void requestTimeout();
 
   void downloadRequestedNXM(const QString &url);
 
@@ -385,6 +396,9 @@ private:
   struct NXMRequestInfo {
     int m_ModID;
     std::vector<int> m_ModIDList;
+    // the part of m_ModIDList that actually needs to be fetched, the rest is served from cache
+    std::vector<int> m_FetchModIDList;
+    QVariantList m_CachedResult;
     int m_FileID;
     QNetworkReply *m_Reply;
     enum Type {
@@ -395,12 +409,23 @@ private:
       TYPE_TOGGLEENDORSEMENT,
       TYPE_GETUPDATES
     } m_Type;
+    enum Priority {
+      PRIORITY_INTERACTIVE,
+      PRIORITY_BACKGROUND,
+      PRIORITY_COUNT
+    } m_Priority;
     QVariant m_UserData;
     QTimer *m_Timeout;
+    QElapsedTimer m_Started;
+    QElapsedTimer m_Queued;
     QString m_URL;
     QString m_SubModule;
     int m_NexusGameID;
     bool m_Reroute;
+    // if set, the request only refreshes the response cache, the caller was already served
+    bool m_Revalidate;
+    // if set, the response cache isn't consulted. The response is still stored
+    bool m_SkipCache;
     int m_ID;
     int m_Endorse;
 
@@ -408,28 +433,63 @@ private:
     NXMRequestInfo(std::vector<int> modIDList, Type type, QVariant userData, const QString &subModule, MOBase::IPluginGame const *game);
     NXMRequestInfo(int modID, int fileID, Type type, QVariant userData, const QString &subModule, MOBase::IPluginGame const *game);
 
+    /**
+     * @return key identifying requests that produce identical responses. Empty if the
+     *         request must never be merged with another
+     */
+    QString key() const;
+
   private:
     static QAtomicInt s_NextID;
   };
 
-  static const int MAX_ACTIVE_DOWNLOADS = 2;
+  // (request id, user data) of every caller waiting for the result of a request
+  typedef QList<QPair<int, QVariant> > Recipients;
+
+  static const int MIN_ACTIVE_REQUESTS = 1;
+  static const int MAX_ACTIVE_REQUESTS = 6;
+  // requests slower than this (in milliseconds) count as a sign of congestion
+  static const int SLOW_REQUEST_MS = 5000;
+  // number of quick, successful requests in a row before concurrency is increased
+  static const int RAMP_UP_STREAK = 4;
+
+  static const qint64 RESPONSE_CACHE_SIZE = 32 * 1024 * 1024;
+  static const qint64 RESPONSE_CACHE_MEMORY = 8 * 1024 * 1024;
 
 private:
 
   NexusInterface();
+  void enqueue(NXMRequestInfo info);
+  NXMRequestInfo *nextQueued();
+  void updateQueueDepth();
   void nextRequest();
-  void requestFinished(std::list<NXMRequestInfo>::iterator iter);
+  void requestFinished(NXMRequestInfo &info);
+  Recipients takeRecipients(const NXMRequestInfo &info);
+  void emitResult(const NXMRequestInfo &info, const Recipients &recipients, const QVariant &result);
+  bool serveFromCache(NXMRequestInfo &info);
+  void storeInCache(const NXMRequestInfo &info, QVariant &result);
+  static bool cacheLifetime(NXMRequestInfo::Type type, int &ttl, int &staleWindow);
+  static QString updateCacheKey(int nexusGameID, int modID);
+  void adjustConcurrency(bool success, qint64 latency);
   bool requiresLogin(const NXMRequestInfo &info);
   QString getOldModsURL() const;
 
 private:
 
   QNetworkDiskCache *m_DiskCache;
+  ResponseCache *m_ResponseCache;
 
   NXMAccessManager *m_AccessManager;
 
-  std::list<NXMRequestInfo> m_ActiveRequest;
-  QQueue<NXMRequestInfo> m_RequestQueue;
+  QHash<QNetworkReply*, NXMRequestInfo> m_ActiveRequest;
+  QQueue<NXMRequestInfo> m_RequestQueue[NXMRequestInfo::PRIORITY_COUNT];
+
+  // callers that asked for a result identical to a request already queued or running,
+  // indexed by the key of that request
+  QHash<QString, Recipients> m_Coalesced;
+
+  int m_MaxActiveRequests;
+  int m_SuccessStreak;
 
   MOBase::VersionInfo m_MOVersion;
   QString m_NMMVersion;
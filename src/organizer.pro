@@ -91,7 +91,16 @@ SOURCES += \
     modinforegular.cpp \
     modinfobackup.cpp \
     modinfooverwrite.cpp \
-    modinfoforeign.cpp
+    modinfoforeign.cpp \
+    responsecache.cpp \
+    datatreemodel.cpp \
+    bsaextractor.cpp \
+    savegamecatalogue.cpp \
+    thumbnailcache.cpp \
+    modfilescanner.cpp \
+    listexporter.cpp \
+    phasetracer.cpp \
+    directorystructurecache.cpp
 
 
 HEADERS  += \
@@ -167,7 +176,16 @@ HEADERS  += \
     modinforegular.h \
     modinfobackup.h \
     modinfooverwrite.h \
-    modinfoforeign.h
+    modinfoforeign.h \
+    responsecache.h \
+    datatreemodel.h \
+    bsaextractor.h \
+    savegamecatalogue.h \
+    thumbnailcache.h \
+    modfilescanner.h \
+    listexporter.h \
+    phasetracer.h \
+    directorystructurecache.h
 
 FORMS    += \
     transfersavesdialog.ui \
@@ -22,9 +22,11 @@
 #include "spawn.h"
 #include "syncoverwritedialog.h"
 #include "nxmaccessmanager.h"
+#include "phasetracer.h"
 #include <ipluginmodpage.h>
 #include <dataarchives.h>
 #include <directoryentry.h>
+#include <runtimemetrics.h>
 #include <scopeguard.h>
 #include <utility.h>
 #include "appconfig.h"
@@ -33,11 +35,14 @@
 
 #include <QApplication>
 #include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QDialog>
 #include <QDialogButtonBox>
 #include <QMessageBox>
 #include <QNetworkInterface>
 #include <QProcess>
+#include <QRegExp>
 #include <QTimer>
 #include <QUrl>
 #include <QWidget>
@@ -52,6 +57,7 @@
 #include <stddef.h>
 #include <string.h> // for memset, wcsrchr
 
+#include <algorithm>
 #include <exception>
 #include <functional>
 #include <memory>
@@ -165,6 +171,7 @@ OrganizerCore::OrganizerCore(const QSettings &initSettings)
   , m_PluginList(this)
   , m_DirectoryRefresher()
   , m_DirectoryStructure(new DirectoryEntry(L"data", nullptr, 0))
+  , m_QueryDepth(0)
   , m_DownloadManager(NexusInterface::instance(), this)
   , m_InstallationManager()
   , m_RefresherThread()
@@ -175,6 +182,9 @@ OrganizerCore::OrganizerCore(const QSettings &initSettings)
 {
   m_DownloadManager.setOutputDirectory(m_Settings.getDownloadDirectory());
   m_DownloadManager.setPreferredServers(m_Settings.getPreferredServers());
+  m_DownloadManager.setServerSpeeds(m_Settings.getServerSpeeds());
+
+  m_StructureCache.setBudget(static_cast<qint64>(m_Settings.directoryCacheSize()) * 1024 * 1024);
 
   NexusInterface::instance()->setCacheDirectory(m_Settings.getCacheDirectory());
   NexusInterface::instance()->setNMMVersion(m_Settings.getNMMVersion());
@@ -201,6 +211,7 @@ OrganizerCore::OrganizerCore(const QSettings &initSettings)
   connect(&m_PluginList, &PluginList::writePluginsList, &m_PluginListsWriter, &DelayedFileWriterBase::write);
 
   // make directory refresher run in a separate thread
+  m_RefresherThread.setObjectName("directory refresher");
   m_RefresherThread.start();
   m_DirectoryRefresher.moveToThread(&m_RefresherThread);
 
@@ -550,6 +561,7 @@ void OrganizerCore::downloadRequested(QNetworkReply *reply, int modID, const QSt
 
 void OrganizerCore::removeOrigin(const QString &name)
 {
+  m_StructureCache.invalidate(name);
   FilesOrigin &origin = m_DirectoryStructure->getOriginByName(ToWString(name));
   origin.enable(false);
   refreshLists();
@@ -558,6 +570,7 @@ void OrganizerCore::removeOrigin(const QString &name)
 void OrganizerCore::downloadSpeed(const QString &serverName, int bytesPerSecond)
 {
   m_Settings.setDownloadSpeed(serverName, bytesPerSecond);
+  m_DownloadManager.setServerSpeeds(m_Settings.getServerSpeeds());
 }
 
 InstallationManager *OrganizerCore::installationManager()
@@ -582,6 +595,14 @@ void OrganizerCore::setCurrentProfile(const QString &profileName)
   QString profileDir = qApp->property("dataPath").toString() + "/" + ToQString(AppConfig::profilesPath()) + "/" + profileName;
   Profile *newProfile = new Profile(QDir(profileDir), managedGame());
 
+  m_StructureProfile.clear();
+  if ((m_CurrentProfile != nullptr) && !m_DirectoryUpdate) {
+    // the structure is up-to-date for the old profile, remember that so it can be cached
+    m_StructureOrigins.clear();
+    m_StructureFingerprint = structureFingerprint(m_StructureOrigins);
+    m_StructureProfile = m_CurrentProfile->name();
+  }
+
   delete m_CurrentProfile;
   m_CurrentProfile = newProfile;
   m_ModList.setProfile(newProfile);
@@ -593,7 +614,7 @@ void OrganizerCore::setCurrentProfile(const QString &profileName)
   }
 
   connect(m_CurrentProfile, SIGNAL(modStatusChanged(uint)), this, SLOT(modStatusChanged(uint)));
-  refreshDirectoryStructure();
+  switchDirectoryStructure();
 }
 
 MOBase::IModRepositoryBridge *OrganizerCore::createNexusBridge() const
@@ -832,8 +853,9 @@ QStringList OrganizerCore::findFiles(const QString &path, const std::function<bo
   if (dir != nullptr) {
     std::vector<FileEntry::Ptr> files = dir->getFiles();
     foreach (FileEntry::Ptr file, files) {
-      if (filter(ToQString(file->getFullPath()))) {
-        result.append(ToQString(file->getFullPath()));
+      QString fullPath = ToQString(file->getFullPath());
+      if (filter(fullPath)) {
+        result.append(fullPath);
       }
     }
   } else {
@@ -858,6 +880,139 @@ QStringList OrganizerCore::getFileOrigins(const QString &fileName) const
   return result;
 }
 
+DirectoryEntry *OrganizerCore::beginQuery() const
+{
+  ++m_QueryDepth;
+  return m_DirectoryStructure;
+}
+
+void OrganizerCore::endQuery() const
+{
+  if ((--m_QueryDepth == 0) && !m_RetiredStructures.empty()) {
+    for (DirectoryEntry *structure : m_RetiredStructures) {
+      delete structure;
+    }
+    m_RetiredStructures.clear();
+  }
+}
+
+static void packFile(const FileEntry::Ptr &file, OrganizerCore::ResolvedFile &result)
+{
+  result.alternatives.clear();
+  if (file.get() != nullptr) {
+    result.fullPath = ToQString(file->getFullPath());
+    result.origin = file->getOrigin(result.fromArchive);
+    result.alternatives = file->getAlternatives();
+  } else {
+    result.fullPath.clear();
+    result.origin = -1;
+    result.fromArchive = false;
+  }
+}
+
+void OrganizerCore::resolvePaths(const QStringList &fileNames, const ResolvedFileCallback &callback) const
+{
+  DirectoryEntry *structure = beginQuery();
+  try {
+    ResolvedFile result;
+    for (const QString &fileName : fileNames) {
+      result.relativePath = fileName;
+      packFile(structure->searchFile(ToWString(fileName), nullptr), result);
+      if (!callback(result)) {
+        break;
+      }
+    }
+  } catch (...) {
+    endQuery();
+    throw;
+  }
+  endQuery();
+}
+
+std::vector<OrganizerCore::ResolvedFile> OrganizerCore::resolvePaths(const QStringList &fileNames) const
+{
+  std::vector<ResolvedFile> result;
+  result.reserve(fileNames.size());
+  resolvePaths(fileNames, [&result] (const ResolvedFile &file) -> bool {
+    result.push_back(file);
+    return true;
+  });
+  return result;
+}
+
+static bool visitMatching(DirectoryEntry *directory, const QRegExp &namePattern, bool recursive,
+                          OrganizerCore::ResolvedFile &result,
+                          const OrganizerCore::ResolvedFileCallback &callback)
+{
+  std::vector<FileEntry::Ptr> files = directory->getFiles();
+  for (const FileEntry::Ptr &file : files) {
+    if (namePattern.exactMatch(ToQString(file->getName()))) {
+      // relative paths start with a backslash
+      result.relativePath = ToQString(file->getRelativePath()).mid(1);
+      packFile(file, result);
+      if (!callback(result)) {
+        return false;
+      }
+    }
+  }
+
+  if (recursive) {
+    std::vector<DirectoryEntry*>::const_iterator current, end;
+    directory->getSubDirectories(current, end);
+    for (; current != end; ++current) {
+      if (!visitMatching(*current, namePattern, recursive, result, callback)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void OrganizerCore::findFilesMatching(const QStringList &patterns, const ResolvedFileCallback &callback) const
+{
+  DirectoryEntry *structure = beginQuery();
+  try {
+    ResolvedFile result;
+    for (const QString &pattern : patterns) {
+      QString directoryPath = QDir::fromNativeSeparators(pattern);
+      int pos = directoryPath.lastIndexOf('/');
+      QRegExp namePattern(directoryPath.mid(pos + 1), Qt::CaseInsensitive, QRegExp::Wildcard);
+      directoryPath.truncate(std::max(pos, 0));
+
+      bool recursive = false;
+      if ((directoryPath == "**") || directoryPath.endsWith("/**")) {
+        recursive = true;
+        directoryPath.chop(std::min(directoryPath.length(), 3));
+      }
+
+      DirectoryEntry *directory = structure->findSubDirectoryRecursive(ToWString(directoryPath));
+      if ((directory != nullptr)
+          && !visitMatching(directory, namePattern, recursive, result, callback)) {
+        break;
+      }
+    }
+  } catch (...) {
+    endQuery();
+    throw;
+  }
+  endQuery();
+}
+
+std::vector<OrganizerCore::ResolvedFile> OrganizerCore::findFilesMatching(const QStringList &patterns) const
+{
+  std::vector<ResolvedFile> result;
+  findFilesMatching(patterns, [&result] (const ResolvedFile &file) -> bool {
+    result.push_back(file);
+    return true;
+  });
+  return result;
+}
+
+QString OrganizerCore::originName(int originID) const
+{
+  return ToQString(m_DirectoryStructure->getOriginByID(originID).getName());
+}
+
 QList<MOBase::IOrganizer::FileInfo> OrganizerCore::findFileInfos(const QString &path, const std::function<bool (const MOBase::IOrganizer::FileInfo &)> &filter) const
 {
   QList<IOrganizer::FileInfo> result;
@@ -1150,6 +1305,10 @@ bool OrganizerCore::onModInstalled(const std::function<void (const QString &)> &
 
 void OrganizerCore::refreshModList(bool saveChanges)
 {
+  TraceSpan span("OrganizerCore::refreshModList");
+  static MetricHistogram &s_Latency = RuntimeMetrics::instance().histogram("organizer.refreshModList");
+  ScopedLatency latency(s_Latency);
+
   // don't lose changes!
   if (saveChanges) {
     m_CurrentProfile->modlistWriter().writeImmediately(true);
@@ -1172,6 +1331,9 @@ void OrganizerCore::refreshESPList()
   }
   m_CurrentProfile->modlistWriter().write();
 
+  static MetricHistogram &s_Latency = RuntimeMetrics::instance().histogram("organizer.refreshESPList");
+  ScopedLatency latency(s_Latency);
+
   // clear list
   try {
     m_PluginList.refresh(m_CurrentProfile->name(),
@@ -1353,7 +1515,66 @@ std::vector<QString> OrganizerCore::enabledArchives()
   return result;
 }
 
+QByteArray OrganizerCore::structureFingerprint(std::set<QString> &origins)
+{
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  auto addDirectory = [&hash] (const QString &path) {
+    hash.addData(QString("%1|%2\n").arg(path)
+                 .arg(QFileInfo(path).lastModified().toMSecsSinceEpoch()).toUtf8());
+  };
+
+  addDirectory(managedGame()->dataDirectory().absolutePath());
+  for (const auto &mod : m_CurrentProfile->getActiveMods()) {
+    origins.insert(std::get<0>(mod));
+    hash.addData(QString("%1|%2|").arg(std::get<0>(mod)).arg(std::get<2>(mod)).toUtf8());
+    addDirectory(std::get<1>(mod));
+  }
+  for (const QString &archive : enabledArchives()) {
+    hash.addData(archive.toUtf8().append('\n'));
+  }
+  return hash.result();
+}
+
+void OrganizerCore::switchDirectoryStructure()
+{
+  if (!m_DirectoryUpdate) {
+    std::set<QString> origins;
+    QByteArray fingerprint = structureFingerprint(origins);
+    DirectoryEntry *cached = m_StructureCache.take(m_CurrentProfile->name(), fingerprint);
+    if (cached != nullptr) {
+      activateStructure(cached);
+      m_RestoredFingerprint = fingerprint;
+      return;
+    }
+  }
+  startDirectoryRefresh();
+}
+
 void OrganizerCore::refreshDirectoryStructure()
+{
+  if (m_DirectoryUpdate) {
+    return;
+  }
+
+  if (!m_RestoredFingerprint.isEmpty()) {
+    // the profile switch that restored the structure is followed by a refresh of the mod list.
+    // unless that changed something the restored structure is still current
+    QByteArray restored = m_RestoredFingerprint;
+    m_RestoredFingerprint.clear();
+    std::set<QString> origins;
+    if (structureFingerprint(origins) == restored) {
+      refreshLists();
+      return;
+    }
+  }
+
+  // otherwise files may have changed in ways the fingerprints don't capture
+  m_StructureCache.clear();
+  m_StructureProfile.clear();
+  startDirectoryRefresh();
+}
+
+void OrganizerCore::startDirectoryRefresh()
 {
   if (!m_DirectoryUpdate) {
     m_CurrentProfile->modlistWriter().writeImmediately(true);
@@ -1370,15 +1591,33 @@ void OrganizerCore::refreshDirectoryStructure()
 
 void OrganizerCore::directory_refreshed()
 {
+  TraceSpan span("OrganizerCore::directory_refreshed");
+  static MetricCounter &s_Refreshes = RuntimeMetrics::instance().counter("organizer.directoryRefreshes");
+  s_Refreshes.increment();
+
   DirectoryEntry *newStructure = m_DirectoryRefresher.getDirectoryStructure();
   Q_ASSERT(newStructure != m_DirectoryStructure);
   if (newStructure != nullptr) {
-    std::swap(m_DirectoryStructure, newStructure);
-    delete newStructure;
+    activateStructure(newStructure);
   } else {
     // TODO: don't know why this happens, this slot seems to get called twice with only one emit
-    return;
   }
+}
+
+void OrganizerCore::activateStructure(DirectoryEntry *newStructure)
+{
+  std::swap(m_DirectoryStructure, newStructure);
+  if (m_QueryDepth > 0) {
+    // a bulk query is still iterating over the old structure
+    m_RetiredStructures.push_back(newStructure);
+  } else if (!m_StructureProfile.isEmpty()) {
+    m_StructureCache.store(m_StructureProfile, m_StructureFingerprint, newStructure, m_StructureOrigins);
+  } else {
+    delete newStructure;
+  }
+  m_StructureProfile.clear();
+  m_RestoredFingerprint.clear();
+
   m_DirectoryUpdate = false;
   if (m_CurrentProfile != nullptr) {
     refreshLists();
@@ -1391,6 +1630,8 @@ void OrganizerCore::directory_refreshed()
   for (auto task : m_PostRefreshTasks) {
     task();
   }
+
+  emit directoryStructureChanged();
 }
 
 void OrganizerCore::profileRefresh()
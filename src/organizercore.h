@@ -9,6 +9,7 @@
 #include "modinfo.h"
 #include "pluginlist.h"
 #include "directoryrefresher.h"
+#include "directorystructurecache.h"
 #include "installationmanager.h"
 #include "downloadmanager.h"
 #include "executableslist.h"
@@ -44,6 +45,7 @@ class QWidget;
 #include <Windows.h> //for HANDLE, LPDWORD
 
 #include <functional>
+#include <set>
 #include <vector>
 
 class PluginContainer;
@@ -82,6 +84,22 @@ private:
   typedef boost::signals2::signal<void (const QString&, unsigned int)> SignalFinishedRunApplication;
   typedef boost::signals2::signal<void (const QString&)> SignalModInstalled;
 
+public:
+
+  /**
+   * @brief packed result of a bulk query on the virtual data directory
+   */
+  struct ResolvedFile {
+    QString relativePath;          ///< the queried path or, for patterns, the path of the match
+    QString fullPath;              ///< real location of the file. empty if it doesn't exist
+    int origin;                    ///< id of the providing origin, -1 if the file doesn't exist
+    std::vector<int> alternatives; ///< ids of the origins that are overwritten
+    bool fromArchive;
+  };
+
+  /// receives the results of a bulk query one at a time. return false to stop the query
+  typedef std::function<bool (const ResolvedFile &)> ResolvedFileCallback;
+
 public:
 
   OrganizerCore(const QSettings &initSettings);
@@ -102,6 +120,12 @@ public:
   SelfUpdater *updater() { return &m_Updater; }
   InstallationManager *installationManager();
   MOShared::DirectoryEntry *directoryStructure() { return m_DirectoryStructure; }
+  /**
+   * @brief keep the current directory structure alive until releaseStructure is called. A
+   *        refresh may still replace it in the meantime, it just isn't deleted
+   */
+  const MOShared::DirectoryEntry *pinStructure() { return beginQuery(); }
+  void releaseStructure() { endQuery(); }
   DirectoryRefresher *directoryRefresher() { return &m_DirectoryRefresher; }
   ExecutablesList *executablesList() { return &m_ExecutablesList; }
   void setExecutablesList(const ExecutablesList &executablesList) {
@@ -165,6 +189,33 @@ public:
   QStringList findFiles(const QString &path, const std::function<bool (const QString &)> &filter) const;
   QStringList getFileOrigins(const QString &fileName) const;
   QList<MOBase::IOrganizer::FileInfo> findFileInfos(const QString &path, const std::function<bool (const MOBase::IOrganizer::FileInfo &)> &filter) const;
+
+  /**
+   * @brief resolve a list of paths relative to the data directory in one call
+   * @param fileNames the paths to resolve
+   * @param callback receives one result per path, in order, including paths that don't exist
+   * @note all results come from the same directory structure, even if a refresh completes
+   *       while the callback runs
+   */
+  void resolvePaths(const QStringList &fileNames, const ResolvedFileCallback &callback) const;
+  std::vector<ResolvedFile> resolvePaths(const QStringList &fileNames) const;
+
+  /**
+   * @brief find all files matching a list of patterns in one call
+   * @param patterns patterns like "textures\*.dds". Wildcards are only supported in the file
+   *                 name. A "**" directory right before the name, as in "meshes\**\*.nif",
+   *                 also searches all subdirectories
+   * @param callback receives each matching file
+   */
+  void findFilesMatching(const QStringList &patterns, const ResolvedFileCallback &callback) const;
+  std::vector<ResolvedFile> findFilesMatching(const QStringList &patterns) const;
+
+  /**
+   * @return name of the origin (mod) with the specified id as used in the bulk queries
+   * @note ids are only valid until the next refresh of the directory structure
+   */
+  QString originName(int originID) const;
+
   DownloadManager *downloadManager();
   PluginList *pluginList();
   ModList *modList();
@@ -215,6 +266,12 @@ signals:
 
   void managedGameChanged(MOBase::IPluginGame const *gamePlugin);
 
+  /**
+   * @brief emitted after a new directory structure was activated, either from a refresh or
+   *        from the cache. Pointers to the previous structure are invalid at this point
+   */
+  void directoryStructureChanged();
+
 private:
 
   void storeSettings();
@@ -237,6 +294,21 @@ private:
 
   bool waitForProcessCompletion(HANDLE handle, LPDWORD exitCode);
 
+  MOShared::DirectoryEntry *beginQuery() const;
+  void endQuery() const;
+
+  /**
+   * @brief fingerprint of everything the directory structure for the current profile is
+   *        built from: active mods, their priorities and modification times and the archives
+   * @param origins receives the names of the active mods
+   */
+  QByteArray structureFingerprint(std::set<QString> &origins);
+
+  // use a cached structure for the current profile if possible, otherwise refresh
+  void switchDirectoryStructure();
+  void startDirectoryRefresh();
+  void activateStructure(MOShared::DirectoryEntry *newStructure);
+
 private slots:
 
   void directory_refreshed();
@@ -280,6 +352,18 @@ private:
 
   DirectoryRefresher m_DirectoryRefresher;
   MOShared::DirectoryEntry *m_DirectoryStructure;
+  // structures replaced while a bulk query was using them. deleted when the last query ends
+  mutable std::vector<MOShared::DirectoryEntry*> m_RetiredStructures;
+  mutable int m_QueryDepth;
+
+  DirectoryStructureCache m_StructureCache;
+  // what the current structure was built from, set when it is about to be replaced by a
+  // profile switch. empty if the structure mustn't be cached
+  QString m_StructureProfile;
+  QByteArray m_StructureFingerprint;
+  std::set<QString> m_StructureOrigins;
+  // fingerprint of the structure if it was just restored from the cache
+  QByteArray m_RestoredFingerprint;
 
   DownloadManager m_DownloadManager;
   InstallationManager m_InstallationManager;
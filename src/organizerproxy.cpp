@@ -152,6 +152,31 @@ QList<MOBase::IOrganizer::FileInfo> OrganizerProxy::findFileInfos(const QString
   return m_Proxied->findFileInfos(path, filter);
 }
 
+void OrganizerProxy::resolvePaths(const QStringList &fileNames, const OrganizerCore::ResolvedFileCallback &callback) const
+{
+  m_Proxied->resolvePaths(fileNames, callback);
+}
+
+std::vector<OrganizerCore::ResolvedFile> OrganizerProxy::resolvePaths(const QStringList &fileNames) const
+{
+  return m_Proxied->resolvePaths(fileNames);
+}
+
+void OrganizerProxy::findFilesMatching(const QStringList &patterns, const OrganizerCore::ResolvedFileCallback &callback) const
+{
+  m_Proxied->findFilesMatching(patterns, callback);
+}
+
+std::vector<OrganizerCore::ResolvedFile> OrganizerProxy::findFilesMatching(const QStringList &patterns) const
+{
+  return m_Proxied->findFilesMatching(patterns);
+}
+
+QString OrganizerProxy::originName(int originID) const
+{
+  return m_Proxied->originName(originID);
+}
+
 MOBase::IDownloadManager *OrganizerProxy::downloadManager() const
 {
   return m_Proxied->downloadManager();
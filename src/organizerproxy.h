@@ -3,8 +3,7 @@
 
 
 #include <imoinfo.h>
-
-class OrganizerCore;
+#include "organizercore.h"
 
 class OrganizerProxy : public MOBase::IOrganizer
 {
@@ -35,6 +34,13 @@ public:
   virtual QStringList getFileOrigins(const QString &fileName) const;
   virtual QList<FileInfo> findFileInfos(const QString &path, const std::function<bool(const FileInfo&)> &filter) const;
 
+  // bulk variants of the above, see OrganizerCore
+  void resolvePaths(const QStringList &fileNames, const OrganizerCore::ResolvedFileCallback &callback) const;
+  std::vector<OrganizerCore::ResolvedFile> resolvePaths(const QStringList &fileNames) const;
+  void findFilesMatching(const QStringList &patterns, const OrganizerCore::ResolvedFileCallback &callback) const;
+  std::vector<OrganizerCore::ResolvedFile> findFilesMatching(const QStringList &patterns) const;
+  QString originName(int originID) const;
+
   virtual MOBase::IDownloadManager *downloadManager() const;
   virtual MOBase::IPluginList *pluginList() const;
   virtual MOBase::IModList *modList() const;
@@ -0,0 +1,158 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "phasetracer.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThread>
+
+
+QAtomicInt PhaseTracer::s_Enabled(0);
+
+
+static QString escapeJSON(const QString &input)
+{
+  QString result;
+  result.reserve(input.size());
+  for (QChar ch : input) {
+    if ((ch == '"') || (ch == '\\')) {
+      result.append('\\').append(ch);
+    } else if (ch.unicode() < 0x20) {
+      result.append(QString("\\u%1").arg(ch.unicode(), 4, 16, QChar('0')));
+    } else {
+      result.append(ch);
+    }
+  }
+  return result;
+}
+
+
+PhaseTracer::PhaseTracer()
+{
+  m_Clock.start();
+}
+
+
+PhaseTracer &PhaseTracer::instance()
+{
+  static PhaseTracer s_Instance;
+  return s_Instance;
+}
+
+
+void PhaseTracer::setEnabled(bool enabled)
+{
+  s_Enabled.store(enabled ? 1 : 0);
+}
+
+
+qint64 PhaseTracer::now() const
+{
+  return m_Clock.nsecsElapsed() / 1000;
+}
+
+
+PhaseTracer::ThreadBuffer *PhaseTracer::threadBuffer()
+{
+  if (!m_ThreadBuffer.hasLocalData()) {
+    // first span on this thread. The list shares ownership so the buffer outlives the thread
+    std::shared_ptr<ThreadBuffer> buffer(new ThreadBuffer);
+    QThread *thread = QThread::currentThread();
+    buffer->threadId = reinterpret_cast<quintptr>(QThread::currentThreadId());
+    buffer->threadName = thread->objectName();
+    if (buffer->threadName.isEmpty()) {
+      if ((QCoreApplication::instance() != nullptr)
+          && (thread == QCoreApplication::instance()->thread())) {
+        buffer->threadName = "main";
+      } else {
+        buffer->threadName = QString("thread %1").arg(buffer->threadId);
+      }
+    }
+    buffer->events.reset(new Event[ThreadBuffer::CAPACITY]);
+
+    QMutexLocker lock(&m_Mutex);
+    m_Buffers.push_back(buffer);
+    m_ThreadBuffer.setLocalData(buffer);
+  }
+  return m_ThreadBuffer.localData().get();
+}
+
+
+void PhaseTracer::record(const char *name, qint64 start, qint64 duration)
+{
+  ThreadBuffer *buffer = threadBuffer();
+  int index = buffer->count.load();
+  if (index >= ThreadBuffer::CAPACITY) {
+    buffer->dropped.fetchAndAddOrdered(1);
+    return;
+  }
+  Event &event = buffer->events[index];
+  event.name = name;
+  event.start = start;
+  event.duration = duration;
+  // make the event visible to write() only once it's complete
+  buffer->count.storeRelease(index + 1);
+}
+
+
+bool PhaseTracer::write(const QString &fileName) const
+{
+  QDir().mkpath(QFileInfo(fileName).absolutePath());
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    qWarning("failed to write trace to %s", qPrintable(fileName));
+    return false;
+  }
+
+  QTextStream stream(&file);
+  stream.setCodec("UTF-8");
+  stream << "{\"traceEvents\":[";
+
+  QMutexLocker lock(&m_Mutex);
+  bool first = true;
+  for (const std::shared_ptr<ThreadBuffer> &buffer : m_Buffers) {
+    if (!first) {
+      stream << ",";
+    }
+    first = false;
+    stream << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+           << ",\"args\":{\"name\":\"" << escapeJSON(buffer->threadName) << "\"}}";
+
+    int count = buffer->count.loadAcquire();
+    for (int i = 0; i < count; ++i) {
+      const Event &event = buffer->events[i];
+      stream << ",\n{\"name\":\"" << escapeJSON(QString::fromUtf8(event.name))
+             << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+             << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+    }
+
+    if (buffer->dropped.load() > 0) {
+      qWarning("%d spans on thread \"%s\" were dropped",
+               buffer->dropped.load(), qPrintable(buffer->threadName));
+    }
+  }
+  stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  stream.flush();
+
+  return file.error() == QFile::NoError;
+}
@@ -0,0 +1,154 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHASETRACER_H
+#define PHASETRACER_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QThreadStorage>
+
+#include <memory>
+#include <vector>
+
+
+/**
+ * @brief records how long the phases of startup and refreshes take
+ *
+ * Spans are appended to a buffer owned by the recording thread so recording never waits for
+ * other threads. The result can be written in the Chrome trace event format which
+ * chrome://tracing and Perfetto can display. While tracing is disabled a span costs a
+ * single atomic load.
+ */
+class PhaseTracer
+{
+
+public:
+
+  static PhaseTracer &instance();
+
+  static bool enabled() { return s_Enabled.load() != 0; }
+
+  void setEnabled(bool enabled);
+
+  /**
+   * @return microseconds since the tracer was created
+   */
+  qint64 now() const;
+
+  /**
+   * @brief record a completed span on the calling thread
+   * @param name name of the span. This has to be a string literal
+   * @param start start time as returned by now()
+   * @param duration duration in microseconds
+   */
+  void record(const char *name, qint64 start, qint64 duration);
+
+  /**
+   * @brief write all spans recorded so far as chrome trace json
+   * @param fileName file to write to
+   * @return true on success
+   */
+  bool write(const QString &fileName) const;
+
+private:
+
+  struct Event {
+    const char *name;
+    qint64 start;
+    qint64 duration;
+  };
+
+  struct ThreadBuffer {
+    static const int CAPACITY = 16384;
+
+    quint64 threadId;
+    QString threadName;
+    std::unique_ptr<Event[]> events;
+    /// number of valid events. Only written by the owning thread
+    QAtomicInt count;
+    QAtomicInt dropped;
+  };
+
+private:
+
+  PhaseTracer();
+
+  ThreadBuffer *threadBuffer();
+
+private:
+
+  static QAtomicInt s_Enabled;
+
+  QElapsedTimer m_Clock;
+
+  mutable QMutex m_Mutex; // guards the list of buffers, not their content
+  std::vector<std::shared_ptr<ThreadBuffer>> m_Buffers;
+  QThreadStorage<std::shared_ptr<ThreadBuffer>> m_ThreadBuffer;
+
+};
+
+
+/**
+ * @brief measures the time from its construction to its destruction (or to finish())
+ */
+class TraceSpan
+{
+
+public:
+
+  explicit TraceSpan(const char *name)
+    : m_Name(nullptr)
+    , m_Start(0)
+  {
+    if (PhaseTracer::enabled()) {
+      m_Name = name;
+      m_Start = PhaseTracer::instance().now();
+    }
+  }
+
+  ~TraceSpan()
+  {
+    finish();
+  }
+
+  void finish()
+  {
+    if (m_Name != nullptr) {
+      PhaseTracer &tracer = PhaseTracer::instance();
+      tracer.record(m_Name, m_Start, tracer.now() - m_Start);
+      m_Name = nullptr;
+    }
+  }
+
+private:
+
+  TraceSpan(const TraceSpan&);
+  TraceSpan &operator=(const TraceSpan&);
+
+private:
+
+  const char *m_Name;
+  qint64 m_Start;
+
+};
+
+#endif // PHASETRACER_H
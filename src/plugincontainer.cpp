@@ -1,5 +1,6 @@
 #include "plugincontainer.h"
 #include "organizerproxy.h"
+#include "phasetracer.h"
 #include "report.h"
 #include <ipluginproxy.h>
 #include <idownloadmanager.h>
@@ -9,6 +10,7 @@
 #include <QCoreApplication>
 #include <QMessageBox>
 #include <QDirIterator>
+#include <QDataStream>
 #include <boost/fusion/sequence/intrinsic/at_key.hpp>
 #include <boost/fusion/include/at_key.hpp>
 #include <boost/fusion/algorithm/iteration/for_each.hpp>
@@ -20,9 +22,18 @@ using namespace MOShared;
 namespace bf = boost::fusion;
 
 
+static const char MANIFEST_FILE[] = "plugin_manifest.dat";
+static const quint32 MANIFEST_VERSION = 2;
+
+// first line of the load check file if it lists all plugins of a load phase
+static const char PHASE_JOURNAL[] = "#phase";
+
+
 PluginContainer::PluginContainer(OrganizerCore *organizer)
   : m_Organizer(organizer)
   , m_UserInterface(nullptr)
+  , m_ManifestDirty(false)
+  , m_CarefulLoad(false)
 {
 }
 
@@ -53,6 +64,7 @@ QStringList PluginContainer::pluginFileNames() const
   for (QPluginLoader *loader : m_PluginLoaders) {
     result.append(loader->fileName());
   }
+  result.append(m_DeferredPlugins);
   return result;
 }
 
@@ -194,6 +206,9 @@ void PluginContainer::unloadPlugins()
 
   bf::for_each(m_Plugins, clearPlugins());
 
+  m_PreviewGenerator.clearDeferred();
+  m_DeferredPlugins.clear();
+
   foreach (const boost::signals2::connection &connection, m_DiagnosisConnections) {
     connection.disconnect();
   }
@@ -224,67 +239,267 @@ const PreviewGenerator &PluginContainer::previewGenerator() const
   return m_PreviewGenerator;
 }
 
+void PluginContainer::readManifest()
+{
+  m_Manifest.clear();
+  m_ManifestDirty = false;
+
+  QFile file(qApp->property("dataPath").toString() + "/" + MANIFEST_FILE);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  QDataStream stream(&file);
+  quint32 version = 0;
+  stream >> version;
+  if (version != MANIFEST_VERSION) {
+    return;
+  }
+
+  while (!stream.atEnd() && (stream.status() == QDataStream::Ok)) {
+    QString fileName;
+    PluginManifest manifest;
+    stream >> fileName >> manifest.size >> manifest.modified >> manifest.name
+           >> manifest.interfaces >> manifest.extensions >> manifest.hasSettings;
+    if (stream.status() != QDataStream::Ok) {
+      break;
+    }
+    m_Manifest[fileName] = manifest;
+  }
+}
+
+
+void PluginContainer::writeManifest()
+{
+  if (!m_ManifestDirty) {
+    return;
+  }
+
+  QFile file(qApp->property("dataPath").toString() + "/" + MANIFEST_FILE);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    qWarning("failed to write %s", qPrintable(file.fileName()));
+    return;
+  }
+
+  QDataStream stream(&file);
+  stream << MANIFEST_VERSION;
+  for (auto iter = m_Manifest.begin(); iter != m_Manifest.end(); ++iter) {
+    const PluginManifest &manifest = iter->second;
+    stream << iter->first << manifest.size << manifest.modified << manifest.name
+           << manifest.interfaces << manifest.extensions << manifest.hasSettings;
+  }
+  m_ManifestDirty = false;
+}
+
+
+void PluginContainer::updateManifest(const QFileInfo &fileInfo, QObject *plugin)
+{
+  if (plugin == nullptr) {
+    // don't remember plugins that failed to load
+    if (m_Manifest.erase(fileInfo.fileName()) > 0) {
+      m_ManifestDirty = true;
+    }
+    return;
+  }
+
+  PluginManifest manifest;
+  manifest.size = fileInfo.size();
+  manifest.modified = fileInfo.lastModified();
+  manifest.hasSettings = false;
+  IPlugin *pluginObj = qobject_cast<IPlugin*>(plugin);
+  if (pluginObj != nullptr) {
+    manifest.name = pluginObj->name();
+    manifest.hasSettings = !pluginObj->settings().isEmpty();
+  }
+  if (qobject_cast<IPluginDiagnose*>(plugin) != nullptr) manifest.interfaces.append("IPluginDiagnose");
+  if (qobject_cast<IPluginModPage*>(plugin) != nullptr) manifest.interfaces.append("IPluginModPage");
+  if (qobject_cast<IPluginGame*>(plugin) != nullptr) manifest.interfaces.append("IPluginGame");
+  if (qobject_cast<IPluginTool*>(plugin) != nullptr) manifest.interfaces.append("IPluginTool");
+  if (qobject_cast<IPluginInstaller*>(plugin) != nullptr) manifest.interfaces.append("IPluginInstaller");
+  if (qobject_cast<IPluginProxy*>(plugin) != nullptr) manifest.interfaces.append("IPluginProxy");
+  IPluginPreview *preview = qobject_cast<IPluginPreview*>(plugin);
+  if (preview != nullptr) {
+    manifest.interfaces.append("IPluginPreview");
+    for (const QString &extension : preview->supportedExtensions()) {
+      manifest.extensions.append(extension);
+    }
+  }
+
+  m_Manifest[fileInfo.fileName()] = manifest;
+  m_ManifestDirty = true;
+}
+
+
+bool PluginContainer::canDefer(const QFileInfo &fileInfo) const
+{
+  if (m_CarefulLoad) {
+    return false;
+  }
+
+  auto iter = m_Manifest.find(fileInfo.fileName());
+  if ((iter == m_Manifest.end())
+      || (iter->second.size != fileInfo.size())
+      || (iter->second.modified != fileInfo.lastModified())) {
+    // unknown or changed since we last saw it
+    return false;
+  }
+
+  // only pure preview plugins are loaded on demand. Everything else is either needed during
+  // startup (games, proxies), visible in the ui right away (tools, mod pages, diagnosis) or
+  // takes part in every installation (installers). Plugins with settings have to be
+  // registered with the settings dialog, which requires the plugin instance
+  return (iter->second.interfaces == QStringList("IPluginPreview"))
+      && !iter->second.extensions.isEmpty()
+      && !iter->second.hasSettings;
+}
+
+
+bool PluginContainer::loadPlugin(const QString &fileName)
+{
+  QFileInfo fileInfo(fileName);
+  std::unique_ptr<QPluginLoader> pluginLoader(new QPluginLoader(fileName, this));
+  if (pluginLoader->instance() == nullptr) {
+    m_FailedPlugins.push_back(fileName);
+    qCritical("failed to load plugin %s: %s",
+              qPrintable(fileName), qPrintable(pluginLoader->errorString()));
+  } else {
+    if (registerPlugin(pluginLoader->instance(), fileName)) {
+      qDebug("loaded plugin \"%s\"", qPrintable(fileInfo.fileName()));
+      updateManifest(fileInfo, pluginLoader->instance());
+      m_PluginLoaders.push_back(pluginLoader.release());
+      return true;
+    } else {
+      m_FailedPlugins.push_back(fileName);
+      qWarning("plugin \"%s\" failed to load", qPrintable(fileName));
+    }
+  }
+  updateManifest(fileInfo, nullptr);
+  return false;
+}
+
+
+void PluginContainer::loadDeferred(const QString &fileName)
+{
+  m_DeferredPlugins.removeAll(fileName);
+
+  // a deferred plugin is a load phase of its own
+  m_PluginsCheck.open(QIODevice::WriteOnly | QIODevice::Truncate);
+  m_PluginsCheck.write(QFileInfo(fileName).fileName().toUtf8());
+  m_PluginsCheck.write("\n");
+  m_PluginsCheck.flush();
+
+  if (!loadPlugin(fileName)) {
+    emit diagnosisUpdate();
+  }
+
+  m_PluginsCheck.remove();
+  writeManifest();
+}
+
+
 void PluginContainer::loadPlugins()
 {
+  TraceSpan span("PluginContainer::loadPlugins");
+
   unloadPlugins();
 
   for (QObject *plugin : QPluginLoader::staticInstances()) {
     registerPlugin(plugin, "");
   }
 
-  QFile loadCheck(qApp->property("dataPath").toString() + "/plugin_loadcheck.tmp");
-  if (loadCheck.exists() && loadCheck.open(QIODevice::ReadOnly)) {
-    // oh, there was a failed plugin load last time. Find out which plugin was loaded last
-    QString fileName;
-    while (!loadCheck.atEnd()) {
-      fileName = QString::fromUtf8(loadCheck.readLine().constData()).trimmed();
+  m_CarefulLoad = false;
+  m_PluginsCheck.setFileName(qApp->property("dataPath").toString() + "/plugin_loadcheck.tmp");
+  if (m_PluginsCheck.exists() && m_PluginsCheck.open(QIODevice::ReadOnly)) {
+    QStringList journal;
+    while (!m_PluginsCheck.atEnd()) {
+      QString line = QString::fromUtf8(m_PluginsCheck.readLine().constData()).trimmed();
+      if (!line.isEmpty()) {
+        journal.append(line);
+      }
     }
-    if (QMessageBox::question(nullptr, QObject::tr("Plugin error"),
-      QObject::tr("It appears the plugin \"%1\" failed to load last startup and caused MO to crash. Do you want to disable it?\n"
-         "(Please note: If this is the first time you see this message for this plugin you may want to give it another try. "
-         "The plugin may be able to recover from the problem)").arg(fileName),
-          QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes) == QMessageBox::Yes) {
-      m_Organizer->settings().addBlacklistPlugin(fileName);
+    m_PluginsCheck.close();
+
+    if (!journal.isEmpty() && (journal.first() == PHASE_JOURNAL)) {
+      // the whole phase was logged at once so we can't tell which plugin failed. This time
+      // plugins are logged individually so a repeated crash can be attributed
+      qWarning("plugins failed to load last startup, checking them individually");
+      m_CarefulLoad = true;
+    } else if (!journal.isEmpty()) {
+      // oh, there was a failed plugin load last time. Find out which plugin was loaded last
+      QString fileName = journal.last();
+      if (QMessageBox::question(nullptr, QObject::tr("Plugin error"),
+        QObject::tr("It appears the plugin \"%1\" failed to load last startup and caused MO to crash. Do you want to disable it?\n"
+           "(Please note: If this is the first time you see this message for this plugin you may want to give it another try. "
+           "The plugin may be able to recover from the problem)").arg(fileName),
+            QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes) == QMessageBox::Yes) {
+        m_Organizer->settings().addBlacklistPlugin(fileName);
+      }
     }
-    loadCheck.close();
   }
 
-  loadCheck.open(QIODevice::WriteOnly);
+  readManifest();
 
   QString pluginPath = qApp->applicationDirPath() + "/" + ToQString(AppConfig::pluginPath());
   qDebug("looking for plugins in %s", QDir::toNativeSeparators(pluginPath).toUtf8().constData());
   QDirIterator iter(pluginPath, QDir::Files | QDir::NoDotAndDotDot);
 
+  QStringList loadNow;
   while (iter.hasNext()) {
     iter.next();
     if (m_Organizer->settings().pluginBlacklisted(iter.fileName())) {
       qDebug("plugin \"%s\" blacklisted", qPrintable(iter.fileName()));
       continue;
     }
-    loadCheck.write(iter.fileName().toUtf8());
-    loadCheck.write("\n");
-    loadCheck.flush();
-    QString pluginName = iter.filePath();
-    if (QLibrary::isLibrary(pluginName)) {
-      std::unique_ptr<QPluginLoader> pluginLoader(new QPluginLoader(pluginName, this));
-      if (pluginLoader->instance() == nullptr) {
-        m_FailedPlugins.push_back(pluginName);
-        qCritical("failed to load plugin %s: %s",
-                  qPrintable(pluginName), qPrintable(pluginLoader->errorString()));
-      } else {
-        if (registerPlugin(pluginLoader->instance(), pluginName)) {
-          qDebug("loaded plugin \"%s\"", qPrintable(QFileInfo(pluginName).fileName()));
-          m_PluginLoaders.push_back(pluginLoader.release());
-        } else {
-          m_FailedPlugins.push_back(pluginName);
-          qWarning("plugin \"%s\" failed to load", qPrintable(pluginName));
-        }
-      }
+    if (!QLibrary::isLibrary(iter.filePath())) {
+      continue;
     }
+    if (canDefer(iter.fileInfo())) {
+      m_PreviewGenerator.registerDeferred(iter.filePath(), m_Manifest[iter.fileName()].extensions);
+      m_DeferredPlugins.append(iter.filePath());
+      qDebug("plugin \"%s\" will be loaded on demand", qPrintable(iter.fileName()));
+    } else {
+      loadNow.append(iter.filePath());
+    }
+  }
+
+  m_PluginsCheck.open(QIODevice::WriteOnly | QIODevice::Truncate);
+  if (!m_CarefulLoad) {
+    // log the whole phase in one go
+    m_PluginsCheck.write(PHASE_JOURNAL);
+    m_PluginsCheck.write("\n");
+    for (const QString &pluginName : loadNow) {
+      m_PluginsCheck.write(QFileInfo(pluginName).fileName().toUtf8());
+      m_PluginsCheck.write("\n");
+    }
+    m_PluginsCheck.flush();
+  }
+
+  for (const QString &pluginName : loadNow) {
+    if (m_CarefulLoad) {
+      m_PluginsCheck.write(QFileInfo(pluginName).fileName().toUtf8());
+      m_PluginsCheck.write("\n");
+      m_PluginsCheck.flush();
+    }
+    loadPlugin(pluginName);
   }
 
   // remove the load check file on success
-  loadCheck.remove();
+  m_PluginsCheck.remove();
+
+  // forget about plugins that were removed
+  for (auto manifestIter = m_Manifest.begin(); manifestIter != m_Manifest.end();) {
+    if (!QFile::exists(pluginPath + "/" + manifestIter->first)) {
+      manifestIter = m_Manifest.erase(manifestIter);
+      m_ManifestDirty = true;
+    } else {
+      ++manifestIter;
+    }
+  }
+  writeManifest();
+
+  m_PreviewGenerator.setDeferredLoader([this] (const QString &fileName) {
+    loadDeferred(fileName);
+  });
 
   bf::at_key<IPluginDiagnose>(m_Plugins).push_back(this);
 
@@ -13,6 +13,8 @@
 #include <QtPlugin>
 #include <QPluginLoader>
 #include <QFile>
+#include <QDateTime>
+#include <QFileInfo>
 #ifndef Q_MOC_RUN
 #include <boost/fusion/container.hpp>
 #include <boost/fusion/include/at_key.hpp>
@@ -41,6 +43,18 @@ private:
 
   static const unsigned int PROBLEM_PLUGINSNOTLOADED = 1;
 
+  /**
+   * @brief what we know about a plugin library from the last time it was loaded
+   **/
+  struct PluginManifest {
+    qint64 size;
+    QDateTime modified;
+    QString name;
+    QStringList interfaces;
+    QStringList extensions; // only for preview plugins
+    bool hasSettings;
+  };
+
 public:
 
   PluginContainer(OrganizerCore *organizer);
@@ -81,6 +95,13 @@ private:
   bool registerPlugin(QObject *pluginObj, const QString &fileName);
   bool unregisterPlugin(QObject *pluginObj, const QString &fileName);
 
+  bool loadPlugin(const QString &fileName);
+  void loadDeferred(const QString &fileName);
+  bool canDefer(const QFileInfo &fileInfo) const;
+  void updateManifest(const QFileInfo &fileInfo, QObject *plugin);
+  void readManifest();
+  void writeManifest();
+
   OrganizerCore *m_Organizer;
 
   IUserInterface *m_UserInterface;
@@ -91,6 +112,11 @@ private:
   std::vector<boost::signals2::connection> m_DiagnosisConnections;
   QStringList m_FailedPlugins;
   std::vector<QPluginLoader*> m_PluginLoaders;
+  QStringList m_DeferredPlugins;
+
+  std::map<QString, PluginManifest> m_Manifest; // keyed by the plugin file name
+  bool m_ManifestDirty;
+  bool m_CarefulLoad;
 
   PreviewGenerator m_PreviewGenerator;
 
@@ -23,6 +23,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "safewritefile.h"
 #include "scopeguard.h"
 #include "modinfo.h"
+#include "phasetracer.h"
 #include <utility.h>
 #include <iplugingame.h>
 #include <espfile.h>
@@ -46,6 +47,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <ctime>
 #include <algorithm>
+#include <utility>
 #include <stdexcept>
 
 
@@ -122,6 +124,8 @@ void PluginList::refresh(const QString &profileName
                          , const QString &loadOrderFile
                          , const QString &lockedOrderFile)
 {
+  TraceSpan span("PluginList::refresh");
+
   ChangeBracket<PluginList> layoutChange(this);
 
   m_ESPsByName.clear();
@@ -207,6 +211,7 @@ void PluginList::refresh(const QString &profileName
   std::sort(m_ESPs.begin(), m_ESPs.end(), ByName); // sort by name so alphabetical sorting works
 
   updateIndices();
+  buildDependencyGraph();
 
   readEnabledFrom(pluginsFile);
 
@@ -226,7 +231,10 @@ void PluginList::enableESP(const QString &name, bool enable)
   std::map<QString, int>::iterator iter = m_ESPsByName.find(name.toLower());
 
   if (iter != m_ESPsByName.end()) {
-    m_ESPs[iter->second].m_Enabled = enable;
+    if (m_ESPs[iter->second].m_Enabled != enable) {
+      m_ESPs[iter->second].m_Enabled = enable;
+      updateDependents(iter->second);
+    }
 
     emit writePluginsList();
   } else {
@@ -242,6 +250,7 @@ void PluginList::enableAll()
     for (std::vector<ESPInfo>::iterator iter = m_ESPs.begin(); iter != m_ESPs.end(); ++iter) {
       iter->m_Enabled = true;
     }
+    testMasters();
     emit writePluginsList();
   }
 }
@@ -256,6 +265,7 @@ void PluginList::disableAll()
         iter->m_Enabled = false;
       }
     }
+    testMasters();
     emit writePluginsList();
   }
 }
@@ -593,44 +603,105 @@ void PluginList::syncLoadOrder()
   }
 }
 
-void PluginList::refreshLoadOrder()
+int PluginList::orderGroup(const ESPInfo &esp)
 {
-  ChangeBracket<PluginList> layoutChange(this);
-  syncLoadOrder();
-  // set priorities according to locked load order
-  std::map<int, QString> lockedLoadOrder;
-  std::for_each(m_LockedOrder.begin(), m_LockedOrder.end(),
-                [&lockedLoadOrder] (const std::pair<QString, int> &ele) {
-    lockedLoadOrder[ele.second] = ele.first; });
+  if (esp.m_IsMaster) {
+    // primary plugins always load first, followed by the remaining masters
+    return esp.m_ForceEnabled ? 0 : 1;
+  } else {
+    return 2;
+  }
+}
 
-  int targetPrio = 0;
-  bool savePluginsList = false;
-  // this is guaranteed to iterate from lowest key (load order) to highest
-  for (auto iter = lockedLoadOrder.begin(); iter != lockedLoadOrder.end(); ++iter) {
-    auto nameIter = m_ESPsByName.find(iter->second);
+
+std::vector<int> PluginList::solveLoadOrder() const
+{
+  static const int NUM_GROUPS = 3;
+
+  // locked plugins per group, sorted by their locked load order
+  std::vector<std::pair<int, int>> locked[NUM_GROUPS];
+  std::vector<bool> isLocked(m_ESPs.size(), false);
+  for (auto iter = m_LockedOrder.begin(); iter != m_LockedOrder.end(); ++iter) {
+    auto nameIter = m_ESPsByName.find(iter->first);
     if (nameIter != m_ESPsByName.end()) {
-      // locked esp exists
+      int index = nameIter->second;
+      locked[orderGroup(m_ESPs[index])].push_back(std::make_pair(iter->second, index));
+      isLocked[index] = true;
+    }
+  }
+  for (int group = 0; group < NUM_GROUPS; ++group) {
+    std::stable_sort(locked[group].begin(), locked[group].end(),
+                     [] (const std::pair<int, int> &LHS, const std::pair<int, int> &RHS) {
+                       return LHS.first < RHS.first;
+                     });
+  }
 
-      // find the location to insert at
-      while ((targetPrio < static_cast<int>(m_ESPs.size() - 1)) &&
-             (m_ESPs[m_ESPsByPriority[targetPrio]].m_LoadOrder < iter->first)) {
-        ++targetPrio;
-      }
+  // the unlocked plugins keep their relative order within their group
+  std::vector<int> unlocked[NUM_GROUPS];
+  for (int index : m_ESPsByPriority) {
+    if (!isLocked[index]) {
+      unlocked[orderGroup(m_ESPs[index])].push_back(index);
+    }
+  }
 
-      if (static_cast<size_t>(targetPrio) >= m_ESPs.size()) {
-        continue;
+  // merge the locked plugins into the sequence. A locked plugin is inserted in front of the
+  // first enabled plugin that would otherwise receive its load order (or a later one)
+  std::vector<int> result;
+  result.reserve(m_ESPs.size());
+  int loadOrder = 0;
+  auto append = [&] (int index) {
+    result.push_back(index);
+    if (m_ESPs[index].m_Enabled) {
+      ++loadOrder;
+    }
+  };
+
+  for (int group = 0; group < NUM_GROUPS; ++group) {
+    auto lockIter = locked[group].begin();
+    for (int index : unlocked[group]) {
+      while ((lockIter != locked[group].end())
+             && m_ESPs[index].m_Enabled
+             && (lockIter->first <= loadOrder)) {
+        append(lockIter->second);
+        ++lockIter;
       }
+      append(index);
+    }
+    // locked plugins beyond the end of their group
+    for (; lockIter != locked[group].end(); ++lockIter) {
+      append(lockIter->second);
+    }
+  }
 
-      int temp = targetPrio;
-      int index = nameIter->second;
-      if (m_ESPs[index].m_Priority != temp) {
-        setPluginPriority(index, temp);
-        m_ESPs[index].m_LoadOrder = iter->first;
-        syncLoadOrder();
-        savePluginsList = true;
+  return result;
+}
+
+
+void PluginList::refreshLoadOrder()
+{
+  ChangeBracket<PluginList> layoutChange(this);
+
+  // compute the final arrangement in one go and apply it as a single permutation
+  std::vector<int> order = solveLoadOrder();
+
+  bool savePluginsList = false;
+  for (int priority = 0; priority < static_cast<int>(order.size()); ++priority) {
+    ESPInfo &esp = m_ESPs[order[priority]];
+    if (esp.m_Priority != priority) {
+      int oldPriority = esp.m_Priority;
+      esp.m_Priority = priority;
+      if (m_LockedOrder.find(esp.m_Name.toLower()) != m_LockedOrder.end()) {
+        m_PluginMoved(esp.m_Name, oldPriority, priority);
       }
+      savePluginsList = true;
     }
   }
+
+  if (savePluginsList) {
+    m_ESPsByPriority = order;
+  }
+  syncLoadOrder();
+
   if (savePluginsList) {
     emit writePluginsList();
   }
@@ -754,30 +825,98 @@ int PluginList::columnCount(const QModelIndex &) const
 }
 
 
-void PluginList::testMasters()
+void PluginList::buildDependencyGraph()
 {
-//  emit layoutAboutToBeChanged();
+  m_UnknownMasterIds.clear();
+  m_Dependents.clear();
+  m_Dependents.resize(m_ESPs.size());
 
-  std::set<QString> enabledMasters;
-  for (auto iter = m_ESPs.begin(); iter != m_ESPs.end(); ++iter) {
-    if (iter->m_Enabled) {
-      enabledMasters.insert(iter->m_Name.toLower());
+  for (int i = 0; i < static_cast<int>(m_ESPs.size()); ++i) {
+    ESPInfo &esp = m_ESPs[i];
+    esp.m_MasterIds.clear();
+    for (const QString &master : esp.m_Masters) {
+      int id = masterId(master.toLower());
+      esp.m_MasterIds[id] = master;
+      m_Dependents[id].push_back(i);
     }
   }
+}
+
+
+int PluginList::masterId(const QString &nameLower)
+{
+  auto iter = m_ESPsByName.find(nameLower);
+  if (iter != m_ESPsByName.end()) {
+    return iter->second;
+  }
 
+  // master that isn't installed, give it an id past the end of the plugin list
+  auto unknownIter = m_UnknownMasterIds.find(nameLower);
+  if (unknownIter != m_UnknownMasterIds.end()) {
+    return unknownIter->second;
+  }
+  int id = static_cast<int>(m_Dependents.size());
+  m_UnknownMasterIds[nameLower] = id;
+  m_Dependents.push_back(std::vector<int>());
+  return id;
+}
+
+
+bool PluginList::masterEnabled(int id) const
+{
+  return (id < static_cast<int>(m_ESPs.size())) && m_ESPs[id].m_Enabled;
+}
+
+
+void PluginList::testMasters()
+{
   for (auto iter = m_ESPs.begin(); iter != m_ESPs.end(); ++iter) {
     iter->m_MasterUnset.clear();
-    if (iter->m_Enabled) {
-      for (auto master = iter->m_Masters.begin(); master != iter->m_Masters.end(); ++master) {
-        if (enabledMasters.find(master->toLower()) == enabledMasters.end()) {
-          iter->m_MasterUnset.insert(*master);
-        }
+    for (auto master = iter->m_MasterIds.begin(); master != iter->m_MasterIds.end(); ++master) {
+      if (!masterEnabled(master->first)) {
+        iter->m_MasterUnset.insert(master->second);
       }
     }
   }
+}
+
+
+void PluginList::updateDependents(int index)
+{
+  bool enabled = m_ESPs[index].m_Enabled;
+  for (int dependent : m_Dependents[index]) {
+    ESPInfo &esp = m_ESPs[dependent];
+    const QString &master = esp.m_MasterIds[index];
+    if (enabled) {
+      esp.m_MasterUnset.erase(master);
+    } else {
+      esp.m_MasterUnset.insert(master);
+    }
+  }
+}
+
+
+QStringList PluginList::requiredBy(const QString &name) const
+{
+  QStringList result;
+  QString nameLower = name.toLower();
+  int id = -1;
+  auto iter = m_ESPsByName.find(nameLower);
+  if (iter != m_ESPsByName.end()) {
+    id = iter->second;
+  } else {
+    auto unknownIter = m_UnknownMasterIds.find(nameLower);
+    if (unknownIter != m_UnknownMasterIds.end()) {
+      id = unknownIter->second;
+    }
+  }
 
-#pragma message("emitting this seems to cause a crash!")
-//  emit layoutChanged();
+  if (id != -1) {
+    for (int dependent : m_Dependents[id]) {
+      result.append(m_ESPs[dependent].m_Name);
+    }
+  }
+  return result;
 }
 
 QVariant PluginList::data(const QModelIndex &modelIndex, int role) const
@@ -848,7 +987,7 @@ QVariant PluginList::data(const QModelIndex &modelIndex, int role) const
       if (m_ESPs[index].m_Description.size() > 0) {
         text += "<br><b>" + tr("Description") + "</b>: " + m_ESPs[index].m_Description;
       }
-      if (m_ESPs[index].m_MasterUnset.size() > 0) {
+      if (m_ESPs[index].m_Enabled && (m_ESPs[index].m_MasterUnset.size() > 0)) {
         text += "<br><b>" + tr("Missing Masters") + "</b>: <b>" + SetJoin(m_ESPs[index].m_MasterUnset, ", ") + "</b>";
       }
       std::set<QString> enabledMasters;
@@ -871,7 +1010,7 @@ QVariant PluginList::data(const QModelIndex &modelIndex, int role) const
   } else if (role == Qt::UserRole + 1) {
     QVariantList result;
     QString nameLower = m_ESPs[index].m_Name.toLower();
-    if (m_ESPs[index].m_MasterUnset.size() > 0) {
+    if (m_ESPs[index].m_Enabled && (m_ESPs[index].m_MasterUnset.size() > 0)) {
       result.append(":/MO/gui/warning");
     }
     if (m_LockedOrder.find(nameLower) != m_LockedOrder.end()) {
@@ -903,7 +1042,11 @@ bool PluginList::setData(const QModelIndex &modIndex, const QVariant &value, int
   bool result = false;
 
   if (role == Qt::CheckStateRole) {
-    m_ESPs[modIndex.row()].m_Enabled = value.toInt() == Qt::Checked;
+    bool enabled = value.toInt() == Qt::Checked;
+    if (m_ESPs[modIndex.row()].m_Enabled != enabled) {
+      m_ESPs[modIndex.row()].m_Enabled = enabled;
+      updateDependents(modIndex.row());
+    }
     emit dataChanged(modIndex, modIndex);
 
     refreshLoadOrder();
@@ -926,7 +1069,6 @@ bool PluginList::setData(const QModelIndex &modIndex, const QVariant &value, int
   if (oldState != newState) {
     try {
       m_PluginStateChanged(modName, newState);
-      testMasters();
       emit dataChanged(this->index(0, 0), this->index(m_ESPs.size(), columnCount()));
     } catch (const std::exception &e) {
       qCritical("failed to invoke state changed notification: %s", e.what());
@@ -227,6 +227,14 @@ public:
   virtual int loadOrder(const QString &name) const;
   virtual bool isMaster(const QString &name) const;
   virtual QStringList masters(const QString &name) const;
+
+  /**
+   * @brief retrieve the plugins that list the specified plugin as a master
+   *
+   * @param name name of the plugin. This may also be a master that isn't installed
+   * @return names of the plugins that require it
+   **/
+  QStringList requiredBy(const QString &name) const;
   virtual QString origin(const QString &name) const;
   virtual bool onRefreshed(const std::function<void()> &callback);
   virtual bool onPluginMoved(const std::function<void (const QString &, int, int)> &func);
@@ -293,6 +301,7 @@ private:
     QString m_Description;
     bool m_HasIni;
     std::set<QString> m_Masters;
+    std::map<int, QString> m_MasterIds; // master node id -> master name as listed in the plugin
     mutable std::set<QString> m_MasterUnset;
   };
 
@@ -309,6 +318,22 @@ private:
   void syncLoadOrder();
   void updateIndices();
 
+  /**
+   * @brief determine the load order group (primaries, masters, regular plugins) of a plugin
+   **/
+  static int orderGroup(const ESPInfo &esp);
+
+  /**
+   * @brief compute the plugin order that satisfies all ordering constraints
+   *
+   * Masters are placed before regular plugins, primary plugins before all other masters
+   * and locked plugins are inserted where they receive their locked load order (as far as
+   * the group allows). Unlocked plugins keep their relative order.
+   *
+   * @return plugin indices ordered by their new priority
+   **/
+  std::vector<int> solveLoadOrder() const;
+
   void writePlugins(const QString &fileName, bool writeUnchecked) const;
   void writeLockedOrder(const QString &fileName) const;
 
@@ -317,8 +342,24 @@ private:
   void setPluginPriority(int row, int &newPriority);
   void changePluginPriority(std::vector<int> rows, int newPriority);
 
+  /**
+   * @brief rebuild the master dependency graph after the list of plugins changed
+   **/
+  void buildDependencyGraph();
+  int masterId(const QString &nameLower);
+  bool masterEnabled(int id) const;
+
+  /**
+   * @brief recalculate the missing masters of all plugins
+   **/
   void testMasters();
 
+  /**
+   * @brief update the missing masters of the plugins depending on the specified one after
+   *        its enabled state changed
+   **/
+  void updateDependents(int index);
+
 private:
 
   std::vector<ESPInfo> m_ESPs;
@@ -333,6 +374,11 @@ private:
   std::map<QString, int> m_ESPLoadOrder;
   std::map<QString, int> m_LockedOrder;
 
+  // master dependencies. Node ids of installed plugins are their index in m_ESPs, masters that
+  // aren't installed are assigned ids past the end
+  std::map<QString, int> m_UnknownMasterIds;
+  std::vector<std::vector<int>> m_Dependents;
+
   std::map<QString, AdditionalInfo> m_AdditionalInfo; // maps esp names to boss information
 
   QString m_CurrentProfile;
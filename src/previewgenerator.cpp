@@ -39,14 +39,51 @@ void PreviewGenerator::registerPlugin(MOBase::IPluginPreview *plugin)
   }
 }
 
+void PreviewGenerator::registerDeferred(const QString &fileName, const QStringList &extensions)
+{
+  for (const QString &extension : extensions) {
+    m_DeferredPlugins.insert(std::make_pair(extension, fileName));
+  }
+}
+
+void PreviewGenerator::setDeferredLoader(const std::function<void (const QString &)> &loader)
+{
+  m_DeferredLoader = loader;
+}
+
+void PreviewGenerator::clearDeferred()
+{
+  m_DeferredPlugins.clear();
+}
+
 bool PreviewGenerator::previewSupported(const QString &fileExtension) const
 {
-  return m_PreviewPlugins.find(fileExtension.toLower()) != m_PreviewPlugins.end();
+  QString extension = fileExtension.toLower();
+  return (m_PreviewPlugins.find(extension) != m_PreviewPlugins.end())
+      || (m_DeferredPlugins.find(extension) != m_DeferredPlugins.end());
 }
 
 QWidget *PreviewGenerator::genPreview(const QString &fileName) const
 {
-  auto iter = m_PreviewPlugins.find(QFileInfo(fileName).suffix().toLower());
+  QString extension = QFileInfo(fileName).suffix().toLower();
+  auto iter = m_PreviewPlugins.find(extension);
+  if (iter == m_PreviewPlugins.end()) {
+    auto deferredIter = m_DeferredPlugins.find(extension);
+    if ((deferredIter != m_DeferredPlugins.end()) && m_DeferredLoader) {
+      // first use of a plugin that wasn't loaded at startup. Forget about all its extensions,
+      // the loader registers it like any other plugin
+      QString pluginFile = deferredIter->second;
+      for (auto deferred = m_DeferredPlugins.begin(); deferred != m_DeferredPlugins.end();) {
+        if (deferred->second == pluginFile) {
+          deferred = m_DeferredPlugins.erase(deferred);
+        } else {
+          ++deferred;
+        }
+      }
+      m_DeferredLoader(pluginFile);
+      iter = m_PreviewPlugins.find(extension);
+    }
+  }
   if (iter != m_PreviewPlugins.end()) {
     return iter->second->genFilePreview(fileName, m_MaxSize);
   } else {
@@ -21,6 +21,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #define PREVIEWGENERATOR_H
 
 #include <QString>
+#include <QStringList>
 #include <QWidget>
 #include <map>
 #include <functional>
@@ -33,6 +34,23 @@ public:
 
   void registerPlugin(MOBase::IPluginPreview *plugin);
 
+  /**
+   * @brief register a preview plugin that hasn't been loaded yet
+   * @param fileName file name of the plugin library
+   * @param extensions the file extensions the plugin supports
+   * @note the plugin is loaded through the deferred loader the first time one of these
+   *       extensions is previewed
+   **/
+  void registerDeferred(const QString &fileName, const QStringList &extensions);
+
+  /**
+   * @brief set the function used to load deferred plugins. The function is expected to register
+   *        the loaded plugin through registerPlugin
+   **/
+  void setDeferredLoader(const std::function<void (const QString &)> &loader);
+
+  void clearDeferred();
+
   bool previewSupported(const QString &fileExtension) const;
 
   QWidget *genPreview(const QString &fileName) const;
@@ -45,6 +63,8 @@ private:
 private:
 
   std::map<QString, MOBase::IPluginPreview*> m_PreviewPlugins;
+  mutable std::map<QString, QString> m_DeferredPlugins; // extension -> plugin file name
+  std::function<void (const QString &)> m_DeferredLoader;
 
   QSize m_MaxSize;
 
@@ -46,7 +46,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <stddef.h>                                // for size_t
 #include <string.h>                                // for wcslen
 
-#include <algorithm>                               // for max, min
+#include <algorithm>                               // for max, min, rotate
 #include <exception>                               // for exception
 #include <functional>
 #include <set>                                     // for set
@@ -477,24 +477,95 @@ void Profile::setModPriority(unsigned int index, int &newPriority)
   }
 
   int oldPriority = m_ModStatus.at(index).m_Priority;
+  if (oldPriority < 0) {
+    // not part of the priority sequence
+    return;
+  }
+
+  // rotate the mod into its new slot. Only the mods between the old and new slot change
+  // their priority so there is no need to rebuild the whole index
+  auto sequence = m_ModIndexByPriority.begin();
   if (newPriorityTemp > oldPriority) {
     // priority is higher than the old, so the gap we left is in lower priorities
-    for (int i = oldPriority + 1; i <= newPriorityTemp; ++i) {
-      --m_ModStatus.at(m_ModIndexByPriority.at(i)).m_Priority;
-    }
+    std::rotate(sequence + oldPriority, sequence + oldPriority + 1, sequence + newPriorityTemp + 1);
+    renumberPriorities(oldPriority, newPriorityTemp + 1);
   } else {
-    for (int i = newPriorityTemp; i < oldPriority; ++i) {
-      ++m_ModStatus.at(m_ModIndexByPriority.at(i)).m_Priority;
-    }
+    std::rotate(sequence + newPriorityTemp, sequence + oldPriority, sequence + oldPriority + 1);
+    renumberPriorities(newPriorityTemp, oldPriority + 1);
     ++newPriority;
   }
 
-  m_ModStatus.at(index).m_Priority = newPriorityTemp;
+  m_ModListWriter.write();
+}
+
+
+void Profile::setModsPriority(const std::vector<unsigned int> &indices, int priority)
+{
+  std::vector<bool> selected(m_ModStatus.size(), false);
+  bool anySelected = false;
+  for (unsigned int index : indices) {
+    if ((index < m_ModStatus.size())
+        && (m_ModStatus[index].m_Priority >= 0)
+        && !m_ModStatus[index].m_Overwrite) {
+      selected[index] = true;
+      anySelected = true;
+    }
+  }
+  if (!anySelected) {
+    return;
+  }
+
+  // split the sequence into the moved block and the remaining mods in a single pass,
+  // both keep their relative order. Unassigned slots are pushed to the end
+  std::vector<unsigned int> moved;
+  std::vector<unsigned int> remaining;
+  remaining.reserve(m_ModIndexByPriority.size());
+  size_t insertPos = 0;
+  size_t holes = 0;
+  for (size_t i = 0; i < m_ModIndexByPriority.size(); ++i) {
+    unsigned int index = m_ModIndexByPriority[i];
+    if (index >= m_ModStatus.size()) {
+      ++holes;
+    } else if (selected[index]) {
+      moved.push_back(index);
+    } else {
+      if (static_cast<int>(i) < priority) {
+        ++insertPos;
+      }
+      remaining.push_back(index);
+    }
+  }
+
+  // never place mods below the overwrite
+  while ((insertPos > 0) && m_ModStatus[remaining[insertPos - 1]].m_Overwrite) {
+    --insertPos;
+  }
+
+  remaining.insert(remaining.begin() + insertPos, moved.begin(), moved.end());
+  remaining.resize(remaining.size() + holes, UINT_MAX);
+
+  // only slots whose mod actually changed need to be touched
+  for (size_t i = 0; i < remaining.size(); ++i) {
+    if (m_ModIndexByPriority[i] != remaining[i]) {
+      m_ModIndexByPriority[i] = remaining[i];
+      renumberPriorities(static_cast<int>(i), static_cast<int>(i) + 1);
+    }
+  }
 
-  updateIndices();
   m_ModListWriter.write();
 }
 
+
+void Profile::renumberPriorities(int first, int last)
+{
+  for (int i = first; i < last; ++i) {
+    unsigned int index = m_ModIndexByPriority[i];
+    if (index < m_ModStatus.size()) {
+      m_ModStatus[index].m_Priority = i;
+    }
+  }
+}
+
 Profile *Profile::createPtrFrom(const QString &name, const Profile &reference, MOBase::IPluginGame const *gamePlugin)
 {
   QString profileDirectory = qApp->property("dataPath").toString() + "/" + QString::fromStdWString(AppConfig::profilesPath()) + "/" + name;
@@ -249,6 +249,18 @@ public:
    **/
   void setModPriority(unsigned int index, int &newPriority);
 
+  /**
+   * @brief move several mods as one block
+   *
+   * The mods keep their relative order and are placed in front of the mod that currently
+   * has the specified priority (or at the end if the priority is beyond the last mod).
+   * Only the slots whose mod changes are updated and the modlist is written once.
+   *
+   * @param indices indices of the mods to move
+   * @param priority the priority at which the block is dropped
+   **/
+  void setModsPriority(const std::vector<unsigned int> &indices, int priority);
+
   /**
    * @brief determine if a mod is enabled
    *
@@ -298,6 +310,7 @@ private:
   void initTimer();
 
   void updateIndices();
+  void renumberPriorities(int first, int last);
 
   void copyFilesTo(QString &target) const;
 
@@ -23,6 +23,13 @@
 #include <QIcon>
 #include <QInputDialog>
 
+#include <algorithm>
+#include <limits>
+
+
+/// key in m_groupHash of the items that are not in any group
+static const quint32 ROOT_GROUP = std::numeric_limits<quint32>::max();
+
 /*!
     \class QtGroupingProxy
     \brief The QtGroupingProxy class will group source model rows by adding a new top tree-level.
@@ -55,8 +62,6 @@ QtGroupingProxy::QtGroupingProxy(QAbstractItemModel *model, QModelIndex rootNode
   connect( sourceModel(), SIGNAL(rowsAboutToBeRemoved( const QModelIndex &, int ,int )),
            SLOT(modelRowsAboutToBeRemoved(QModelIndex,int,int)) );
   connect( sourceModel(), SIGNAL(layoutChanged()), SLOT(buildTree()) );
-  connect( sourceModel(), SIGNAL(dataChanged(QModelIndex,QModelIndex)),
-           SLOT(modelDataChanged(QModelIndex,QModelIndex)) );
   connect( sourceModel(), SIGNAL(modelReset()), this, SLOT(resetModel()) );
 
   if( groupedColumn != -1 )
@@ -144,7 +149,8 @@ QtGroupingProxy::belongsTo( const QModelIndex &idx )
 
 /* m_groupHash layout
 *  key : index of the group in m_groupMaps
-*  value : a QList of the original rows in sourceModel() for the children of this group
+*  value : a QList of the original rows in sourceModel() for the children of this group. These
+*          lists are always kept sorted so rows can be found with a binary search
 *
 *  key = -1  contains a QList of the non-grouped indexes
 *
@@ -160,46 +166,60 @@ QtGroupingProxy::buildTree()
   m_groupHash.clear();
   //don't clear the data maps since most of it will probably be needed again.
   m_parentCreateList.clear();
+  rebuildGroupIndex();
 
   int max = sourceModel()->rowCount( m_rootNode );
+  m_sourceKeys.fill( QStringList(), max );
   //qDebug() << QString("building tree with %1 leafs.").arg( max );
-  //WARNING: these have to be added in order because the addToGroups function is optimized for
-  //modelRowsInserted(). Failure to do so will result in wrong data shown in the view at best.
+  //rows are visited in order so they are simply appended to their groups, which leaves every
+  //group list sorted.
   for( int row = 0; row < max; row++ )
   {
     QModelIndex idx = sourceModel()->index( row, m_groupedColumn, m_rootNode );
-    addSourceRow( idx );
+    QList<RowData> groupData = belongsTo( idx );
+    m_sourceKeys[row] = groupKeys( groupData );
+
+    //an empty list here means it's supposed to go in root.
+    if( groupData.isEmpty() )
+      m_groupHash[ROOT_GROUP].append( row );
+
+    //an item can be in multiple groups
+    foreach( const RowData &data, groupData )
+    {
+      quint32 group = data.isEmpty() ? ROOT_GROUP : findOrCreateGroup( data );
+      QList<int> &groupList = m_groupHash[group];
+      if( groupList.isEmpty() || ( groupList.last() != row ) )
+        groupList.append( row );
+    }
   }
   //dumpGroups();
 
   if (m_flags & FLAG_NOSINGLE) {
     // awkward: flatten single-item groups as a post-processing steps.
-
-    int currentKey = 0;
-    quint32 quint32max = std::numeric_limits<quint32>::max();
-    std::vector<int> rmgroups;
-
+    // The remaining groups keep their order so their keys stay in sync with m_groupMaps
+    QList<int> ungrouped = m_groupHash.take(ROOT_GROUP);
     QHash<quint32, QList<int> > temp;
+    QList<RowData> groupMaps;
 
-    for (auto iter = m_groupHash.begin(); iter != m_groupHash.end(); ++iter) {
-      if ((iter.key() == quint32max) ||
-          (iter->count() < 2)) {
-        temp[quint32max].append(iter.value());
-        if (iter.key() != quint32max) {
-          rmgroups.push_back(iter.key());
-        }
+    for (int group = 0; group < m_groupMaps.count(); ++group) {
+      const QList<int> children = m_groupHash.value(group);
+      if (children.count() < 2) {
+        ungrouped.append(children);
       } else {
-        temp[currentKey++] = *iter;
+        temp.insert(groupMaps.count(), children);
+        groupMaps.append(m_groupMaps.at(group));
       }
     }
-    m_groupHash = temp;
 
-    // second loop is necessary because qt containers can't be iterated from end to front
-    // and removing by index from begin to end is ugly
-    std::sort(rmgroups.begin(), rmgroups.end(), [] (int lhs, int rhs) { return rhs < lhs; });
-    for (auto iter = rmgroups.begin(); iter != rmgroups.end(); ++iter) {
-      m_groupMaps.removeAt(*iter);
+    std::sort(ungrouped.begin(), ungrouped.end());
+    ungrouped.erase(std::unique(ungrouped.begin(), ungrouped.end()), ungrouped.end());
+    if (!ungrouped.isEmpty()) {
+      temp.insert(ROOT_GROUP, ungrouped);
     }
+
+    m_groupHash = temp;
+    m_groupMaps = groupMaps;
+    rebuildGroupIndex();
   }
 
   endResetModel();
@@ -220,77 +240,211 @@ QtGroupingProxy::addSourceRow( const QModelIndex &idx )
 
   //an empty list here means it's supposed to go in root.
   if( groupData.isEmpty() )
-  {
     updatedGroups << -1;
-    if( !m_groupHash.keys().contains( std::numeric_limits<quint32>::max() ) )
-      m_groupHash.insert( std::numeric_limits<quint32>::max(), QList<int>() ); //add an empty placeholder
-  }
 
   //an item can be in multiple groups
-  foreach( RowData data, groupData )
+  foreach( const RowData &data, groupData )
   {
-    int updatedGroup = -1;
-    if( !data.isEmpty() )
-    {
-      //            qDebug() << QString("index %1 belongs to group %2").arg( row )
-      //                         .arg( data[0][Qt::DisplayRole].toString() );
+    int updatedGroup = data.isEmpty() ? -1 : findOrCreateGroup( data );
+    if( !updatedGroups.contains( updatedGroup ) )
+      updatedGroups << updatedGroup;
+  }
 
-      foreach( const RowData &cachedData, m_groupMaps )
-      {
-        //when this matches the index belongs to an existing group
-        if( data[0][Qt::DisplayRole] == cachedData[0][Qt::DisplayRole] )
-        {
-          data = cachedData;
-          break;
-        }
-      }
+  //update m_groupHash to the new source-model layout (one row added)
+  shiftSourceRows( idx.row(), 1 );
+  m_sourceKeys.insert( idx.row(), groupKeys( groupData ) );
 
-      updatedGroup = m_groupMaps.indexOf( data );
-      //-1 means not found
-      if( updatedGroup == -1 )
-      {
-        //new groups are added to the end of the existing list
-        m_groupMaps << data;
-        updatedGroup = m_groupMaps.count() - 1;
-      }
+  foreach( int updatedGroup, updatedGroups )
+  {
+    QList<int> &groupList = m_groupHash[static_cast<quint32>( updatedGroup )];
+    groupList.insert( std::lower_bound( groupList.begin(), groupList.end(), idx.row() ), idx.row() );
+  }
 
-      if( !m_groupHash.keys().contains( updatedGroup ) )
-        m_groupHash.insert( updatedGroup, QList<int>() ); //add an empty placeholder
-    }
+  return updatedGroups;
+}
 
-    if( !updatedGroups.contains( updatedGroup ) )
-      updatedGroups << updatedGroup;
+QString
+QtGroupingProxy::groupKey( const RowData &data ) const
+{
+  return data.value( 0 ).value( Qt::DisplayRole ).toString();
+}
+
+QStringList
+QtGroupingProxy::groupKeys( const QList<RowData> &groupData ) const
+{
+  QStringList result;
+  foreach( const RowData &data, groupData )
+  {
+    if( data.isEmpty() )
+      continue;
+    QString key = groupKey( data );
+    if( !result.contains( key ) )
+      result << key;
   }
+  return result;
+}
 
-  //update m_groupHash to the new source-model layout (one row added)
-  QMutableHashIterator<quint32, QList<int> > i( m_groupHash );
-  while( i.hasNext() )
+void
+QtGroupingProxy::rebuildGroupIndex()
+{
+  m_groupIndex.clear();
+  m_groupIndex.reserve( m_groupMaps.count() );
+  for( int group = 0; group < m_groupMaps.count(); ++group )
   {
-    i.next();
-    QList<int> &groupList = i.value();
-    int insertedProxyRow = groupList.count();
-    for( ; insertedProxyRow > 0 ; insertedProxyRow-- )
+    //with duplicate names the first group wins, same as a linear search would
+    QString key = groupKey( m_groupMaps.at( group ) );
+    if( !m_groupIndex.contains( key ) )
+      m_groupIndex.insert( key, group );
+  }
+}
+
+int
+QtGroupingProxy::findOrCreateGroup( const RowData &data )
+{
+  QString key = groupKey( data );
+  QHash<QString, int>::const_iterator iter = m_groupIndex.constFind( key );
+  if( iter != m_groupIndex.constEnd() )
+    return iter.value();
+
+  //new groups are added to the end of the existing list
+  m_groupMaps << data;
+  m_groupIndex.insert( key, m_groupMaps.count() - 1 );
+  return m_groupMaps.count() - 1;
+}
+
+QList<quint32>
+QtGroupingProxy::resolveGroups( const QList<RowData> &groupData )
+{
+  QList<quint32> result;
+  if( groupData.isEmpty() )
+    result << ROOT_GROUP;
+
+  foreach( const RowData &data, groupData )
+  {
+    quint32 group = ROOT_GROUP;
+    if( !data.isEmpty() )
     {
-      int &rowValue = groupList[insertedProxyRow-1];
-      if( idx.row() <= rowValue )
-      {
-        //increment the rows that come after the new row since they moved one place up.
-        rowValue++;
-      }
-      else
+      int existing = m_groupIndex.value( groupKey( data ), -1 );
+      if( existing == -1 )
       {
-        break;
+        existing = m_groupMaps.count();
+        beginInsertRows( QModelIndex(), existing, existing );
+        findOrCreateGroup( data );
+        endInsertRows();
       }
+      group = existing;
     }
+    if( !result.contains( group ) )
+      result << group;
+  }
+  return result;
+}
 
-    if( updatedGroups.contains( i.key() ) )
-    {
-      //the row needs to be added to this group
-      groupList.insert( insertedProxyRow, idx.row() );
-    }
+void
+QtGroupingProxy::shiftSourceRows( int first, int delta )
+{
+  QMutableHashIterator<quint32, QList<int> > iter( m_groupHash );
+  while( iter.hasNext() )
+  {
+    iter.next();
+    QList<int> &groupList = iter.value();
+    //the lists are sorted so only the tail has to be touched
+    int pos = std::lower_bound( groupList.begin(), groupList.end(), first ) - groupList.begin();
+    for( ; pos < groupList.count(); ++pos )
+      groupList[pos] += delta;
   }
+}
 
-  return updatedGroups;
+int
+QtGroupingProxy::positionInGroup( quint32 group, int sourceRow ) const
+{
+  QHash<quint32, QList<int> >::const_iterator iter = m_groupHash.constFind( group );
+  if( iter == m_groupHash.constEnd() )
+    return -1;
+
+  QList<int>::const_iterator pos = std::lower_bound( iter->constBegin(), iter->constEnd(), sourceRow );
+  if( ( pos == iter->constEnd() ) || ( *pos != sourceRow ) )
+    return -1;
+  return pos - iter->constBegin();
+}
+
+QModelIndex
+QtGroupingProxy::groupParent( quint32 group ) const
+{
+  return group == ROOT_GROUP ? QModelIndex() : index( group, 0, QModelIndex() );
+}
+
+int
+QtGroupingProxy::proxyRow( quint32 group, int position ) const
+{
+  //non-grouped items are placed below the groups
+  return group == ROOT_GROUP ? m_groupMaps.count() + position : position;
+}
+
+void
+QtGroupingProxy::insertIntoGroup( quint32 group, int sourceRow )
+{
+  QList<int> &groupList = m_groupHash[group];
+  int position = std::lower_bound( groupList.begin(), groupList.end(), sourceRow ) - groupList.begin();
+  int row = proxyRow( group, position );
+
+  beginInsertRows( groupParent( group ), row, row );
+  m_groupHash[group].insert( position, sourceRow );
+  endInsertRows();
+}
+
+bool
+QtGroupingProxy::regroupSourceRow( int sourceRow )
+{
+  if( sourceRow >= m_sourceKeys.count() )
+    return false;
+
+  QModelIndex idx = sourceModel()->index( sourceRow, m_groupedColumn, m_rootNode );
+  QList<RowData> groupData = belongsTo( idx );
+  QStringList keys = groupKeys( groupData );
+  const QStringList &oldKeys = m_sourceKeys.at( sourceRow );
+  if( keys == oldKeys )
+    return true;
+
+  //only a move from one group to another can be done in place. Without FLAG_NOSINGLE, that is,
+  //since the size of the groups decides there which ones exist in the first place
+  if( ( m_flags & FLAG_NOSINGLE ) || ( keys.count() > 1 ) || ( oldKeys.count() > 1 ) )
+    return false;
+
+  quint32 oldGroup = ROOT_GROUP;
+  if( !oldKeys.isEmpty() )
+  {
+    int group = m_groupIndex.value( oldKeys.first(), -1 );
+    if( group == -1 )
+      return false;
+    oldGroup = group;
+  }
+  int oldPosition = positionInGroup( oldGroup, sourceRow );
+  if( oldPosition == -1 )
+    return false;
+
+  quint32 newGroup = ROOT_GROUP;
+  foreach( const RowData &data, groupData )
+  {
+    if( !data.isEmpty() )
+      newGroup = resolveGroups( QList<RowData>() << data ).first();
+  }
+
+  if( newGroup != oldGroup )
+  {
+    const QList<int> &newList = m_groupHash[newGroup];
+    int newPosition = std::lower_bound( newList.begin(), newList.end(), sourceRow ) - newList.begin();
+
+    if( !beginMoveRows( groupParent( oldGroup ), proxyRow( oldGroup, oldPosition ), proxyRow( oldGroup, oldPosition ),
+                        groupParent( newGroup ), proxyRow( newGroup, newPosition ) ) )
+      return false;
+    m_groupHash[oldGroup].removeAt( oldPosition );
+    m_groupHash[newGroup].insert( newPosition, sourceRow );
+    endMoveRows();
+  }
+
+  m_sourceKeys[sourceRow] = keys;
+  return true;
 }
 
 /** Each ModelIndex has in it's internalId a position in the parentCreateList.
@@ -591,6 +745,8 @@ QtGroupingProxy::setData( const QModelIndex &idx, const QVariant &value, int rol
 
     //and make sure it's stored in the map
     m_groupMaps[idx.row()].insert( idx.column(), columnData );
+    if( idx.column() == 0 )
+      rebuildGroupIndex();
 
     int columnToChange = idx.column() ? idx.column() : m_groupedColumn;
     foreach( int originalRow, m_groupHash.value( idx.row() ) )
@@ -686,33 +842,34 @@ QtGroupingProxy::mapFromSource( const QModelIndex &idx ) const
   else
   {
     //idx is an item in the top level of the source model (child of the rootnode)
-    int groupRow = -1;
-    QHashIterator<quint32, QList<int> > iterator( m_groupHash );
-    while( iterator.hasNext() )
+    //look in the group it was sorted into last, the group keys are indexed
+    quint32 group = ROOT_GROUP;
+    int position = -1;
+    if( sourceRow < m_sourceKeys.count() )
     {
-      iterator.next();
-      if( iterator.value().contains( sourceRow ) )
-      {
-        groupRow = iterator.key();
-        break;
-      }
+      const QStringList &keys = m_sourceKeys.at( sourceRow );
+      //groups flattened by FLAG_NOSINGLE aren't indexed, their items are in the root
+      if( !keys.isEmpty() )
+        group = static_cast<quint32>( m_groupIndex.value( keys.first(), -1 ) );
+      position = positionInGroup( group, sourceRow );
     }
 
-    if( groupRow != -1 ) //it's in a group, let's find the correct row.
-    {
-      proxyParent = this->index( groupRow, 0, QModelIndex() );
-      proxyRow = m_groupHash.value( groupRow ).indexOf( sourceRow );
-    }
-    else
+    if( position == -1 )
     {
-      proxyParent = QModelIndex();
-      // if the proxy item is not in a group it will be below the groups.
-      int groupLength = m_groupMaps.count();
-      //qDebug() << "groupNames length: " << groupLength;
-      int i = m_groupHash.value( std::numeric_limits<quint32>::max() ).indexOf( sourceRow );
-      //qDebug() << "index in hash: " << i;
-      proxyRow = groupLength + i;
+      //not where it's supposed to be, search all groups
+      QHashIterator<quint32, QList<int> > iterator( m_groupHash );
+      while( ( position == -1 ) && iterator.hasNext() )
+      {
+        iterator.next();
+        group = iterator.key();
+        position = positionInGroup( group, sourceRow );
+      }
+      if( position == -1 )
+        return QModelIndex();
     }
+
+    proxyParent = groupParent( group );
+    proxyRow = this->proxyRow( group, position );
   }
 
   //qDebug() << "proxyParent: " << proxyParent;
@@ -835,6 +992,8 @@ QtGroupingProxy::addEmptyGroup( const RowData &data )
   int newRow = m_groupMaps.count();
   beginInsertRows( QModelIndex(), newRow, newRow );
   m_groupMaps << data;
+  if( !m_groupIndex.contains( groupKey( data ) ) )
+    m_groupIndex.insert( groupKey( data ), newRow );
   endInsertRows();
   return index( newRow, 0, QModelIndex() );
 }
@@ -845,6 +1004,7 @@ QtGroupingProxy::removeGroup( const QModelIndex &idx )
   beginRemoveRows( idx.parent(), idx.row(), idx.row() );
   m_groupHash.remove( idx.row() );
   m_groupMaps.removeAt( idx.row() );
+  rebuildGroupIndex();
   m_parentCreateList.removeAt( idx.internalId() );
   endRemoveRows();
 
@@ -904,10 +1064,34 @@ QtGroupingProxy::modelRowsInserted( const QModelIndex &parent, int start, int en
 {
   if( parent == m_rootNode )
   {
-    //top level of the model changed, these new rows need to be put in groups
+    if( m_flags & FLAG_NOSINGLE )
+    {
+      //a key without a group may belong to an item that was flattened into the root, the two
+      //of them form a new group then. That's left to buildTree()
+      for( int modelRow = start; modelRow <= end; modelRow++ )
+      {
+        QList<RowData> groupData = belongsTo( sourceModel()->index( modelRow, m_groupedColumn, m_rootNode ) );
+        foreach( const QString &key, groupKeys( groupData ) )
+        {
+          if( !m_groupIndex.contains( key ) )
+          {
+            buildTree();
+            return;
+          }
+        }
+      }
+    }
+
+    //top level of the model changed, these new rows need to be put in groups.
+    //Moving the existing rows down doesn't change their position inside the proxy.
+    shiftSourceRows( start, end - start + 1 );
+    m_sourceKeys.insert( start, end - start + 1, QStringList() );
     for( int modelRow = start; modelRow <= end ; modelRow++ )
     {
-      addSourceRow( sourceModel()->index( modelRow, m_groupedColumn, m_rootNode ) );
+      QList<RowData> groupData = belongsTo( sourceModel()->index( modelRow, m_groupedColumn, m_rootNode ) );
+      m_sourceKeys[modelRow] = groupKeys( groupData );
+      foreach( quint32 group, resolveGroups( groupData ) )
+        insertIntoGroup( group, modelRow );
     }
   }
   else
@@ -925,27 +1109,24 @@ QtGroupingProxy::modelRowsAboutToBeRemoved( const QModelIndex &parent, int start
 {
   if( parent == m_rootNode )
   {
-    QHash<quint32, QList<int> >::const_iterator i;
-    //HACK, we are going to call beginRemoveRows() multiple times without
-    // endRemoveRows() if a source index is in multiple groups.
-    // This can be a problem for some views/proxies, but Q*Views can handle it.
-    // TODO: investigate a queue for applying proxy model changes in the correct order
-    for( i = m_groupHash.constBegin(); i != m_groupHash.constEnd(); ++i )
+    //the group lists are sorted so the removed rows form one continuous block in each of them
+    QMutableHashIterator<quint32, QList<int> > iter( m_groupHash );
+    while( iter.hasNext() )
     {
-      int groupIndex = i.key();
-      const QList<int> &groupList = i.value();
-      QModelIndex proxyParent = index( groupIndex, 0 );
-      foreach( int originalRow, groupList )
-      {
-        if( originalRow >= start && originalRow <= end )
-        {
-          int proxyRow = groupList.indexOf( originalRow );
-          if( groupIndex == -1 ) //adjust for non-grouped (root level) original items
-            proxyRow += m_groupMaps.count();
-          //TODO: optimize for continues original rows in the same group
-          beginRemoveRows( proxyParent, proxyRow, proxyRow );
-        }
-      }
+      iter.next();
+      const QList<int> &groupList = iter.value();
+      QList<int>::const_iterator first = std::lower_bound( groupList.constBegin(), groupList.constEnd(), start );
+      QList<int>::const_iterator last = std::upper_bound( first, groupList.constEnd(), end );
+      if( first == last )
+        continue;
+
+      int position = first - groupList.constBegin();
+      int count = last - first;
+      beginRemoveRows( groupParent( iter.key() ), proxyRow( iter.key(), position ),
+                       proxyRow( iter.key(), position + count - 1 ) );
+      QList<int> &modifiable = iter.value();
+      modifiable.erase( modifiable.begin() + position, modifiable.begin() + position + count );
+      endRemoveRows();
     }
   }
   else
@@ -963,41 +1144,24 @@ QtGroupingProxy::modelRowsRemoved( const QModelIndex &parent, int start, int end
 {
   if( parent == m_rootNode )
   {
-    //TODO: can be optimised by iterating over m_groupHash and checking start <= r < end
+    //the rows themselves were taken out of the groups in modelRowsAboutToBeRemoved(), now
+    //decrement all source rows that are after the removed ones
+    shiftSourceRows( end + 1, start - end - 1 );
+    m_sourceKeys.remove( start, end - start + 1 );
 
-    //rather than increasing i we change the stored sourceRows in-place and reuse argument start
-    //X-times (where X = end - start).
-    for( int i = start; i <= end; i++ )
+    if( m_flags & FLAG_NOSINGLE )
     {
-      //HACK: we are going to iterate the hash in reverse so calls to endRemoveRows()
-      // are matched up with the beginRemoveRows() in modelRowsAboutToBeRemoved()
-      //NOTE: easier to do reverse with java style iterator
-      QMutableHashIterator<quint32, QList<int> > iter( m_groupHash );
-      iter.toBack();
-      while( iter.hasPrevious() )
+      //groups left with less than two members have to be flattened
+      for( QHash<quint32, QList<int> >::const_iterator iter = m_groupHash.constBegin();
+           iter != m_groupHash.constEnd(); ++iter )
       {
-        iter.previous();
-        int groupIndex = iter.key();
-        //has to be a modifiable reference for remove and replace operations
-        QList<int> &groupList = iter.value();
-        int rowIndex = groupList.indexOf( start );
-        if( rowIndex != -1 )
+        if( ( iter.key() != ROOT_GROUP ) && ( iter->count() < 2 ) )
         {
-          QModelIndex proxyParent = index( groupIndex, 0 );
-          groupList.removeAt( rowIndex );
-        }
-        //Now decrement all source rows that are after the removed row
-        for( int j = 0; j < groupList.count(); j++ )
-        {
-          int sourceRow = groupList.at( j );
-          if( sourceRow > start )
-            groupList.replace( j, sourceRow-1 );
+          buildTree();
+          break;
         }
-        if( rowIndex != -1)
-          endRemoveRows(); //end remove operation only after group was updated.
       }
     }
-
     return;
   }
 
@@ -1014,20 +1178,57 @@ QtGroupingProxy::resetModel()
 void
 QtGroupingProxy::modelDataChanged( const QModelIndex &topLeft, const QModelIndex &bottomRight )
 {
-  //TODO: need to look in the groupedColumn and see if it changed and changed grouping accordingly
-  QModelIndex proxyTopLeft = mapFromSource( topLeft );
-  if( !proxyTopLeft.isValid() )
+  if( !topLeft.isValid() || !bottomRight.isValid() )
     return;
 
-  if( topLeft == bottomRight )
+  if( topLeft.parent() != m_rootNode )
   {
-    emit dataChanged( proxyTopLeft, proxyTopLeft );
+    //children of an original item, these don't change their parent
+    emit dataChanged( mapFromSource( topLeft ), mapFromSource( bottomRight ) );
+    return;
   }
-  else
+
+  if( ( topLeft.column() <= m_groupedColumn ) && ( m_groupedColumn <= bottomRight.column() ) )
   {
-    QModelIndex proxyBottomRight = mapFromSource( bottomRight );
-    emit dataChanged( proxyTopLeft, proxyBottomRight );
+    //the grouped column changed so rows may have to go to a different group
+    for( int row = topLeft.row(); row <= bottomRight.row(); ++row )
+    {
+      if( !regroupSourceRow( row ) )
+      {
+        //the change can't be applied in place
+        buildTree();
+        return;
+      }
+    }
   }
+
+  //consecutive source rows may end up in different groups so the range has to be split
+  //into one range per proxy parent
+  QModelIndex rangeParent;
+  int rangeStart = -1;
+  int rangeEnd = -1;
+  for( int row = topLeft.row(); row <= bottomRight.row(); ++row )
+  {
+    QModelIndex proxyIndex = mapFromSource( sourceModel()->index( row, topLeft.column(), m_rootNode ) );
+    if( !proxyIndex.isValid() )
+      continue;
+
+    if( ( rangeStart != -1 ) && ( proxyIndex.parent() == rangeParent ) && ( proxyIndex.row() == rangeEnd + 1 ) )
+    {
+      rangeEnd = proxyIndex.row();
+      continue;
+    }
+
+    if( rangeStart != -1 )
+      emit dataChanged( index( rangeStart, topLeft.column(), rangeParent ),
+                        index( rangeEnd, bottomRight.column(), rangeParent ) );
+    rangeParent = proxyIndex.parent();
+    rangeStart = rangeEnd = proxyIndex.row();
+  }
+
+  if( rangeStart != -1 )
+    emit dataChanged( index( rangeStart, topLeft.column(), rangeParent ),
+                      index( rangeEnd, bottomRight.column(), rangeParent ) );
 }
 
 bool
@@ -25,6 +25,7 @@
 #include <QStringList>
 #include <QIcon>
 #include <QSet>
+#include <QVector>
 
 typedef QMap<int, QVariant> ItemData;
 typedef QMap<int, ItemData> RowData;
@@ -122,6 +123,34 @@ protected:
           */
   QList<int> addSourceRow( const QModelIndex &idx );
 
+  /** @returns the key by which groups with the same data are recognised */
+  QString groupKey( const RowData &data ) const;
+  QStringList groupKeys( const QList<RowData> &groupData ) const;
+
+  /** @returns index of the group with the same key as data. A new group is added if necessary,
+          * without notifying views
+          */
+  int findOrCreateGroup( const RowData &data );
+
+  /** Maps belongsTo() data to keys in m_groupHash, inserting missing groups with the
+          * proper notifications.
+          */
+  QList<quint32> resolveGroups( const QList<RowData> &groupData );
+
+  /** moves a source row into a different group if its group data changed.
+          * @returns false if this can't be done in place and the tree needs to be rebuilt
+          */
+  bool regroupSourceRow( int sourceRow );
+
+  void insertIntoGroup( quint32 group, int sourceRow );
+  void rebuildGroupIndex();
+  /** adds delta to all source rows >= first */
+  void shiftSourceRows( int first, int delta );
+  /** @returns position of sourceRow within a group or -1 if it's not a member */
+  int positionInGroup( quint32 group, int sourceRow ) const;
+  QModelIndex groupParent( quint32 group ) const;
+  int proxyRow( quint32 group, int position ) const;
+
   bool isGroup( const QModelIndex &index ) const;
   bool isAGroupSelected( const QModelIndexList &list ) const;
 
@@ -135,6 +164,12 @@ protected:
           * This can be pre-loaded with data in belongsTo()
           */
   QList<RowData> m_groupMaps;
+  /** Group key -> index in m_groupMaps, so rows don't have to be compared to every group */
+  QHash<QString, int> m_groupIndex;
+  /** The group keys of each top level source row when it was last grouped. Used to
+          * detect changes to the grouping and to find the group of a row without a search.
+          */
+  QVector<QStringList> m_sourceKeys;
 
   /** "instuctions" how to create an item in the tree.
           * This is used by parent( QModelIndex )
@@ -0,0 +1,344 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "responsecache.h"
+#include <QDir>
+#include <QFile>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QRunnable>
+
+
+static const char INDEX_FILE[] = "index.dat";
+static const quint32 INDEX_VERSION = 1;
+
+
+class ResponseLoader : public QRunnable {
+
+public:
+
+  ResponseLoader(ResponseCache *cache, const QList<QPair<QString, QString> > &files)
+    : m_Cache(cache)
+    , m_Files(files)
+  {
+  }
+
+  virtual void run() override
+  {
+    for (const auto &file : m_Files) {
+      QVariant value;
+      QFile input(file.second);
+      if (input.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&input);
+        stream >> value;
+        if (stream.status() != QDataStream::Ok) {
+          value = QVariant();
+        }
+      }
+      m_Cache->loaded(file.first, value, input.size());
+    }
+  }
+
+private:
+
+  ResponseCache *m_Cache;
+  QList<QPair<QString, QString> > m_Files;
+
+};
+
+
+ResponseCache::ResponseCache(const QString &directory, qint64 maxSize, qint64 maxMemory)
+  : m_Directory(directory)
+  , m_MaxSize(maxSize)
+  , m_MaxMemory(maxMemory)
+  , m_Size(0)
+  , m_Dirty(false)
+  , m_MemorySize(0)
+{
+  m_FlushTimer.setSingleShot(true);
+  m_FlushTimer.setInterval(FLUSH_DELAY);
+  QObject::connect(&m_FlushTimer, &QTimer::timeout, [this] () { flush(); });
+  m_Pool.setMaxThreadCount(1);
+  QDir().mkpath(m_Directory);
+  load();
+}
+
+
+ResponseCache::~ResponseCache()
+{
+  m_Pool.clear();
+  m_Pool.waitForDone();
+  flush();
+}
+
+
+QString ResponseCache::filePath(const QString &fileName) const
+{
+  return m_Directory + "/" + fileName;
+}
+
+
+void ResponseCache::load()
+{
+  QFile indexFile(filePath(INDEX_FILE));
+  if (indexFile.open(QIODevice::ReadOnly)) {
+    QDataStream stream(&indexFile);
+    quint32 version = 0;
+    stream >> version;
+    if (version == INDEX_VERSION) {
+      QDateTime now = QDateTime::currentDateTimeUtc();
+      while (!stream.atEnd() && (stream.status() == QDataStream::Ok)) {
+        Entry entry;
+        stream >> entry.key >> entry.fileName >> entry.expires >> entry.staleUntil >> entry.size;
+        if ((stream.status() != QDataStream::Ok) || m_Index.contains(entry.key)) {
+          break;
+        }
+        if ((entry.staleUntil < now) || !QFile::exists(filePath(entry.fileName))) {
+          // outdated entries are cleaned up below
+          continue;
+        }
+        m_Entries.push_back(entry);
+        m_Index.insert(entry.key, std::prev(m_Entries.end()));
+        m_Size += entry.size;
+      }
+    }
+    indexFile.close();
+  }
+
+  // remove everything the index doesn't know about (anymore)
+  QSet<QString> known;
+  for (const Entry &entry : m_Entries) {
+    known.insert(entry.fileName);
+  }
+  QDir cacheDir(m_Directory);
+  for (const QString &fileName : cacheDir.entryList(QStringList("*.cache"), QDir::Files)) {
+    if (!known.contains(fileName)) {
+      cacheDir.remove(fileName);
+      m_Dirty = true;
+    }
+  }
+
+  evict();
+  if (m_Dirty) {
+    scheduleFlush();
+  }
+
+  // read the responses themselves in the background, most recently used first
+  QList<QPair<QString, QString> > files;
+  for (const Entry &entry : m_Entries) {
+    files.append(qMakePair(entry.key, filePath(entry.fileName)));
+    m_Pending.insert(entry.key);
+  }
+  if (!files.isEmpty()) {
+    m_Pool.start(new ResponseLoader(this, files));
+  }
+}
+
+
+void ResponseCache::loaded(const QString &key, const QVariant &value, qint64 size)
+{
+  QMutexLocker lock(&m_Mutex);
+  // the entry may have been replaced or dropped in the meantime. Files are read most recently
+  // used first so once memory is full the rest is left on disc
+  if (m_Pending.remove(key) && value.isValid() && (m_MemorySize + size <= m_MaxMemory)) {
+    m_Values.insert(key, qMakePair(value, size));
+    m_MemorySize += size;
+  }
+}
+
+
+void ResponseCache::reload(const Entry &entry)
+{
+  {
+    QMutexLocker lock(&m_Mutex);
+    if (m_Pending.contains(entry.key)) {
+      return;
+    }
+    m_Pending.insert(entry.key);
+  }
+  QList<QPair<QString, QString> > files;
+  files.append(qMakePair(entry.key, filePath(entry.fileName)));
+  m_Pool.start(new ResponseLoader(this, files));
+}
+
+
+void ResponseCache::trimValues()
+{
+  QMutexLocker lock(&m_Mutex);
+  // drop values of the least recently used entries, they stay on disc
+  for (auto iter = m_Entries.rbegin(); (iter != m_Entries.rend()) && (m_MemorySize > m_MaxMemory); ++iter) {
+    auto valueIter = m_Values.find(iter->key);
+    if (valueIter != m_Values.end()) {
+      m_MemorySize -= valueIter->second;
+      m_Values.erase(valueIter);
+    }
+  }
+}
+
+
+void ResponseCache::scheduleFlush()
+{
+  m_Dirty = true;
+  if (!m_FlushTimer.isActive()) {
+    m_FlushTimer.start();
+  }
+}
+
+
+void ResponseCache::flush()
+{
+  m_FlushTimer.stop();
+  if (!m_Dirty) {
+    return;
+  }
+
+  QFile indexFile(filePath(INDEX_FILE));
+  if (!indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    qWarning("failed to write %s", qPrintable(indexFile.fileName()));
+    return;
+  }
+  QDataStream stream(&indexFile);
+  stream << INDEX_VERSION;
+  for (const Entry &entry : m_Entries) {
+    stream << entry.key << entry.fileName << entry.expires << entry.staleUntil << entry.size;
+  }
+  m_Dirty = false;
+}
+
+
+ResponseCache::Freshness ResponseCache::lookup(const QString &key, QVariant &value)
+{
+  auto indexIter = m_Index.find(key);
+  if (indexIter == m_Index.end()) {
+    return MISS;
+  }
+
+  EntryList::iterator iter = *indexIter;
+  QDateTime now = QDateTime::currentDateTimeUtc();
+  if (iter->staleUntil < now) {
+    removeEntry(iter);
+    scheduleFlush();
+    return MISS;
+  }
+
+  bool found = false;
+  {
+    QMutexLocker lock(&m_Mutex);
+    auto valueIter = m_Values.find(key);
+    if (valueIter != m_Values.end()) {
+      value = valueIter->first;
+      found = true;
+    }
+  }
+  if (!found) {
+    // not in memory (yet). Read it in the background for the next time, the caller gets a
+    // fresh response which replaces the entry anyway
+    reload(*iter);
+    return MISS;
+  }
+
+  // move to front of the lru list. splice keeps iterators valid
+  m_Entries.splice(m_Entries.begin(), m_Entries, iter);
+  m_Dirty = true;
+
+  return iter->expires < now ? STALE : FRESH;
+}
+
+
+void ResponseCache::insert(const QString &key, const QVariant &value, int ttl, int staleWindow)
+{
+  auto indexIter = m_Index.find(key);
+  if (indexIter != m_Index.end()) {
+    removeEntry(*indexIter);
+  }
+
+  Entry entry;
+  entry.key = key;
+  entry.fileName = QString::fromLatin1(
+        QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex()) + ".cache";
+  QDateTime now = QDateTime::currentDateTimeUtc();
+  entry.expires = now.addSecs(ttl);
+  entry.staleUntil = entry.expires.addSecs(staleWindow);
+
+  QFile file(filePath(entry.fileName));
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    qWarning("failed to write %s", qPrintable(file.fileName()));
+    scheduleFlush();
+    return;
+  }
+  {
+    QDataStream stream(&file);
+    stream << value;
+  }
+  entry.size = file.size();
+  file.close();
+
+  {
+    QMutexLocker lock(&m_Mutex);
+    m_Pending.remove(key);
+    m_Values.insert(key, qMakePair(value, entry.size));
+    m_MemorySize += entry.size;
+  }
+
+  m_Entries.push_front(entry);
+  m_Index.insert(key, m_Entries.begin());
+  m_Size += entry.size;
+
+  evict();
+  trimValues();
+  scheduleFlush();
+}
+
+
+void ResponseCache::remove(const QString &key)
+{
+  auto indexIter = m_Index.find(key);
+  if (indexIter != m_Index.end()) {
+    removeEntry(*indexIter);
+    scheduleFlush();
+  }
+}
+
+
+void ResponseCache::removeEntry(EntryList::iterator iter)
+{
+  QFile::remove(filePath(iter->fileName));
+  {
+    QMutexLocker lock(&m_Mutex);
+    m_Pending.remove(iter->key);
+    auto valueIter = m_Values.find(iter->key);
+    if (valueIter != m_Values.end()) {
+      m_MemorySize -= valueIter->second;
+      m_Values.erase(valueIter);
+    }
+  }
+  m_Size -= iter->size;
+  m_Index.remove(iter->key);
+  m_Entries.erase(iter);
+  m_Dirty = true;
+}
+
+
+void ResponseCache::evict()
+{
+  while ((m_Size > m_MaxSize) && !m_Entries.empty()) {
+    removeEntry(std::prev(m_Entries.end()));
+  }
+}
@@ -0,0 +1,148 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef RESPONSECACHE_H
+#define RESPONSECACHE_H
+
+
+#include <QString>
+#include <QVariant>
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QThreadPool>
+#include <QTimer>
+#include <iterator>
+#include <list>
+
+
+/**
+ * @brief persistent cache of parsed api responses
+ * Entries are stored as individual files in the cache directory, an index file keeps
+ * track of lifetimes and use order. Each entry has a time to live after which it is
+ * considered stale. Stale entries can still be used while a fresh copy is requested in
+ * the background, after the stale period they are dropped.
+ * The total size on disk is limited, least recently used entries are evicted first.
+ * Responses are served from memory, which has a limit of its own. Values that aren't in
+ * memory (from previous sessions or dropped to stay within the limit) are read in the
+ * background and count as missing until they are loaded.
+ * The index is written with a delay so a burst of changes only writes it once
+ */
+class ResponseCache {
+
+public:
+
+  enum Freshness {
+    MISS,
+    FRESH,
+    STALE
+  };
+
+public:
+
+  /**
+   * @param directory directory to store the cache in. Will be created if necessary
+   * @param maxSize maximum size (in bytes) of the cache on disk
+   * @param maxMemory maximum size (in bytes, as serialized) of the values kept in memory
+   */
+  ResponseCache(const QString &directory, qint64 maxSize, qint64 maxMemory);
+
+  ~ResponseCache();
+
+  /**
+   * @brief look up a cached response
+   * @param key key identifying the request
+   * @param value receives the cached value if the result isn't MISS
+   * @return freshness of the cached value
+   */
+  Freshness lookup(const QString &key, QVariant &value);
+
+  /**
+   * @brief add or replace a cached response
+   * @param key key identifying the request
+   * @param value the response to store
+   * @param ttl time (in seconds) the value is considered fresh
+   * @param staleWindow time (in seconds) after expiration the value may still be used
+   */
+  void insert(const QString &key, const QVariant &value, int ttl, int staleWindow);
+
+  /**
+   * @brief drop a cached response, i.e. because the server-side state was changed by us
+   */
+  void remove(const QString &key);
+
+  /**
+   * @brief write the index to disc now if anything changed since it was last written
+   */
+  void flush();
+
+private:
+
+  friend class ResponseLoader;
+
+  static const int FLUSH_DELAY = 5000;
+
+  struct Entry {
+    QString key;
+    QString fileName;
+    QDateTime expires;
+    QDateTime staleUntil;
+    qint64 size;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+private:
+
+  void load();
+  void evict();
+  void removeEntry(EntryList::iterator iter);
+  void scheduleFlush();
+  void reload(const Entry &entry);
+  void trimValues();
+  void loaded(const QString &key, const QVariant &value, qint64 size);
+  QString filePath(const QString &fileName) const;
+
+private:
+
+  QString m_Directory;
+  qint64 m_MaxSize;
+  qint64 m_MaxMemory;
+  qint64 m_Size;
+  bool m_Dirty;
+  QTimer m_FlushTimer;
+
+  // most recently used at the front
+  EntryList m_Entries;
+  QHash<QString, EntryList::iterator> m_Index;
+
+  // values are shared with the loader thread, everything else is only used on the main thread
+  QMutex m_Mutex;
+  QHash<QString, QPair<QVariant, qint64> > m_Values;
+  qint64 m_MemorySize;
+  // keys of entries whose value is being read
+  QSet<QString> m_Pending;
+  QThreadPool m_Pool;
+
+};
+
+
+#endif // RESPONSECACHE_H
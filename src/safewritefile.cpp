@@ -19,15 +19,71 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 
 #include "safewritefile.h"
+#include <runtimemetrics.h>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QStringList>
-#include <QCryptographicHash>
+
+#include <Windows.h>
+#include <io.h>
 
 
 using namespace MOBase;
 
 
+namespace {
+
+/**
+ * @brief what was last committed to a file in this session
+ */
+struct CommittedFile {
+  QByteArray hash;
+  qint64 size;
+  QDateTime modified;
+};
+
+QMutex s_CommittedMutex;
+QHash<QString, CommittedFile> s_Committed;
+
+QString committedKey(const QString &fileName)
+{
+  return QDir::cleanPath(QFileInfo(fileName).absoluteFilePath()).toLower();
+}
+
+}
+
+
+SafeWriteFile::HashingFile::HashingFile(const QString &templateName)
+  : QTemporaryFile(templateName)
+  , m_Hash(QCryptographicHash::Md5)
+{
+}
+
+
+QByteArray SafeWriteFile::HashingFile::hash() const
+{
+  return m_Hash.result();
+}
+
+
+qint64 SafeWriteFile::HashingFile::writeData(const char *data, qint64 len)
+{
+  qint64 written = QTemporaryFile::writeData(data, len);
+  if (written > 0) {
+    m_Hash.addData(data, static_cast<int>(written));
+  }
+  return written;
+}
+
+
 SafeWriteFile::SafeWriteFile(const QString &fileName)
 : m_FileName(fileName)
+// same directory as the target so the rename can't turn into a copy across volumes
+, m_TempFile(fileName + ".XXXXXX")
 {
   if (!m_TempFile.open()) {
     throw MyException(QObject::tr("failed to open temporary file"));
@@ -41,31 +97,60 @@ QFile *SafeWriteFile::operator->() {
 }
 
 
-void SafeWriteFile::commit() {
-  shellDeleteQuiet(m_FileName);
-  m_TempFile.rename(m_FileName);
+bool SafeWriteFile::commit() {
+  // make sure the data is on disk before the target gets replaced, otherwise a crash could
+  // leave behind a target with no content
+  m_TempFile.flush();
+  ::FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(m_TempFile.handle())));
+
+  QString tempName = m_TempFile.fileName();
   m_TempFile.setAutoRemove(false);
   m_TempFile.close();
+
+  if (!::MoveFileExW(ToWString(QDir::toNativeSeparators(tempName)).c_str(),
+                     ToWString(QDir::toNativeSeparators(m_FileName)).c_str(),
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+    qCritical("failed to replace %s: %s", qPrintable(m_FileName),
+              qPrintable(windowsErrorString(::GetLastError())));
+    QFile::remove(tempName);
+    return false;
+  }
+
+  QFileInfo target(m_FileName);
+  CommittedFile committed = { m_TempFile.hash(), target.size(), target.lastModified() };
+  QMutexLocker lock(&s_CommittedMutex);
+  s_Committed[committedKey(m_FileName)] = committed;
+  return true;
 }
 
 bool SafeWriteFile::commitIfDifferent(QByteArray &inHash) {
-  QByteArray newHash = hash();
-  if (newHash != inHash
-      || !QFile::exists(m_FileName)) {
-    commit();
+  QByteArray newHash = m_TempFile.hash();
+
+  QFileInfo target(m_FileName);
+  if (!target.exists()) {
+    inHash.clear();
+  } else if (inHash.isEmpty()) {
+    QMutexLocker lock(&s_CommittedMutex);
+    auto iter = s_Committed.find(committedKey(m_FileName));
+    // only trust the hash if nobody else touched the file since
+    if ((iter != s_Committed.end())
+        && (iter->size == target.size())
+        && (iter->modified == target.lastModified())) {
+      inHash = iter->hash;
+    }
+  }
+
+  if (newHash != inHash) {
+    if (!commit()) {
+      return false;
+    }
+    static MOShared::MetricCounter &s_Written = MOShared::RuntimeMetrics::instance().counter("safewritefile.written");
+    s_Written.increment();
     inHash = newHash;
     return true;
   } else {
+    static MOShared::MetricCounter &s_Skipped = MOShared::RuntimeMetrics::instance().counter("safewritefile.skipped");
+    s_Skipped.increment();
     return false;
   }
 }
-
-QByteArray SafeWriteFile::hash()
-{
-
-  qint64 pos = m_TempFile.pos();
-  m_TempFile.seek(0);
-  QByteArray data = m_TempFile.readAll();
-  m_TempFile.seek(pos);
-  return QCryptographicHash::hash(data, QCryptographicHash::Md5);
-}
@@ -23,11 +23,17 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 
 #include <utility.h>
+#include <QCryptographicHash>
 #include <QTemporaryFile>
 #include <QString>
 
 /**
  * @brief a wrapper for QFile that ensures the file is only actually (over-)written if writing was successful
+ *
+ * Everything written is hashed on the way so comparing against the previous content doesn't require
+ * reading the file again. The data is written to a temporary file next to the target which then
+ * replaces the target in a single rename after the data was flushed to disk, so the target is never
+ * left half-written.
  */
 class SafeWriteFile {
 public:
@@ -35,17 +41,40 @@ public:
 
   QFile *operator->();
 
-  void commit();
-
+  /**
+   * @brief replace the target file with what was written
+   * @return true on success
+   */
+  bool commit();
+
+  /**
+   * @brief replace the target file only if the content changed
+   * @param hash hash of the content last written to the target. Updated if the file was written.
+   *             If this is empty, the hash of the last commit to the same path in this session is used
+   * @return true if the file was written
+   */
   bool commitIfDifferent(QByteArray &hash);
 
 private:
 
-  QByteArray hash();
+  /**
+   * @brief temporary file that feeds everything written to it into a hash
+   */
+  class HashingFile : public QTemporaryFile {
+  public:
+    HashingFile(const QString &templateName);
+    QByteArray hash() const;
+  protected:
+    virtual qint64 writeData(const char *data, qint64 len) override;
+  private:
+    QCryptographicHash m_Hash;
+  };
 
 private:
+
   QString m_FileName;
-  QTemporaryFile m_TempFile;
+  HashingFile m_TempFile;
+
 };
 
 
@@ -0,0 +1,332 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "savegamecatalogue.h"
+
+#include "settings.h"
+#include "isavegame.h"
+#include "savegameinfo.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRunnable>
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+
+
+using MOBase::ISaveGame;
+
+
+static const char CACHE_FILE[] = "savegames.dat";
+static const quint32 CACHE_VERSION = 1;
+
+
+class SaveGameParser : public QRunnable
+{
+public:
+  SaveGameParser(SaveGameCatalogue *catalogue, const SaveGameCatalogue::Entry &entry, const SaveGameInfo *info)
+    : m_Catalogue(catalogue), m_Entry(entry), m_Info(info) {}
+
+  virtual void run()
+  {
+    QString group = m_Entry.path;
+    QStringList files(m_Entry.path);
+    try {
+      std::unique_ptr<ISaveGame const> save(m_Info->getSaveGameInfo(m_Entry.path));
+      if (save.get() != nullptr) {
+        group = save->getSaveGroupIdentifier();
+        files = save->allFiles();
+      }
+    } catch (const std::exception &e) {
+      qWarning("failed to parse %s: %s", qPrintable(m_Entry.path), e.what());
+    }
+    m_Catalogue->parsed(m_Entry.path, m_Entry.size, m_Entry.modified, group, files);
+    m_Catalogue->finished(SaveGameCatalogue::key(m_Entry.path));
+  }
+
+private:
+  SaveGameCatalogue *m_Catalogue;
+  SaveGameCatalogue::Entry m_Entry;
+  const SaveGameInfo *m_Info;
+};
+
+
+SaveGameCatalogue::SaveGameCatalogue()
+  : m_Loaded(false)
+  , m_Dirty(false)
+  , m_ShutDown(false)
+{
+  m_FlushTimer.setSingleShot(true);
+  m_FlushTimer.setInterval(FLUSH_DELAY);
+  connect(&m_FlushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+  connect(this, SIGNAL(saveParsed(QString)), this, SLOT(scheduleFlush()));
+}
+
+
+SaveGameCatalogue::~SaveGameCatalogue()
+{
+  shutdown();
+}
+
+
+void SaveGameCatalogue::shutdown()
+{
+  {
+    QMutexLocker lock(&m_Mutex);
+    m_ShutDown = true;
+  }
+  // jobs that haven't started are dropped, the others still reference the game plugin
+  m_Pool.clear();
+  m_Pool.waitForDone();
+  {
+    QMutexLocker lock(&m_Mutex);
+    m_InFlight.clear();
+    m_ParseFinished.wakeAll();
+  }
+  flush();
+}
+
+
+SaveGameCatalogue *SaveGameCatalogue::instance()
+{
+  static SaveGameCatalogue s_Instance;
+  return &s_Instance;
+}
+
+
+QString SaveGameCatalogue::key(const QString &path)
+{
+  return QDir::cleanPath(QDir::fromNativeSeparators(path)).toLower();
+}
+
+
+void SaveGameCatalogue::load()
+{
+  // called with the mutex held
+  m_Loaded = true;
+
+  // remember the location so the cache can still be written during shutdown
+  m_CacheFile = Settings::instance().getCacheDirectory() + "/" + CACHE_FILE;
+  QFile file(m_CacheFile);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  QDataStream stream(&file);
+  quint32 version = 0;
+  stream >> version;
+  if (version != CACHE_VERSION) {
+    return;
+  }
+
+  while (!stream.atEnd() && (stream.status() == QDataStream::Ok)) {
+    Entry entry;
+    stream >> entry.path >> entry.size >> entry.modified >> entry.group >> entry.files;
+    if (stream.status() != QDataStream::Ok) {
+      break;
+    }
+    entry.parsed = true;
+    m_Entries.insert(key(entry.path), entry);
+  }
+}
+
+
+void SaveGameCatalogue::flush()
+{
+  QMutexLocker lock(&m_Mutex);
+  if (!m_Dirty || m_CacheFile.isEmpty()) {
+    return;
+  }
+
+  QDir().mkpath(QFileInfo(m_CacheFile).absolutePath());
+  QFile file(m_CacheFile);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    qWarning("failed to write %s", qPrintable(file.fileName()));
+    return;
+  }
+
+  QDataStream stream(&file);
+  stream << CACHE_VERSION;
+  for (const Entry &entry : m_Entries) {
+    if (entry.parsed) {
+      stream << entry.path << entry.size << entry.modified << entry.group << entry.files;
+    }
+  }
+  m_Dirty = false;
+}
+
+
+void SaveGameCatalogue::scheduleFlush()
+{
+  m_FlushTimer.start();
+}
+
+
+void SaveGameCatalogue::schedule(const Entry &entry, const SaveGameInfo *info)
+{
+  // called with the mutex held
+  ++m_InFlight[key(entry.path)];
+  m_Pool.start(new SaveGameParser(this, entry, info));
+}
+
+
+void SaveGameCatalogue::finished(const QString &pathKey)
+{
+  QMutexLocker lock(&m_Mutex);
+  auto iter = m_InFlight.find(pathKey);
+  if ((iter != m_InFlight.end()) && (--iter.value() <= 0)) {
+    m_InFlight.erase(iter);
+  }
+  m_ParseFinished.wakeAll();
+}
+
+
+void SaveGameCatalogue::parsed(const QString &path, qint64 size, const QDateTime &modified,
+                               const QString &group, const QStringList &files)
+{
+  {
+    QMutexLocker lock(&m_Mutex);
+    auto iter = m_Entries.find(key(path));
+    // the save may have been replaced while it was being parsed
+    if ((iter == m_Entries.end()) || (iter->size != size) || (iter->modified != modified)) {
+      return;
+    }
+    iter->group = group;
+    iter->files = files;
+    iter->parsed = true;
+    m_Dirty = true;
+  }
+  emit saveParsed(path);
+}
+
+
+QList<SaveGameCatalogue::Entry> SaveGameCatalogue::saves(const QString &directory, const QString &extension,
+                                                         const SaveGameInfo *info, bool wait)
+{
+  QDir dir(directory);
+  QFileInfoList files = dir.entryInfoList(QStringList() << QString("*.%1").arg(extension),
+                                          QDir::Files, QDir::Unsorted);
+
+  QList<Entry> result;
+  QSet<QString> present;
+  {
+    QMutexLocker lock(&m_Mutex);
+    if (!m_Loaded) {
+      load();
+    }
+
+    for (const QFileInfo &file : files) {
+      QString path = file.absoluteFilePath();
+      QString pathKey = key(path);
+      present.insert(pathKey);
+
+      auto iter = m_Entries.find(pathKey);
+      if ((iter == m_Entries.end())
+          || (iter->size != file.size())
+          || (iter->modified != file.lastModified())) {
+        Entry entry;
+        entry.path = path;
+        entry.size = file.size();
+        entry.modified = file.lastModified();
+        entry.parsed = false;
+        iter = m_Entries.insert(pathKey, entry);
+      }
+      // this includes entries listed earlier without a SaveGameInfo
+      if (!iter->parsed && (info != nullptr) && !m_ShutDown && !m_InFlight.contains(pathKey)) {
+        schedule(*iter, info);
+      }
+      result.append(*iter);
+    }
+
+    // forget about saves that disappeared since the last listing of this directory
+    QString directoryKey = key(dir.absolutePath());
+    for (const QString &removed : m_Directories.value(directoryKey) - present) {
+      m_Entries.remove(removed);
+      m_Dirty = true;
+    }
+    m_Directories[directoryKey] = present;
+
+    if (wait) {
+      for (;;) {
+        // wait for the parses of these saves, no matter who started them
+        bool pending = false;
+        for (const Entry &entry : result) {
+          if (m_InFlight.contains(key(entry.path))) {
+            pending = true;
+            break;
+          }
+        }
+        if (!pending) {
+          break;
+        }
+        m_ParseFinished.wait(&m_Mutex);
+      }
+      for (Entry &entry : result) {
+        entry = m_Entries.value(key(entry.path), entry);
+      }
+    }
+  }
+
+  std::sort(result.begin(), result.end(), [] (const Entry &lhs, const Entry &rhs) {
+    return lhs.modified > rhs.modified;
+  });
+  return result;
+}
+
+
+QStringList SaveGameCatalogue::allFiles(const QString &path, const SaveGameInfo *info)
+{
+  {
+    QMutexLocker lock(&m_Mutex);
+    if (!m_Loaded) {
+      load();
+    }
+    QFileInfo file(path);
+    auto iter = m_Entries.find(key(path));
+    if ((iter != m_Entries.end()) && iter->parsed
+        && (iter->size == file.size()) && (iter->modified == file.lastModified())) {
+      return iter->files;
+    }
+  }
+
+  if (info == nullptr) {
+    return QStringList(path);
+  }
+
+  QFileInfo file(path);
+  Entry entry;
+  entry.path = file.absoluteFilePath();
+  entry.size = file.size();
+  entry.modified = file.lastModified();
+  entry.parsed = false;
+  {
+    QMutexLocker lock(&m_Mutex);
+    m_Entries.insert(key(entry.path), entry);
+    ++m_InFlight[key(entry.path)];
+  }
+  SaveGameParser(this, entry, info).run();
+
+  QMutexLocker lock(&m_Mutex);
+  return m_Entries.value(key(entry.path), entry).files;
+}
@@ -0,0 +1,152 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SAVEGAMECATALOGUE_H
+#define SAVEGAMECATALOGUE_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QWaitCondition>
+
+class SaveGameInfo;
+
+
+/**
+ * @brief cache of the information about savegames that's expensive to determine
+ *
+ * Saves are identified by path, size and modification time. Headers of new or changed
+ * saves are parsed on a pool of worker threads, everything else is served from memory or
+ * from a cache file that persists between sessions.
+ */
+class SaveGameCatalogue : public QObject
+{
+
+  Q_OBJECT
+
+public:
+
+  struct Entry {
+    QString path;
+    qint64 size;
+    QDateTime modified;
+    /// true once the remaining fields have been read from the save
+    bool parsed;
+    /// usually identifies the character the save belongs to
+    QString group;
+    /// all files that make up the save, including the save itself
+    QStringList files;
+  };
+
+public:
+
+  static SaveGameCatalogue *instance();
+
+  ~SaveGameCatalogue();
+
+  /**
+   * @brief list the saves in a directory
+   *
+   * @param directory the directory to list
+   * @param extension extension of save games (without the dot)
+   * @param info used to parse saves that aren't in the catalogue yet. If this is nullptr,
+   *             nothing gets parsed
+   * @param wait if true, don't return until all saves are parsed, including parses that
+   *             were started by earlier calls. Otherwise entries that haven't been parsed
+   *             are returned as such and saveParsed is emitted once they are
+   * @return the saves, newest first
+   */
+  QList<Entry> saves(const QString &directory, const QString &extension,
+                     const SaveGameInfo *info, bool wait = false);
+
+  /**
+   * @brief determine all files belonging to a save
+   * @note this parses the save in the calling thread if necessary
+   */
+  QStringList allFiles(const QString &path, const SaveGameInfo *info);
+
+  /**
+   * @brief write the cache file if there were changes
+   */
+  void flush();
+
+  /**
+   * @brief cancel pending parses, wait for running ones and write the cache file
+   * @note this has to be called before the game plugins are unloaded since the parses use
+   *       them. Nothing gets parsed afterwards
+   */
+  void shutdown();
+
+signals:
+
+  /**
+   * @brief emitted (from a worker thread) after a save was parsed
+   */
+  void saveParsed(const QString &path);
+
+private slots:
+
+  void scheduleFlush();
+
+private:
+
+  friend class SaveGameParser;
+
+  SaveGameCatalogue();
+
+  static QString key(const QString &path);
+
+  void load();
+  void schedule(const Entry &entry, const SaveGameInfo *info);
+  void finished(const QString &pathKey);
+  void parsed(const QString &path, qint64 size, const QDateTime &modified,
+              const QString &group, const QStringList &files);
+
+private:
+
+  static const int FLUSH_DELAY = 2000;
+
+private:
+
+  mutable QMutex m_Mutex;
+  QHash<QString, Entry> m_Entries;
+  // keys of the saves that were found in each directory during the last listing
+  QHash<QString, QSet<QString>> m_Directories;
+  QString m_CacheFile;
+  bool m_Loaded;
+  bool m_Dirty;
+  bool m_ShutDown;
+
+  // number of parses started for each key that haven't finished yet
+  QHash<QString, int> m_InFlight;
+  QWaitCondition m_ParseFinished;
+
+  QThreadPool m_Pool;
+  QTimer m_FlushTimer;
+
+};
+
+#endif // SAVEGAMECATALOGUE_H
@@ -77,20 +77,33 @@ static const unsigned char Key2[20] = { 0x99, 0xb8, 0x76, 0x42, 0x3e, 0xc1, 0x60
 
 Settings *Settings::s_Instance = nullptr;
 
+// weight of the most recent download in the average server speed
+static const double SERVER_SPEED_WEIGHT = 0.3;
+
+// time to wait for more download statistics before writing them
+static const int SAVE_SERVERS_DELAY = 10000;
+
 
 Settings::Settings(const QSettings &settingsSource)
   : m_Settings(settingsSource.fileName(), settingsSource.format())
+  , m_ServersLoaded(false)
+  , m_ServersChanged(false)
 {
   if (s_Instance != nullptr) {
     throw std::runtime_error("second instance of \"Settings\" created");
   } else {
     s_Instance = this;
   }
+
+  m_SaveServersTimer.setSingleShot(true);
+  m_SaveServersTimer.setInterval(SAVE_SERVERS_DELAY);
+  connect(&m_SaveServersTimer, SIGNAL(timeout()), this, SLOT(saveServers()));
 }
 
 
 Settings::~Settings()
 {
+  saveServers();
   s_Instance = nullptr;
 }
 
@@ -199,37 +212,104 @@ QString Settings::getSteamAppID() const
   return m_Settings.value("Settings/app_id", m_GamePlugin->steamAPPId()).toString();
 }
 
-void Settings::setDownloadSpeed(const QString &serverName, int bytesPerSecond)
+void Settings::loadServers()
 {
-  m_Settings.beginGroup("Servers");
+  if (m_ServersLoaded) {
+    return;
+  }
 
+  m_Servers.clear();
+  m_Settings.beginGroup("Servers");
   foreach (const QString &serverKey, m_Settings.childKeys()) {
     QVariantMap data = m_Settings.value(serverKey).toMap();
-    if (serverKey == serverName) {
-      data["downloadCount"] = data["downloadCount"].toInt() + 1;
-      data["downloadSpeed"] = data["downloadSpeed"].toDouble() + static_cast<double>(bytesPerSecond);
-      m_Settings.setValue(serverKey, data);
-    }
+    ServerStatistics &server = m_Servers[serverKey];
+    server.premium = data["premium"].toBool();
+    server.preferred = data["preferred"].toInt();
+    server.lastSeen = data["lastSeen"].toDate();
+    server.downloadCount = data["downloadCount"].toInt();
+    // stored as the sum of all speeds for compatibility with older versions
+    server.averageSpeed = server.downloadCount > 0 ? data["downloadSpeed"].toDouble() / server.downloadCount
+                                                   : 0.0;
+  }
+  m_Settings.endGroup();
+
+  m_ServersLoaded = true;
+  m_ServersChanged = false;
+}
+
+void Settings::saveServers()
+{
+  m_SaveServersTimer.stop();
+  if (!m_ServersChanged) {
+    return;
   }
 
+  m_Settings.beginGroup("Servers");
+  m_Settings.remove("");
+  for (auto iter = m_Servers.begin(); iter != m_Servers.end(); ++iter) {
+    const ServerStatistics &server = iter->second;
+    QVariantMap data;
+    data["premium"] = server.premium;
+    data["preferred"] = server.preferred;
+    data["lastSeen"] = server.lastSeen;
+    data["downloadCount"] = server.downloadCount;
+    data["downloadSpeed"] = server.averageSpeed * server.downloadCount;
+    m_Settings.setValue(iter->first, data);
+  }
   m_Settings.endGroup();
   m_Settings.sync();
+
+  m_ServersChanged = false;
+}
+
+void Settings::setDownloadSpeed(const QString &serverName, int bytesPerSecond)
+{
+  loadServers();
+
+  auto iter = m_Servers.find(serverName);
+  if (iter == m_Servers.end()) {
+    return;
+  }
+
+  ServerStatistics &server = iter->second;
+  if (server.downloadCount == 0) {
+    server.averageSpeed = bytesPerSecond;
+  } else {
+    server.averageSpeed = SERVER_SPEED_WEIGHT * bytesPerSecond
+                        + (1.0 - SERVER_SPEED_WEIGHT) * server.averageSpeed;
+  }
+  ++server.downloadCount;
+
+  m_ServersChanged = true;
+  // don't restart a running timer, otherwise constant downloads would delay the write forever
+  if (!m_SaveServersTimer.isActive()) {
+    m_SaveServersTimer.start();
+  }
 }
 
 std::map<QString, int> Settings::getPreferredServers()
 {
-  std::map<QString, int> result;
-  m_Settings.beginGroup("Servers");
+  loadServers();
 
-  foreach (const QString &serverKey, m_Settings.childKeys()) {
-    QVariantMap data = m_Settings.value(serverKey).toMap();
-    int preference = data["preferred"].toInt();
-    if (preference > 0) {
-      result[serverKey] = preference;
+  std::map<QString, int> result;
+  for (auto iter = m_Servers.begin(); iter != m_Servers.end(); ++iter) {
+    if (iter->second.preferred > 0) {
+      result[iter->first] = iter->second.preferred;
     }
   }
-  m_Settings.endGroup();
+  return result;
+}
+
+std::map<QString, int> Settings::getServerSpeeds()
+{
+  loadServers();
 
+  std::map<QString, int> result;
+  for (auto iter = m_Servers.begin(); iter != m_Servers.end(); ++iter) {
+    if (iter->second.downloadCount > 0) {
+      result[iter->first] = static_cast<int>(iter->second.averageSpeed);
+    }
+  }
   return result;
 }
 
@@ -355,6 +435,11 @@ bool Settings::displayForeign() const
   return m_Settings.value("Settings/display_foreign", true).toBool();
 }
 
+int Settings::directoryCacheSize() const
+{
+  return m_Settings.value("Settings/directory_cache_size", 256).toInt();
+}
+
 void Settings::setMotDHash(uint hash)
 {
   m_Settings.setValue("motd_hash", hash);
@@ -428,43 +513,39 @@ QString Settings::language()
 
 void Settings::updateServers(const QList<ServerInfo> &servers)
 {
-  m_Settings.beginGroup("Servers");
-  QStringList oldServerKeys = m_Settings.childKeys();
+  loadServers();
 
   foreach (const ServerInfo &server, servers) {
-    if (!oldServerKeys.contains(server.name)) {
+    auto iter = m_Servers.find(server.name);
+    if (iter == m_Servers.end()) {
       // not yet known server
-      QVariantMap newVal;
-      newVal["premium"] = server.premium;
-      newVal["preferred"] = server.preferred ? 1 : 0;
-      newVal["lastSeen"] = server.lastSeen;
-      newVal["downloadCount"] = 0;
-      newVal["downloadSpeed"] = 0.0;
-
-      m_Settings.setValue(server.name, newVal);
+      ServerStatistics newVal;
+      newVal.premium = server.premium;
+      newVal.preferred = server.preferred ? 1 : 0;
+      newVal.lastSeen = server.lastSeen;
+      newVal.downloadCount = 0;
+      newVal.averageSpeed = 0.0;
+
+      m_Servers[server.name] = newVal;
     } else {
-      QVariantMap data = m_Settings.value(server.name).toMap();
-      data["lastSeen"] = server.lastSeen;
-      data["premium"] = server.premium;
-
-      m_Settings.setValue(server.name, data);
+      iter->second.lastSeen = server.lastSeen;
+      iter->second.premium = server.premium;
     }
   }
 
   // clean up unavailable servers
   QDate now = QDate::currentDate();
-  foreach (const QString &key, m_Settings.childKeys()) {
-    QVariantMap val = m_Settings.value(key).toMap();
-    QDate lastSeen = val["lastSeen"].toDate();
-    if (lastSeen.daysTo(now) > 30) {
-      qDebug("removing server %s since it hasn't been available for downloads in over a month", qPrintable(key));
-      m_Settings.remove(key);
+  for (auto iter = m_Servers.begin(); iter != m_Servers.end();) {
+    if (iter->second.lastSeen.daysTo(now) > 30) {
+      qDebug("removing server %s since it hasn't been available for downloads in over a month", qPrintable(iter->first));
+      iter = m_Servers.erase(iter);
+    } else {
+      ++iter;
     }
   }
 
-  m_Settings.endGroup();
-
-  m_Settings.sync();
+  m_ServersChanged = true;
+  saveServers();
 }
 
 void Settings::addBlacklistPlugin(const QString &fileName)
@@ -550,6 +631,9 @@ void Settings::query(QWidget *parent)
 
   connect(&dialog, SIGNAL(resetDialogs()), this, SLOT(resetDialogs()));
 
+  // the dialog reads and writes the server list directly
+  saveServers();
+
   std::vector<std::unique_ptr<SettingsTab>> tabs;
 
   tabs.push_back(std::unique_ptr<SettingsTab>(new GeneralTab(this, dialog)));
@@ -563,6 +647,11 @@ void Settings::query(QWidget *parent)
     for (std::unique_ptr<SettingsTab> const &tab: tabs) {
       tab->update();
     }
+
+    // take over the preferences from the dialog but keep statistics gathered in the meantime
+    for (auto iter = m_Servers.begin(); iter != m_Servers.end(); ++iter) {
+      iter->second.preferred = m_Settings.value("Servers/" + iter->first).toMap()["preferred"].toInt();
+    }
   }
 }
 
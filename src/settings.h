@@ -22,12 +22,14 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "loadmechanism.h"
 
+#include <QDate>
 #include <QList>
 #include <QMap>
 #include <QObject>
 #include <QSet>
 #include <QSettings>
 #include <QString>
+#include <QTimer>
 #include <QVariant>
 
 #include <QtGlobal> //for uint
@@ -108,6 +110,8 @@ public:
    * @brief register download speed
    * @param url complete download url
    * @param bytesPerSecond download size in bytes per second
+   * @note this only updates the in-memory statistics, they are written to the ini file a
+   *       few seconds later
    */
   void setDownloadSpeed(const QString &serverName, int bytesPerSecond);
 
@@ -129,6 +133,11 @@ public:
    */
   std::map<QString, int> getPreferredServers();
 
+  /**
+   * @return average download speed (bytes per second) for each server we downloaded from
+   */
+  std::map<QString, int> getServerSpeeds();
+
   /**
    * retrieve the directory where mods are stored (with native separators)
    **/
@@ -223,6 +232,12 @@ public:
    */
   bool displayForeign() const;
 
+  /**
+   * @return memory (in megabytes) that may be used to keep the directory structures of
+   *         recently used profiles
+   */
+  int directoryCacheSize() const;
+
   /**
    * @brief sets the new motd hash
    **/
@@ -315,9 +330,21 @@ public slots:
 
   void managedGameChanged(MOBase::IPluginGame const *gamePlugin);
 
+private:
+
+  struct ServerStatistics {
+    bool premium;
+    int preferred;
+    QDate lastSeen;
+    int downloadCount;
+    double averageSpeed; ///< exponentially weighted, in bytes per second
+  };
+
 private:
 
   static QString obfuscate(const QString &password);
+
+  void loadServers();
   static QString deObfuscate(const QString &password);
 
   void addLanguages(QComboBox *languageBox);
@@ -425,6 +452,11 @@ private slots:
 
   void resetDialogs();
 
+  /**
+   * @brief write the server statistics to the ini file if they changed
+   */
+  void saveServers();
+
 signals:
 
   void languageChanged(const QString &newLanguage);
@@ -447,6 +479,12 @@ private:
 
   QSet<QString> m_PluginBlacklist;
 
+  // cached content of the Servers group. Read on first use
+  std::map<QString, ServerStatistics> m_Servers;
+  bool m_ServersLoaded;
+  bool m_ServersChanged;
+  QTimer m_SaveServersTimer;
+
 };
 
 #endif // WORKAROUNDS_H
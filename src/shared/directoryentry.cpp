@@ -21,6 +21,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "windows_error.h"
 #include "leaktrace.h"
 #include "error_report.h"
+#include "runtimemetrics.h"
 #include <bsatk.h>
 #include <boost/bind.hpp>
 #include <boost/scoped_array.hpp>
@@ -362,18 +363,18 @@ bool FileEntry::recurseParents(std::wstring &path, const DirectoryEntry *parent)
 
 std::wstring FileEntry::getFullPath() const
 {
-  std::wstring result;
+  // the origin path is not cached since it changes when the mod is renamed
   bool ignore = false;
-  result = m_Parent->getOriginByID(getOrigin(ignore)).getPath(); //base directory for origin
-  recurseParents(result, m_Parent); // all intermediate directories
-  return result + L"\\" + m_Name;
+  return m_Parent->getOriginByID(getOrigin(ignore)).getPath() + getRelativePath();
 }
 
-std::wstring FileEntry::getRelativePath() const
+const std::wstring &FileEntry::getRelativePath() const
 {
-  std::wstring result;
-  recurseParents(result, m_Parent); // all intermediate directories
-  return result + L"\\" + m_Name;
+  if (m_RelativePath.empty()) {
+    recurseParents(m_RelativePath, m_Parent); // all intermediate directories
+    m_RelativePath.append(L"\\").append(m_Name);
+  }
+  return m_RelativePath;
 }
 
 
@@ -732,44 +733,53 @@ std::vector<FileEntry::Ptr> DirectoryEntry::getFiles() const
 
 const FileEntry::Ptr DirectoryEntry::searchFile(const std::wstring &path, const DirectoryEntry **directory) const
 {
+  static MetricHistogram &s_Latency = RuntimeMetrics::instance().histogram("directory.searchFile");
+  ScopedLatency latency(s_Latency);
+
   if (directory != nullptr) {
     *directory = nullptr;
+  } else if (m_Parent == nullptr) {
+    // the path is relative to the data directory so the index can answer this directly
+    return m_FileRegister->findByPath(path);
   }
 
-  if ((path.length() == 0) || (path == L"*")) {
-    // no file name -> the path ended on a (back-)slash
-    if (directory != nullptr) {
-      *directory = this;
+  // walk down one path component at a time
+  const DirectoryEntry *current = this;
+  size_t offset = 0;
+  for (;;) {
+    if ((offset >= path.length()) || (path.compare(offset, std::wstring::npos, L"*") == 0)) {
+      // no file name -> the path ended on a (back-)slash
+      if (directory != nullptr) {
+        *directory = current;
+      }
+      return FileEntry::Ptr();
     }
-    return FileEntry::Ptr();
-  }
-
-  size_t len =  path.find_first_of(L"\\/");
 
-  if (len == std::string::npos) {
-    // no more path components
-    auto iter = m_Files.find(ToLower(path));
-    if (iter != m_Files.end()) {
-      return m_FileRegister->getFile(iter->second);
-    } else if (directory != nullptr) {
-      DirectoryEntry *temp = findSubDirectory(path);
-      if (temp != nullptr) {
-        *directory = temp;
+    size_t end = path.find_first_of(L"\\/", offset);
+
+    if (end == std::string::npos) {
+      // no more path components
+      std::wstring name = path.substr(offset);
+      auto iter = current->m_Files.find(ToLower(name));
+      if (iter != current->m_Files.end()) {
+        return m_FileRegister->getFile(iter->second);
+      } else if (directory != nullptr) {
+        DirectoryEntry *temp = current->findSubDirectory(name);
+        if (temp != nullptr) {
+          *directory = temp;
+        }
       }
-    }
-  } else {
-    // file is in in a subdirectory, recurse into the matching subdirectory
-    std::wstring pathComponent = path.substr(0, len);
-    DirectoryEntry *temp = findSubDirectory(pathComponent);
-    if (temp != nullptr) {
-      if (len >= path.size()) {
-        log("unexpected end of path");
+      return FileEntry::Ptr();
+    } else {
+      // file is in in a subdirectory, continue in the matching subdirectory
+      DirectoryEntry *temp = current->findSubDirectory(path.substr(offset, end - offset));
+      if (temp == nullptr) {
         return FileEntry::Ptr();
       }
-      return temp->searchFile(path.substr(len + 1), directory);
+      current = temp;
+      offset = end + 1;
     }
   }
-  return FileEntry::Ptr();
 }
 
 
@@ -840,7 +850,8 @@ DirectoryEntry *DirectoryEntry::getSubDirectoryRecursive(const std::wstring &pat
 
 
 FileRegister::FileRegister(boost::shared_ptr<OriginConnection> originConnection)
-  : m_OriginConnection(originConnection)
+  : m_PathIndexValid(false)
+  , m_OriginConnection(originConnection)
 {
   LEAK_TRACE;
 }
@@ -866,8 +877,57 @@ bool FileRegister::indexValid(FileEntry::Index index) const
 FileEntry::Ptr FileRegister::createFile(const std::wstring &name, DirectoryEntry *parent)
 {
   FileEntry::Index index = generateIndex();
-  m_Files[index] = FileEntry::Ptr(new FileEntry(index, name, parent));
-  return m_Files[index];
+  FileEntry::Ptr result(new FileEntry(index, name, parent));
+  m_Files[index] = result;
+  if (m_PathIndexValid) {
+    indexFile(result);
+  }
+  return result;
+}
+
+
+static std::wstring pathKey(const std::wstring &relativePath)
+{
+  // relative paths start with a backslash, lookups don't
+  return ToLower(relativePath.substr(1));
+}
+
+
+void FileRegister::indexFile(const FileEntry::Ptr &file)
+{
+  m_PathIndex[pathKey(file->getRelativePath())] = file->getIndex();
+}
+
+
+void FileRegister::unindexFile(const FileEntry::Ptr &file)
+{
+  if (m_PathIndexValid) {
+    auto iter = m_PathIndex.find(pathKey(file->getRelativePath()));
+    if ((iter != m_PathIndex.end()) && (iter->second == file->getIndex())) {
+      m_PathIndex.erase(iter);
+    }
+  }
+}
+
+
+FileEntry::Ptr FileRegister::findByPath(const std::wstring &path)
+{
+  if (!m_PathIndexValid) {
+    m_PathIndex.reserve(m_Files.size());
+    for (auto iter = m_Files.begin(); iter != m_Files.end(); ++iter) {
+      indexFile(iter->second);
+    }
+    m_PathIndexValid = true;
+  }
+
+  std::wstring key = ToLower(path);
+  std::replace(key.begin(), key.end(), L'/', L'\\');
+  auto iter = m_PathIndex.find(key);
+  if (iter != m_PathIndex.end()) {
+    return getFile(iter->second);
+  } else {
+    return FileEntry::Ptr();
+  }
 }
 
 
@@ -883,6 +943,8 @@ FileEntry::Ptr FileRegister::getFile(FileEntry::Index index) const
 
 void FileRegister::unregisterFile(FileEntry::Ptr file)
 {
+  unindexFile(file);
+
   bool ignore;
   // unregister from origin
   int originID = file->getOrigin(ignore);
@@ -934,6 +996,7 @@ void FileRegister::removeOriginMulti(std::set<FileEntry::Index> indices, int ori
         && (pos->second->lastAccessed() < notAfter)
         && pos->second->removeOrigin(originID)) {
       removedFiles.push_back(pos->second);
+      unindexFile(pos->second);
       m_Files.erase(pos);
       ++iter;
     } else {
@@ -25,6 +25,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <set>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <cassert>
 #define WIN32_MEAN_AND_LEAN
 #include <Windows.h>
@@ -80,7 +81,8 @@ public:
   const std::wstring &getArchive() const { return m_Archive; }
   bool isFromArchive() const { return m_Archive.length() != 0; }
   std::wstring getFullPath() const;
-  std::wstring getRelativePath() const;
+  /// path relative to the data directory, starting with a backslash. Built on first use
+  const std::wstring &getRelativePath() const;
   DirectoryEntry *getParent() { return m_Parent; }
 
   void setFileTime(FILETIME fileTime) const { m_FileTime = fileTime; }
@@ -101,6 +103,8 @@ private:
   std::vector<int> m_Alternatives;
   DirectoryEntry *m_Parent;
   mutable FILETIME m_FileTime;
+  // name and parent never change so this stays valid for the lifetime of the entry
+  mutable std::wstring m_RelativePath;
 
   time_t m_LastAccessed;
 
@@ -179,6 +183,14 @@ public:
 
   size_t size() const { return m_Files.size(); }
 
+  /**
+   * @brief look up a file by its path relative to the data directory
+   * @param path the path. Case and the type of separators don't matter
+   * @return the file or an empty pointer if there is no file at that path
+   * @note the index is built on the first call and kept up to date afterwards
+   */
+  FileEntry::Ptr findByPath(const std::wstring &path);
+
   bool removeFile(FileEntry::Index index);
   void removeOrigin(FileEntry::Index index, int originID);
   void removeOriginMulti(std::set<FileEntry::Index> indices, int originID, time_t notAfter);
@@ -191,10 +203,17 @@ private:
 
   void unregisterFile(FileEntry::Ptr file);
 
+  void indexFile(const FileEntry::Ptr &file);
+  void unindexFile(const FileEntry::Ptr &file);
+
 private:
 
   std::map<FileEntry::Index, FileEntry::Ptr> m_Files;
 
+  // case-folded relative path (without leading backslash) -> file
+  std::unordered_map<std::wstring, FileEntry::Index> m_PathIndex;
+  bool m_PathIndexValid;
+
   boost::shared_ptr<OriginConnection> m_OriginConnection;
 
 };
@@ -251,7 +270,8 @@ public:
   const FileEntry::Ptr findFile(const std::wstring &name) const;
 
   /** search through this directory and all subdirectories for a file by the specified name (relative path).
-      if directory is not nullptr, the referenced variable will be set to the path containing the file */
+      if directory is not nullptr, the referenced variable will be set to the path containing the file.
+      on the top-level directory this is a single hash lookup unless directory is requested */
   const FileEntry::Ptr searchFile(const std::wstring &path, const DirectoryEntry **directory) const;
 
   void insertFile(const std::wstring &filePath, FilesOrigin &origin, FILETIME fileTime);
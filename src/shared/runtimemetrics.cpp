@@ -0,0 +1,200 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "runtimemetrics.h"
+
+#include <sstream>
+
+namespace MOShared {
+
+
+// 1-2-5 steps from 1us to 10s, the last bucket takes everything above
+static const int64_t BUCKET_LIMITS[MetricHistogram::NUM_BUCKETS - 1] = {
+  1, 2, 5, 10, 20, 50, 100, 200, 500,
+  1000, 2000, 5000, 10000, 20000, 50000,
+  100000, 200000, 500000, 1000000, 2000000, 5000000, 10000000
+};
+
+
+static std::string escapeJSON(const std::string &input)
+{
+  std::string result;
+  for (char ch : input) {
+    if ((ch == '"') || (ch == '\\')) {
+      result.push_back('\\');
+    }
+    result.push_back(ch);
+  }
+  return result;
+}
+
+
+MetricHistogram::MetricHistogram()
+  : m_Count(0)
+  , m_Sum(0)
+{
+  for (int i = 0; i < NUM_BUCKETS; ++i) {
+    m_Buckets[i].store(0);
+  }
+}
+
+
+void MetricHistogram::record(int64_t microseconds)
+{
+  int bucket = 0;
+  while ((bucket < NUM_BUCKETS - 1) && (microseconds > BUCKET_LIMITS[bucket])) {
+    ++bucket;
+  }
+  m_Buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  m_Count.fetch_add(1, std::memory_order_relaxed);
+  m_Sum.fetch_add(microseconds, std::memory_order_relaxed);
+}
+
+
+int64_t MetricHistogram::bucketLimit(int bucket)
+{
+  return bucket < NUM_BUCKETS - 1 ? BUCKET_LIMITS[bucket] : -1;
+}
+
+
+int64_t MetricHistogram::percentile(int percent) const
+{
+  int64_t total = count();
+  if (total == 0) {
+    return 0;
+  }
+  int64_t threshold = (total * percent + 99) / 100;
+  int64_t seen = 0;
+  for (int i = 0; i < NUM_BUCKETS - 1; ++i) {
+    seen += bucketCount(i);
+    if (seen >= threshold) {
+      return BUCKET_LIMITS[i];
+    }
+  }
+  return BUCKET_LIMITS[NUM_BUCKETS - 2];
+}
+
+
+RuntimeMetrics &RuntimeMetrics::instance()
+{
+  static RuntimeMetrics s_Instance;
+  return s_Instance;
+}
+
+
+MetricCounter &RuntimeMetrics::counter(const std::string &name)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  std::unique_ptr<MetricCounter> &result = m_Counters[name];
+  if (result.get() == nullptr) {
+    result.reset(new MetricCounter);
+  }
+  return *result;
+}
+
+
+MetricGauge &RuntimeMetrics::gauge(const std::string &name)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  std::unique_ptr<MetricGauge> &result = m_Gauges[name];
+  if (result.get() == nullptr) {
+    result.reset(new MetricGauge);
+  }
+  return *result;
+}
+
+
+MetricHistogram &RuntimeMetrics::histogram(const std::string &name)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  std::unique_ptr<MetricHistogram> &result = m_Histograms[name];
+  if (result.get() == nullptr) {
+    result.reset(new MetricHistogram);
+  }
+  return *result;
+}
+
+
+std::string RuntimeMetrics::toText() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  std::ostringstream stream;
+
+  stream << "Counters\n";
+  for (auto iter = m_Counters.begin(); iter != m_Counters.end(); ++iter) {
+    stream << "  " << iter->first << ": " << iter->second->value() << "\n";
+  }
+
+  stream << "\nGauges\n";
+  for (auto iter = m_Gauges.begin(); iter != m_Gauges.end(); ++iter) {
+    stream << "  " << iter->first << ": " << iter->second->value() << "\n";
+  }
+
+  stream << "\nLatencies (microseconds)\n";
+  for (auto iter = m_Histograms.begin(); iter != m_Histograms.end(); ++iter) {
+    const MetricHistogram &histogram = *iter->second;
+    int64_t count = histogram.count();
+    stream << "  " << iter->first << ": count " << count;
+    if (count > 0) {
+      stream << ", mean " << histogram.sum() / count
+             << ", p50 <= " << histogram.percentile(50)
+             << ", p90 <= " << histogram.percentile(90)
+             << ", p99 <= " << histogram.percentile(99);
+    }
+    stream << "\n";
+  }
+
+  return stream.str();
+}
+
+
+std::string RuntimeMetrics::toJSON() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  std::ostringstream stream;
+
+  stream << "{\n  \"counters\": {";
+  for (auto iter = m_Counters.begin(); iter != m_Counters.end(); ++iter) {
+    stream << (iter == m_Counters.begin() ? "\n" : ",\n")
+           << "    \"" << escapeJSON(iter->first) << "\": " << iter->second->value();
+  }
+
+  stream << "\n  },\n  \"gauges\": {";
+  for (auto iter = m_Gauges.begin(); iter != m_Gauges.end(); ++iter) {
+    stream << (iter == m_Gauges.begin() ? "\n" : ",\n")
+           << "    \"" << escapeJSON(iter->first) << "\": " << iter->second->value();
+  }
+
+  stream << "\n  },\n  \"histograms\": {";
+  for (auto iter = m_Histograms.begin(); iter != m_Histograms.end(); ++iter) {
+    const MetricHistogram &histogram = *iter->second;
+    stream << (iter == m_Histograms.begin() ? "\n" : ",\n")
+           << "    \"" << escapeJSON(iter->first) << "\": {\"count\": " << histogram.count()
+           << ", \"sum\": " << histogram.sum() << ", \"buckets\": [";
+    for (int i = 0; i < MetricHistogram::NUM_BUCKETS; ++i) {
+      stream << (i == 0 ? "" : ", ") << histogram.bucketCount(i);
+    }
+    stream << "]}";
+  }
+  stream << "\n  }\n}\n";
+
+  return stream.str();
+}
+
+} // namespace MOShared
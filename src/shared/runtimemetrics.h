@@ -0,0 +1,159 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RUNTIMEMETRICS_H
+#define RUNTIMEMETRICS_H
+
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace MOShared {
+
+
+/**
+ * @brief monotonically increasing count of events
+ */
+class MetricCounter {
+public:
+  MetricCounter() : m_Value(0) {}
+  void increment(int64_t amount = 1) { m_Value.fetch_add(amount, std::memory_order_relaxed); }
+  int64_t value() const { return m_Value.load(std::memory_order_relaxed); }
+private:
+  std::atomic<int64_t> m_Value;
+};
+
+
+/**
+ * @brief a value that can go up and down, e.g. a queue length
+ */
+class MetricGauge {
+public:
+  MetricGauge() : m_Value(0) {}
+  void set(int64_t value) { m_Value.store(value, std::memory_order_relaxed); }
+  void add(int64_t amount) { m_Value.fetch_add(amount, std::memory_order_relaxed); }
+  int64_t value() const { return m_Value.load(std::memory_order_relaxed); }
+private:
+  std::atomic<int64_t> m_Value;
+};
+
+
+/**
+ * @brief distribution of latencies in fixed buckets from 1 microsecond to 10 seconds
+ */
+class MetricHistogram {
+public:
+  static const int NUM_BUCKETS = 23;
+
+  MetricHistogram();
+
+  /**
+   * @param microseconds the measured duration
+   */
+  void record(int64_t microseconds);
+
+  int64_t count() const { return m_Count.load(std::memory_order_relaxed); }
+  int64_t sum() const { return m_Sum.load(std::memory_order_relaxed); }
+  int64_t bucketCount(int bucket) const { return m_Buckets[bucket].load(std::memory_order_relaxed); }
+
+  /**
+   * @return upper bound (inclusive) of a bucket in microseconds. -1 for the last bucket, which
+   *         has no bound
+   */
+  static int64_t bucketLimit(int bucket);
+
+  /**
+   * @return approximation of the specified percentile (0-100) based on the bucket limits
+   */
+  int64_t percentile(int percent) const;
+
+private:
+  std::atomic<int64_t> m_Buckets[NUM_BUCKETS];
+  std::atomic<int64_t> m_Count;
+  std::atomic<int64_t> m_Sum;
+};
+
+
+/**
+ * @brief records the lifetime of the object in a histogram
+ */
+class ScopedLatency {
+public:
+  explicit ScopedLatency(MetricHistogram &histogram)
+    : m_Histogram(histogram), m_Start(std::chrono::steady_clock::now()) {}
+  ~ScopedLatency() {
+    m_Histogram.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - m_Start).count());
+  }
+private:
+  ScopedLatency(const ScopedLatency&);
+  ScopedLatency &operator=(const ScopedLatency&);
+private:
+  MetricHistogram &m_Histogram;
+  std::chrono::steady_clock::time_point m_Start;
+};
+
+
+/**
+ * @brief central registry of the counters, gauges and histograms collected during a session
+ *
+ * Metrics are created on first access and live until the application ends so callers can
+ * keep references to them (usually in a function-local static). Updating a metric is a
+ * single relaxed atomic operation.
+ */
+class RuntimeMetrics {
+public:
+
+  static RuntimeMetrics &instance();
+
+  MetricCounter &counter(const std::string &name);
+  MetricGauge &gauge(const std::string &name);
+  MetricHistogram &histogram(const std::string &name);
+
+  /**
+   * @return all metrics in a human-readable format
+   */
+  std::string toText() const;
+
+  /**
+   * @return all metrics as a json object, suitable for comparison between versions
+   */
+  std::string toJSON() const;
+
+private:
+
+  RuntimeMetrics() {}
+
+private:
+
+  mutable std::mutex m_Mutex;
+  std::map<std::string, std::unique_ptr<MetricCounter>> m_Counters;
+  std::map<std::string, std::unique_ptr<MetricGauge>> m_Gauges;
+  std::map<std::string, std::unique_ptr<MetricHistogram>> m_Histograms;
+
+};
+
+} // namespace MOShared
+
+#endif // RUNTIMEMETRICS_H
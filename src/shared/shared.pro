@@ -24,7 +24,8 @@ SOURCES += \
     util.cpp \
     appconfig.cpp \
     leaktrace.cpp \
-    stackdata.cpp
+    stackdata.cpp \
+    runtimemetrics.cpp
 
 HEADERS += \
     inject.h \
@@ -35,7 +36,8 @@ HEADERS += \
     appconfig.h \
     appconfig.inc \
     leaktrace.h \
-    stackdata.h
+    stackdata.h \
+    runtimemetrics.h
 
 
 # only for custom leak detection
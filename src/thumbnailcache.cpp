@@ -0,0 +1,148 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "thumbnailcache.h"
+
+#include <utility.h>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+
+#include <Windows.h>
+
+
+using namespace MOBase;
+
+
+namespace {
+
+/**
+ * @brief set the modification time of a file to now so it's evicted last
+ */
+void touch(const QString &fileName)
+{
+  HANDLE file = ::CreateFileW(ToWString(QDir::toNativeSeparators(fileName)).c_str(),
+                              FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    // evicted in the meantime or in use, not worth reporting
+    return;
+  }
+  FILETIME now;
+  ::GetSystemTimeAsFileTime(&now);
+  ::SetFileTime(file, nullptr, nullptr, &now);
+  ::CloseHandle(file);
+}
+
+}
+
+
+ThumbnailCache::ThumbnailCache(const QString &directory, qint64 maxSize)
+  : m_Directory(directory)
+  , m_MaxSize(maxSize)
+  , m_Size(-1)
+{
+}
+
+
+QImage ThumbnailCache::scale(const QImage &image)
+{
+  if (static_cast<float>(image.width()) / static_cast<float>(image.height()) > 1.34) {
+    return image.scaledToWidth(128);
+  } else {
+    return image.scaledToHeight(96);
+  }
+}
+
+
+QString ThumbnailCache::cacheFile(const QFileInfo &source) const
+{
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(source.absoluteFilePath().toLower().toUtf8());
+  hash.addData(QByteArray::number(source.size()));
+  hash.addData(QByteArray::number(source.lastModified().toMSecsSinceEpoch()));
+  return m_Directory + "/" + QString::fromLatin1(hash.result().toHex()) + ".png";
+}
+
+
+QImage ThumbnailCache::thumbnail(const QString &fileName)
+{
+  QFileInfo source(fileName);
+  QString cached = cacheFile(source);
+
+  QImage result;
+  if (result.load(cached, "PNG")) {
+    touch(cached);
+    return result;
+  }
+
+  result = QImage(fileName);
+  if (result.isNull()) {
+    return result;
+  }
+  result = scale(result);
+
+  QDir().mkpath(m_Directory);
+  // write to a temporary file first so a concurrent reader never sees a partial thumbnail
+  QString temporary = cached + ".tmp";
+  if (result.save(temporary, "PNG")) {
+    QFile::remove(cached);
+    if (QFile::rename(temporary, cached)) {
+      added(QFileInfo(cached).size());
+    } else {
+      QFile::remove(temporary);
+    }
+  }
+  return result;
+}
+
+
+void ThumbnailCache::added(qint64 size)
+{
+  QMutexLocker lock(&m_Mutex);
+
+  QDir directory(m_Directory);
+  if (m_Size < 0) {
+    m_Size = 0;
+    for (const QFileInfo &file : directory.entryInfoList(QStringList("*.png"), QDir::Files)) {
+      m_Size += file.size();
+    }
+  } else {
+    m_Size += size;
+  }
+
+  if (m_Size <= m_MaxSize) {
+    return;
+  }
+
+  // shrink a bit below the limit so this doesn't happen again on the next thumbnail
+  qint64 target = m_MaxSize - m_MaxSize / 4;
+  for (const QFileInfo &file : directory.entryInfoList(QStringList("*.png"), QDir::Files,
+                                                       QDir::Time | QDir::Reversed)) {
+    if (m_Size <= target) {
+      break;
+    }
+    if (QFile::remove(file.absoluteFilePath())) {
+      m_Size -= file.size();
+    }
+  }
+}
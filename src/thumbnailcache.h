@@ -0,0 +1,82 @@
+/*
+Copyright (C) 2016 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QFileInfo>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+
+/**
+ * @brief on-disk cache of scaled down images
+ *
+ * Thumbnails are identified by path, size and modification time of the image they were made
+ * from so they are recreated automatically when the image changes. Once the cache grows
+ * beyond its size limit the least recently used thumbnails are removed. Use is tracked
+ * through the modification time of the thumbnail files.
+ * All functions are thread-safe.
+ */
+class ThumbnailCache
+{
+
+public:
+
+  /**
+   * @param directory directory to store thumbnails in. It's created when the first thumbnail
+   *                  is written
+   * @param maxSize maximum size of all thumbnails in bytes
+   */
+  ThumbnailCache(const QString &directory, qint64 maxSize = DEFAULT_MAX_SIZE);
+
+  /**
+   * @brief retrieve the thumbnail for an image, creating it if necessary
+   * @param fileName path of the image
+   * @return the thumbnail or a null image if the file isn't a readable image
+   */
+  QImage thumbnail(const QString &fileName);
+
+  /**
+   * @brief scale an image down to thumbnail size
+   */
+  static QImage scale(const QImage &image);
+
+private:
+
+  static const qint64 DEFAULT_MAX_SIZE = 64 * 1024 * 1024;
+
+private:
+
+  QString cacheFile(const QFileInfo &source) const;
+  void added(qint64 size);
+
+private:
+
+  QString m_Directory;
+  qint64 m_MaxSize;
+
+  QMutex m_Mutex;
+  // total size of the cache, -1 until the directory was scanned
+  qint64 m_Size;
+
+};
+
+#endif // THUMBNAILCACHE_H
@@ -239,7 +239,7 @@ void TransferSavesDialog::on_globalCharacterList_currentTextChanged(const QStrin
   SaveCollection::const_iterator saveList = m_GlobalSaves.find(currentText);
   if (saveList != m_GlobalSaves.end()) {
     for (SaveListItem const &save : saveList->second) {
-      ui->globalSavesList->addItem(QFileInfo(save->getFilename()).fileName());
+      ui->globalSavesList->addItem(QFileInfo(save.path).fileName());
     }
   }
 }
@@ -252,7 +252,7 @@ void TransferSavesDialog::on_localCharacterList_currentTextChanged(const QString
   SaveCollection::const_iterator saveList = m_LocalSaves.find(currentText);
   if (saveList != m_LocalSaves.end()) {
     for (SaveListItem const &save : saveList->second) {
-      ui->localSavesList->addItem(QFileInfo(save->getFilename()).fileName());
+      ui->localSavesList->addItem(QFileInfo(save.path).fileName());
     }
   }
 }
@@ -260,8 +260,6 @@ void TransferSavesDialog::on_localCharacterList_currentTextChanged(const QString
 void TransferSavesDialog::refreshSaves(SaveCollection &saveCollection, QString const &savedir)
 {
   saveCollection.clear();
-  QDir savesDir(savedir);
-  savesDir.setNameFilters(QStringList() << QString("*.%1").arg(m_GamePlugin->savegameExtension()));
 
   SaveGameInfo const *info = m_GamePlugin->feature<SaveGameInfo>();
   if (info == nullptr) {
@@ -269,12 +267,11 @@ void TransferSavesDialog::refreshSaves(SaveCollection &saveCollection, QString c
     info = &dummyInfo;
   }
 
-  QStringList files = savesDir.entryList(QDir::Files, QDir::Time);
-  for (const QString &filename : files) {
-    QString file = savesDir.absoluteFilePath(filename);
-    MOBase::ISaveGame const *save = info->getSaveGameInfo(file);
-    saveCollection[save->getSaveGroupIdentifier()].push_back(
-                                std::unique_ptr<MOBase::ISaveGame const>(save));
+  // saves already seen (e.g. by the main window) are not parsed again
+  QList<SaveGameCatalogue::Entry> saves = SaveGameCatalogue::instance()->saves(
+        savedir, m_GamePlugin->savegameExtension(), info, true);
+  for (const SaveGameCatalogue::Entry &save : saves) {
+    saveCollection[save.group].push_back(save);
   }
 }
 
@@ -312,7 +309,7 @@ bool TransferSavesDialog::transferCharacters(QString const &character,
 
   QDir destination(dest);
   for (SaveListItem const &save : saves) {
-    for (QString source : save->allFiles()) {
+    for (QString source : save.files) {
       QFileInfo sourceFile(source);
       QString destinationFile(destination.absoluteFilePath(sourceFile.fileName()));
 
@@ -22,6 +22,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "tutorabledialog.h"
 #include "profile.h"
+#include "savegamecatalogue.h"
 
 class QListWidget;
 #include <QObject>
@@ -29,13 +30,11 @@ class QPushButton;
 #include <QString>
 class QWidget;
 
-#include <memory>
 #include <map>
 #include <vector>
 
 namespace Ui { class TransferSavesDialog; }
 namespace MOBase { class IPluginGame; }
-namespace MOBase { class ISaveGame; }
 
 class TransferSavesDialog : public MOBase::TutorableDialog
 {
@@ -85,7 +84,7 @@ private:
 
   MOBase::IPluginGame const *m_GamePlugin;
 
-  typedef std::unique_ptr<MOBase::ISaveGame const> SaveListItem;
+  typedef SaveGameCatalogue::Entry SaveListItem;
   typedef std::vector<SaveListItem> SaveList;
   typedef std::map<QString, SaveList> SaveCollection;
   SaveCollection m_GlobalSaves;